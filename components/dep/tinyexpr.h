@@ -35,6 +35,9 @@ extern "C" {
 
 typedef struct te_expr {
     int type;
+#ifdef __GNUC__
+    __extension__ /* The unnamed union is C11. */
+#endif
     union {double value; const double *bound; const void *function;};
     void *parameters[1];
 } te_expr;
@@ -110,8 +110,10 @@ main(void)
  ===============================================================================
  */
 struct bs_t {
-	te_expr *fn_expr;
-	double   fn_x; /* Current (last) value that was used in the function. */
+	te_expr      *fn_expr;
+	double        fn_x;     /* Current (last) value that was used in the
+	                           function. */
+	unsigned long fn_evals; /* Times the function has been evaluated. */
 };
 
 /* The process of getting root. */
@@ -126,6 +128,13 @@ struct bs_output {
 	char  fn_a_sign, fn_b_sign, fn_c_sign;
 };
 
+/* Where a bisection process left off, so that it can be continued later. */
+struct bs_state {
+	float a, b;
+	char  c_old;   /* End ('a' or 'b') that was last replaced by 'c'. */
+	int   is_done; /* Set once the process has reached its precision. */
+};
+
 /*
  ===============================================================================
  |                            Function Declarations                            |
@@ -179,6 +188,24 @@ bs_execute(struct bs_t *bs_instance, float interval_lower, float interval_upper,
  * Returns NULL if the intervals aren't valid for the bisection process.
  */
 
+void
+bs_state_init(struct bs_state *bs_state, float interval_lower,
+              float interval_upper);
+/* Initialize the state to start a bisection process on the given intervals. */
+
+struct bs_output *
+bs_continue(struct bs_t *bs_instance, struct bs_state *bs_state,
+            enum bs_process_t process, unsigned int precision,
+            unsigned int iterations_c, int *n);
+/*
+ * Same as 'bs_execute' but starts from and updates `bs_state`, so that
+ * calling it again performs the iterations following the last call.
+ *
+ * The intervals in the state aren't validated.
+ *
+ * `*n` is 0 if the process had already reached its precision.
+ */
+
 void
 bs_instance_free(struct bs_t *bs_instance);
 /*
@@ -215,7 +242,8 @@ int
 bs_init(struct bs_t *bs_instance, char *fn_expr_str)
 {
 	/* tinyexpr */
-	te_variable fn_var[1] = { { "x", &(bs_instance->fn_x) } };
+	te_variable fn_var[1] = { { "x", &(bs_instance->fn_x), 0, NULL } };
+	bs_instance->fn_evals = 0;
 
 	int fn_expr_err;
 	bs_instance->fn_expr = te_compile(fn_expr_str, fn_var, 1, &fn_expr_err);
@@ -229,6 +257,7 @@ float
 bs_point_val(struct bs_t *bs_instance, double point)
 {
 	bs_instance->fn_x = point;
+	bs_instance->fn_evals++;
 
 	return te_eval(bs_instance->fn_expr);
 }
@@ -262,17 +291,39 @@ bs_execute(struct bs_t *bs_instance, float interval_lower, float interval_upper,
 	if (!bs_are_valid_points(bs_instance, interval_lower, interval_upper))
 		return NULL;
 
-	float a = interval_lower;
-	float b = interval_upper;
+	struct bs_state bs_state;
+	bs_state_init(&bs_state, interval_lower, interval_upper);
+
+	return bs_continue(bs_instance, &bs_state, process, precision,
+	                   iterations_c, n);
+}
+
+void
+bs_state_init(struct bs_state *bs_state, float interval_lower,
+              float interval_upper)
+{
+	bs_state->a = interval_lower;
+	bs_state->b = interval_upper;
+	/* Point 'c_old' to something so that the first 'is_equal_*'
+	 * comparision has a value to compare against. */
+	bs_state->c_old   = 'b';
+	bs_state->is_done = 0;
+}
+
+struct bs_output *
+bs_continue(struct bs_t *bs_instance, struct bs_state *bs_state,
+            enum bs_process_t process, unsigned int precision,
+            unsigned int iterations_c, int *n)
+{
+	float a = bs_state->a;
+	float b = bs_state->b;
 
 	int               count = 0;
 	struct bs_output *bs_o_ret =
 		malloc(iterations_c * sizeof(struct bs_output));
 
-	/* Initialize '*c_old' to something so that it won't seg fault in the
-	 * first 'is_equal_*' comparision. */
-	float *c_old = &b;
-	for (unsigned int i = 0; i < iterations_c; i++) {
+	float *c_old = bs_state->c_old == 'a' ? &a : &b;
+	for (unsigned int i = 0; i < iterations_c && !bs_state->is_done; i++) {
 		char  fn_a_sign = bs_point_val_sign(bs_instance, a);
 		char  fn_b_sign = bs_point_val_sign(bs_instance, b);
 		float c         = (a + b) / 2.0f;
@@ -300,11 +351,13 @@ bs_execute(struct bs_t *bs_instance, float interval_lower, float interval_upper,
 
 		if (process == BS_ITERATIONS || process == BS_DECIMAL_PLACES) {
 			if (spm_is_equal_deci(c, *c_old, precision))
-				break;
+				bs_state->is_done = 1;
 		} else {
 			if (spm_is_equal_signi(c, *c_old, precision))
-				break;
+				bs_state->is_done = 1;
 		}
+		if (bs_state->is_done)
+			break;
 
 		if ((fn_c_sign == '+' && fn_a_sign == '+') ||
 		    (fn_c_sign == '-' && fn_a_sign == '-')) {
@@ -316,6 +369,10 @@ bs_execute(struct bs_t *bs_instance, float interval_lower, float interval_upper,
 		}
 	}
 
+	bs_state->a     = a;
+	bs_state->b     = b;
+	bs_state->c_old = c_old == &a ? 'a' : 'b';
+
 	*n = count;
 	return bs_o_ret;
 }
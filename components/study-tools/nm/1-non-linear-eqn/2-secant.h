@@ -101,8 +101,10 @@ main(void)
  ===============================================================================
  */
 struct sct_t {
-	te_expr *fn_expr;
-	double   fn_x; /* Current (last) value that was used in the function. */
+	te_expr      *fn_expr;
+	double        fn_x;     /* Current (last) value that was used in the
+	                           function. */
+	unsigned long fn_evals; /* Times the function has been evaluated. */
 };
 
 /* The process of getting root. */
@@ -116,6 +118,12 @@ struct sct_output {
 	float x0, fn_x0, x1, fn_x1, x2, fn_x2;
 };
 
+/* Where a secant process left off, so that it can be continued later. */
+struct sct_state {
+	float x0, x1;
+	int   is_done; /* Set once the process has reached its precision. */
+};
+
 /*
  ===============================================================================
  |                            Function Declarations                            |
@@ -159,6 +167,22 @@ sct_execute(struct sct_t *sct_instance, float interval_lower,
  * At most `iterations_c` iterations are performed for all the `process`.
  */
 
+void
+sct_state_init(struct sct_state *sct_state, float interval_lower,
+               float interval_upper);
+/* Initialize the state to start a secant process on the given intervals. */
+
+struct sct_output *
+sct_continue(struct sct_t *sct_instance, struct sct_state *sct_state,
+             enum sct_process_t process, unsigned int precision,
+             unsigned int iterations_c, int *n);
+/*
+ * Same as 'sct_execute' but starts from and updates `sct_state`, so that
+ * calling it again performs the iterations following the last call.
+ *
+ * `*n` is 0 if the process had already reached its precision.
+ */
+
 void
 sct_instance_free(struct sct_t *sct_instance);
 /*
@@ -195,7 +219,8 @@ int
 sct_init(struct sct_t *sct_instance, char *fn_expr_str)
 {
 	/* tinyexpr */
-	te_variable fn_var[1] = { { "x", &(sct_instance->fn_x) } };
+	te_variable fn_var[1] = { { "x", &(sct_instance->fn_x), 0, NULL } };
+	sct_instance->fn_evals = 0;
 
 	int fn_expr_err;
 	sct_instance->fn_expr =
@@ -210,6 +235,7 @@ float
 sct_point_val(struct sct_t *sct_instance, double point)
 {
 	sct_instance->fn_x = point;
+	sct_instance->fn_evals++;
 
 	return te_eval(sct_instance->fn_expr);
 }
@@ -220,10 +246,10 @@ sct_next_x(struct sct_t *sct_instance, double x0, double x1)
 	double fn_x0 = sct_point_val(sct_instance, x0);
 	double fn_x1 = sct_point_val(sct_instance, x1);
 
-	te_variable fn_vars[] = { { "x0", &x0 },
-		                  { "x1", &x1 },
-		                  { "fn_x0", &fn_x0 },
-		                  { "fn_x1", &fn_x1 } };
+	te_variable fn_vars[] = { { "x0", &x0, 0, NULL },
+		                  { "x1", &x1, 0, NULL },
+		                  { "fn_x0", &fn_x0, 0, NULL },
+		                  { "fn_x1", &fn_x1, 0, NULL } };
 
 	te_expr *fn_expr =
 		te_compile("(x0 * fn_x1 - x1 * fn_x0) / (fn_x1 - fn_x0)",
@@ -240,13 +266,35 @@ sct_execute(struct sct_t *sct_instance, float interval_lower,
             float interval_upper, enum sct_process_t process,
             unsigned int precision, unsigned int iterations_c, int *n)
 {
-	float x0 = interval_lower;
-	float x1 = interval_upper;
+	struct sct_state sct_state;
+	sct_state_init(&sct_state, interval_lower, interval_upper);
+
+	return sct_continue(sct_instance, &sct_state, process, precision,
+	                    iterations_c, n);
+}
+
+void
+sct_state_init(struct sct_state *sct_state, float interval_lower,
+               float interval_upper)
+{
+	sct_state->x0      = interval_lower;
+	sct_state->x1      = interval_upper;
+	sct_state->is_done = 0;
+}
+
+struct sct_output *
+sct_continue(struct sct_t *sct_instance, struct sct_state *sct_state,
+             enum sct_process_t process, unsigned int precision,
+             unsigned int iterations_c, int *n)
+{
+	float x0 = sct_state->x0;
+	float x1 = sct_state->x1;
 
 	int                count = 0;
 	struct sct_output *sct_o_ret =
 		malloc(iterations_c * sizeof(struct sct_output));
-	for (unsigned int i = 0; i < iterations_c; i++) {
+	for (unsigned int i = 0; i < iterations_c && !sct_state->is_done;
+	     i++) {
 		float fn_x0 = sct_point_val(sct_instance, x0);
 		float fn_x1 = sct_point_val(sct_instance, x1);
 		float x2    = sct_next_x(sct_instance, x0, x1);
@@ -282,11 +330,13 @@ sct_execute(struct sct_t *sct_instance, float interval_lower,
 		if (process == SCT_ITERATIONS ||
 		    process == SCT_DECIMAL_PLACES) {
 			if (spm_is_equal_deci(x1, x2, precision))
-				break;
+				sct_state->is_done = 1;
 		} else {
 			if (spm_is_equal_signi(x1, x2, precision))
-				break;
+				sct_state->is_done = 1;
 		}
+		if (sct_state->is_done)
+			break;
 
 		x0    = x1;
 		fn_x0 = fn_x1;
@@ -294,6 +344,9 @@ sct_execute(struct sct_t *sct_instance, float interval_lower,
 		fn_x1 = fn_x2;
 	}
 
+	sct_state->x0 = x0;
+	sct_state->x1 = x1;
+
 	*n = count;
 	return sct_o_ret;
 }
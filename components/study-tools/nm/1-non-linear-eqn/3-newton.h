@@ -151,7 +151,7 @@ int
 nwtn_init(struct nwtn_t *nwtn_instance, char *fn_expr_str)
 {
 	/* tinyexpr */
-	te_variable fn_var[1] = { { "x", &(nwtn_instance->fn_x) } };
+	te_variable fn_var[1] = { { "x", &(nwtn_instance->fn_x), 0, NULL } };
 
 	int fn_expr_err;
 	nwtn_instance->fn_expr =
@@ -166,7 +166,7 @@ int
 nwtn_init_df(struct nwtn_t *nwtn_instance, char *d_fn_expr_str)
 {
 	/* tinyexpr */
-	te_variable fn_var[1] = { { "x", &(nwtn_instance->fn_x) } };
+	te_variable fn_var[1] = { { "x", &(nwtn_instance->fn_x), 0, NULL } };
 
 	int fn_expr_err;
 	nwtn_instance->d_fn_expr =
@@ -197,9 +197,9 @@ float
 nwtn_next_x(struct nwtn_t *nwtn_instance, double x0, double fn_x0,
             double d_fn_x0)
 {
-	te_variable fn_vars[] = { { "x0", &x0 },
-		                  { "fn_x0", &fn_x0 },
-		                  { "d_fn_x0", &d_fn_x0 } };
+	te_variable fn_vars[] = { { "x0", &x0, 0, NULL },
+		                  { "fn_x0", &fn_x0, 0, NULL },
+		                  { "d_fn_x0", &d_fn_x0, 0, NULL } };
 
 	te_expr *fn_expr =
 		te_compile("x0 - (fn_x0 / d_fn_x0)", fn_vars, 3, NULL);
@@ -19,6 +19,53 @@
  * implementation.
  */
 
+/*
+ ===============================================================================
+ |                                Example code                                 |
+ ===============================================================================
+ */
+#if 0
+#include <stdio.h>
+
+#define MRSPC_HORNER_IMPLEMENTATION
+#include "4-horner.h"
+
+int
+main(void)
+{
+	/* = Inputs for the all roots process = */
+	float poly_body[] = { 1, -2, -5, 6 }; /* x^3 - 2x^2 - 5x + 6 */
+	enum hrn_process_t hrn_p = HRN_DECIMAL_PLACES; /* Process to execute */
+	int precision = 4, iter_c = 99; /* Precision and Max iterations count */
+
+	/* = Main process = */
+	struct hrn_t hrn_instance;
+	hrn_init(&hrn_instance, 3, poly_body);
+
+	int              hrn_r_c;
+	struct hrn_root *hrn_r = hrn_all_roots(&hrn_instance, hrn_p, precision,
+	                                       iter_c, &hrn_r_c);
+	if (hrn_r == NULL) {
+		fprintf(stderr, "Invalid polynomial\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* = Display output = */
+	for (int i = 0; i < hrn_r_c; i++)
+		printf("%d\t%.*g\t%.*g\n", i + 1, precision + 1, hrn_r[i].re,
+		       precision + 1, hrn_r[i].im);
+
+	/* = Cleanup and Exit = */
+	free(hrn_r);
+	return 0;
+}
+#endif
+/* Output:
+ * 1       3       0
+ * 2       -2      0
+ * 3       1       0
+ */
+
 /*
  ===============================================================================
  |                              HEADER-FILE MODE                               |
@@ -63,6 +110,10 @@ struct hrn_output {
 	float x_output;
 };
 
+struct hrn_root {
+	float re, im;
+};
+
 /*
  ===============================================================================
  |                            Function Declarations                            |
@@ -97,6 +148,32 @@ hrn_execute(struct hrn_t *hrn_instance, float point, enum hrn_process_t process,
  * Returns NULL if the intervals aren't valid for the horner process.
  */
 
+struct hrn_root *
+hrn_all_roots(struct hrn_t *hrn_instance, enum hrn_process_t process,
+              unsigned int precision, unsigned int iterations_c, int *n);
+/*
+ * Find all the roots (real and complex) of the polynomial at once and returns
+ * the pointer to the array containing them.
+ *
+ * Roots at zero are deflated out first, the rest are found with Aberth
+ * iterations where every estimate is updated simultaneously from the previous
+ * set of estimates. The estimates clustered around a real multiple root are
+ * then replaced by it, and the other real roots are polished and deflated out
+ * one by one so that each one is refined against a lower degree polynomial,
+ * with the synthetic division of 'hrn_execute'.
+ *
+ * As the returned array is dynamically allocated, make sure to free it.
+ *
+ * `*n` is filled with the number of roots found i.e. the degree of the
+ * polynomial after dropping the leading zero coefficients.
+ *
+ * Precision specifies the count for the specified `process`.
+ *
+ * At most `iterations_c` iterations are performed for all the `process`.
+ *
+ * Returns NULL if the polynomial is a constant.
+ */
+
 #endif /* MRSPC_HORNER_H */
 
 /*
@@ -107,7 +184,9 @@ hrn_execute(struct hrn_t *hrn_instance, float point, enum hrn_process_t process,
 
 #ifdef MRSPC_HORNER_IMPLEMENTATION
 
+#include <float.h>
 #include <stdlib.h>
+#include <math.h>
 
 #ifndef SPM_IMPLEMENTED /* Avoid sp-math.h's implementation twice. */
 #define SPM_IMPLEMENTATION
@@ -126,6 +205,58 @@ hrn_init(struct hrn_t *hrn_instance, unsigned int poly_degree, float *poly_body)
 	hrn_instance->poly_body   = poly_body;
 }
 
+static float
+hrn_round(float num, enum hrn_process_t process, unsigned int precision)
+{
+	float rounded = num;
+	if (process == HRN_ITERATIONS || process == HRN_DECIMAL_PLACES)
+		rounded = spm_round_off_d(num, precision + 1);
+	else if (process == HRN_SIGNIFICANT_DIGITS)
+		rounded = spm_signifi_d(num, precision + 1);
+
+	/* No -0 once rounded. */
+	return rounded == 0 ? 0 : rounded;
+}
+
+static int
+hrn_is_equal(float num1, float num2, enum hrn_process_t process,
+             unsigned int precision)
+{
+	if (process == HRN_ITERATIONS || process == HRN_DECIMAL_PLACES)
+		return spm_is_equal_deci(num1, num2, precision);
+
+	return spm_is_equal_signi(num1, num2, precision);
+}
+
+static double
+hrn_synthetic_div(const double *poly_body, unsigned int poly_degree,
+                  double point, enum hrn_process_t process,
+                  unsigned int precision, double *products, double *row)
+{
+	/* Dividing by (x - point): b[0] = a[0], b[j] = a[j] + point * b[j - 1].
+	 * `row` gets b[0 .. poly_degree], the quotient then the remainder
+	 * P(point) which is returned, and `products` the point * b[j - 1] if
+	 * not NULL. They're rounded for the `process` unless it's 0. `row` can
+	 * be `poly_body` to divide in place. */
+	row[0] = poly_body[0];
+	if (products)
+		products[0] = 0;
+	for (unsigned int j = 1; j <= poly_degree; j++) {
+		double product = point * row[j - 1];
+		row[j]         = poly_body[j] + product;
+		if (process) {
+			/* In float, like the table of 'hrn_output'. */
+			float sum = poly_body[j] + (float)product;
+			row[j]    = hrn_round(sum, process, precision);
+			product   = hrn_round(product, process, precision);
+		}
+		if (products)
+			products[j] = product;
+	}
+
+	return row[poly_degree];
+}
+
 struct hrn_output *
 hrn_execute(struct hrn_t *hrn_instance, float point, enum hrn_process_t process,
             unsigned int precision, unsigned int iterations_c, int *n)
@@ -134,49 +265,36 @@ hrn_execute(struct hrn_t *hrn_instance, float point, enum hrn_process_t process,
 	struct hrn_output *hrn_o_ret =
 		malloc(iterations_c * sizeof(struct hrn_output));
 
+	unsigned int deg = hrn_instance->poly_degree;
+	double       a[MRSPC_HORNER_MAX_DEGREE], b[MRSPC_HORNER_MAX_DEGREE];
+	double       db[MRSPC_HORNER_MAX_DEGREE];
+	double       products[MRSPC_HORNER_MAX_DEGREE];
+	double       d_products[MRSPC_HORNER_MAX_DEGREE];
+	for (unsigned int j = 0; j <= deg; j++)
+		a[j] = hrn_instance->poly_body[j];
+
 	float point_old;
 	for (unsigned int i = 0; i < iterations_c; i++) {
-		hrn_o_ret[i].x_input = point;
-
-		for (unsigned int j = 0; j < hrn_instance->poly_degree + 1; j++) {
-			hrn_o_ret[i].coeff_fn_1[j] = hrn_instance->poly_body[j];
-		}
-
 		struct hrn_output *hrn_cur = &(hrn_o_ret[i]);
-		float             *coeff_1, *coeff_2, *coeff_3;
-		coeff_1    = &(hrn_cur->coeff_fn_1);
-		coeff_2    = &(hrn_cur->coeff_fn_2);
-		coeff_3    = &(hrn_cur->coeff_dfn_1);
-		coeff_3[0] = coeff_1[0];
-		for (int j = 1; j <= hrn_instance->poly_degree; j++) {
-			coeff_2[j] = point * coeff_3[j - 1];
-			coeff_3[j] = coeff_1[j] + coeff_2[j];
-			if (process == HRN_ITERATIONS || process == HRN_DECIMAL_PLACES) {
-				coeff_2[j] = spm_round_off_d(coeff_2[j], precision + 1);
-				coeff_3[j] = spm_round_off_d(coeff_3[j], precision + 1);
-			} else if (process == HRN_SIGNIFICANT_DIGITS) {
-				coeff_2[j] = spm_signifi_d(coeff_2[j], precision + 1);
-				coeff_3[j] = spm_signifi_d(coeff_3[j], precision + 1);
-			}
+		hrn_cur->x_input           = point;
+
+		/* P(point) is the remainder of dividing P by (x - point), and
+		 * P'(point) the one of dividing the quotient again. */
+		hrn_synthetic_div(a, deg, point, process, precision, products,
+		                  b);
+		hrn_synthetic_div(b, deg - 1, point, process, precision,
+		                  d_products, db);
+		for (unsigned int j = 0; j <= deg; j++) {
+			hrn_cur->coeff_fn_1[j]  = a[j];
+			hrn_cur->coeff_fn_2[j]  = products[j];
+			hrn_cur->coeff_dfn_1[j] = b[j];
 		}
-		hrn_cur->p_x = &(coeff_3[hrn_instance->poly_degree]);
-
-		coeff_1    = &(hrn_cur->coeff_dfn_1);
-		coeff_2    = &(hrn_cur->coeff_dfn_2);
-		coeff_3    = &(hrn_cur->coeff_d2fn);
-		coeff_3[0] = coeff_1[0];
-		for (int j = 1; j <= hrn_instance->poly_degree - 1; j++) {
-			coeff_2[j] = point * coeff_3[j - 1];
-			coeff_3[j] = coeff_1[j] + coeff_2[j];
-			if (process == HRN_ITERATIONS || process == HRN_DECIMAL_PLACES) {
-				coeff_2[j] = spm_round_off_d(coeff_2[j], precision + 1);
-				coeff_3[j] = spm_round_off_d(coeff_3[j], precision + 1);
-			} else if (process == HRN_SIGNIFICANT_DIGITS) {
-				coeff_2[j] = spm_signifi_d(coeff_2[j], precision + 1);
-				coeff_3[j] = spm_signifi_d(coeff_3[j], precision + 1);
-			}
+		for (unsigned int j = 0; j < deg; j++) {
+			hrn_cur->coeff_dfn_2[j] = d_products[j];
+			hrn_cur->coeff_d2fn[j]  = db[j];
 		}
-		hrn_cur->dp_x = &(coeff_3[hrn_instance->poly_degree - 1]);
+		hrn_cur->p_x  = &(hrn_cur->coeff_dfn_1[deg]);
+		hrn_cur->dp_x = &(hrn_cur->coeff_d2fn[deg - 1]);
 
 		hrn_cur->x_output = point - *(hrn_cur->p_x) / *(hrn_cur->dp_x);
 		if (process == HRN_ITERATIONS || process == HRN_DECIMAL_PLACES) {
@@ -205,4 +323,293 @@ hrn_execute(struct hrn_t *hrn_instance, float point, enum hrn_process_t process,
 	return hrn_o_ret;
 }
 
+static void
+hrn_taylor(const double *poly_body, unsigned int poly_degree, double point,
+           unsigned int k_c, double *row, double *taylor)
+{
+	/* The remainders of dividing by (x - point) over and over are the
+	 * P^(k)(point) / k!, `taylor` gets them up to k = `k_c`. */
+	for (unsigned int j = 0; j <= poly_degree; j++)
+		row[j] = poly_body[j];
+	for (unsigned int k = 0; k <= k_c; k++)
+		taylor[k] = k > poly_degree ? 0
+		                            : hrn_synthetic_div(row,
+		                                                poly_degree - k,
+		                                                point, 0, 0,
+		                                                NULL, row);
+}
+
+static int
+hrn_polish_multiple(const double *poly_body, unsigned int poly_degree,
+                    unsigned int m, double *x)
+{
+	/* P^(m - 1) has a simple root where P has one of multiplicity m, which
+	 * Newton's method finds fast from the centre of the cluster. It's only
+	 * taken if P and its first m - 1 derivatives vanish there as far as the
+	 * rounding errors of evaluating them allow. */
+	double *row    = malloc((poly_degree + 1) * sizeof(double));
+	double *abs_a  = malloc((poly_degree + 1) * sizeof(double));
+	double *taylor = malloc((m + 1) * sizeof(double));
+	double *bound  = malloc((m + 1) * sizeof(double));
+
+	for (int step = 0; step < 64; step++) {
+		hrn_taylor(poly_body, poly_degree, *x, m, row, taylor);
+		if (taylor[m] == 0)
+			break;
+		double dx = taylor[m - 1] / (m * taylor[m]);
+		*x -= dx;
+		if (!isfinite(*x) || fabs(dx) <= DBL_EPSILON * fabs(*x))
+			break;
+	}
+
+	int is_multiple = isfinite(*x);
+	for (unsigned int j = 0; j <= poly_degree; j++)
+		abs_a[j] = fabs(poly_body[j]);
+	hrn_taylor(poly_body, poly_degree, *x, m - 1, row, taylor);
+	hrn_taylor(abs_a, poly_degree, fabs(*x), m - 1, row, bound);
+	for (unsigned int k = 0; is_multiple && k < m; k++)
+		is_multiple = fabs(taylor[k]) <=
+		              64 * poly_degree * DBL_EPSILON * bound[k];
+
+	free(row);
+	free(abs_a);
+	free(taylor);
+	free(bound);
+	return is_multiple;
+}
+
+struct hrn_root *
+hrn_all_roots(struct hrn_t *hrn_instance, enum hrn_process_t process,
+              unsigned int precision, unsigned int iterations_c, int *n)
+{
+	unsigned int deg  = hrn_instance->poly_degree;
+	float       *body = hrn_instance->poly_body;
+
+	/* Leading zero coefficients don't add any roots. */
+	while (deg > 0 && body[0] == 0) {
+		body++;
+		deg--;
+	}
+	if (deg == 0)
+		return NULL;
+
+	int              count     = 0;
+	struct hrn_root *hrn_r_ret = malloc(deg * sizeof(struct hrn_root));
+
+	/* Trailing zero coefficients are roots at zero; deflating by (x - 0)
+	 * just drops the last coefficient. */
+	while (deg > 0 && body[deg] == 0) {
+		hrn_r_ret[count].re = 0;
+		hrn_r_ret[count].im = 0;
+		count++;
+		deg--;
+	}
+	if (deg == 0) {
+		*n = count;
+		return hrn_r_ret;
+	}
+
+	/* Work in double and keep the estimates as separate real and imaginary
+	 * arrays so that the update loops stay vectorizable. */
+	double *a     = malloc((deg + 1) * sizeof(double));
+	double *z_re  = malloc(deg * sizeof(double));
+	double *z_im  = malloc(deg * sizeof(double));
+	double *w_re  = malloc(deg * sizeof(double));
+	double *w_im  = malloc(deg * sizeof(double));
+	char   *is_ok = calloc(deg, sizeof(char));
+	for (unsigned int j = 0; j <= deg; j++)
+		a[j] = body[j];
+
+	/* Initial estimates on a circle of the geometric mean radius of the
+	 * roots, rotated off the real axis to break the symmetry. */
+	double radius = pow(fabs(a[deg] / a[0]), 1.0 / deg);
+	for (unsigned int k = 0; k < deg; k++) {
+		double theta = 2 * acos(-1.0) * k / deg + 0.4;
+		z_re[k]      = radius * cos(theta);
+		z_im[k]      = radius * sin(theta);
+	}
+
+	for (unsigned int i = 0; i < iterations_c; i++) {
+		/* = Aberth corrections from the current estimates = */
+		for (unsigned int k = 0; k < deg; k++) {
+			w_re[k] = w_im[k] = 0;
+			if (is_ok[k])
+				continue;
+
+			/* p(z) and p'(z) with horner's method */
+			double p_re = a[0], p_im = 0, dp_re = 0, dp_im = 0;
+			for (unsigned int j = 1; j <= deg; j++) {
+				double t = dp_re * z_re[k] - dp_im * z_im[k] + p_re;
+				dp_im    = dp_re * z_im[k] + dp_im * z_re[k] + p_im;
+				dp_re    = t;
+				t        = p_re * z_re[k] - p_im * z_im[k] + a[j];
+				p_im     = p_re * z_im[k] + p_im * z_re[k];
+				p_re     = t;
+			}
+
+			/* Newton step: p(z) / p'(z) */
+			double d    = dp_re * dp_re + dp_im * dp_im;
+			if (d == 0) /* stationary point; nudge the estimate */
+				d = dp_re = 1e-12;
+			double nt_re = (p_re * dp_re + p_im * dp_im) / d;
+			double nt_im = (p_im * dp_re - p_re * dp_im) / d;
+
+			/* Sum of 1 / (z_k - z_j) over the other estimates */
+			double s_re = 0, s_im = 0;
+			for (unsigned int j = 0; j < deg; j++) {
+				double dr = z_re[k] - z_re[j];
+				double di = z_im[k] - z_im[j];
+				double dd = dr * dr + di * di;
+				if (j == k || dd == 0)
+					continue;
+				s_re += dr / dd;
+				s_im -= di / dd;
+			}
+
+			/* w = N / (1 - N * S) */
+			double den_re = 1 - (nt_re * s_re - nt_im * s_im);
+			double den_im = -(nt_re * s_im + nt_im * s_re);
+			d             = den_re * den_re + den_im * den_im;
+			w_re[k]       = (nt_re * den_re + nt_im * den_im) / d;
+			w_im[k]       = (nt_im * den_re - nt_re * den_im) / d;
+		}
+
+		/* = Update every estimate at once = */
+		int is_all_ok = 1;
+		for (unsigned int k = 0; k < deg; k++) {
+			float old_re = z_re[k], old_im = z_im[k];
+			z_re[k] -= w_re[k];
+			z_im[k] -= w_im[k];
+
+			if (!is_ok[k])
+				is_ok[k] = hrn_is_equal(z_re[k], old_re, process,
+				                        precision) &&
+				           hrn_is_equal(z_im[k], old_im, process,
+				                        precision);
+			is_all_ok &= is_ok[k];
+		}
+
+		if (is_all_ok)
+			break;
+	}
+
+	/* = Multiple roots = */
+	/* The estimates of a root of multiplicity m converge slowly and end up
+	 * spread around it, off the real axis too. The neighbouring ones are
+	 * grouped, and a real group of m is replaced by the m-fold root found
+	 * from its centre, if it is one. */
+	unsigned int *group = malloc(deg * sizeof(unsigned int));
+	for (unsigned int k = 0; k < deg; k++)
+		group[k] = k;
+	for (int is_changed = 1; is_changed;) {
+		is_changed = 0;
+		for (unsigned int k = 0; k < deg; k++)
+			for (unsigned int j = 0; j < k; j++) {
+				double dist = fabs(z_re[k] - z_re[j]) +
+				              fabs(z_im[k] - z_im[j]);
+				if (group[k] == group[j] ||
+				    dist > 1e-2 * (1 + fabs(z_re[k]) +
+				                   fabs(z_im[k])))
+					continue;
+				group[k] = group[j] = group[k] < group[j]
+				                              ? group[k]
+				                              : group[j];
+				is_changed = 1;
+			}
+	}
+	char *is_multiple = calloc(deg, sizeof(char));
+	for (unsigned int g = 0; g < deg; g++) {
+		unsigned int m = 0;
+		double       c_re = 0, c_im = 0, spread = 0;
+		for (unsigned int k = 0; k < deg; k++)
+			if (group[k] == g) {
+				m++;
+				c_re += z_re[k];
+				c_im += z_im[k];
+			}
+		if (m < 2)
+			continue;
+		c_re /= m;
+		c_im /= m;
+		for (unsigned int k = 0; k < deg; k++)
+			if (group[k] == g)
+				spread += fabs(z_re[k] - c_re) +
+				          fabs(z_im[k] - c_im);
+		if (fabs(c_im) > spread ||
+		    !hrn_polish_multiple(a, deg, m, &c_re))
+			continue;
+
+		for (unsigned int k = 0; k < deg; k++)
+			if (group[k] == g) {
+				z_re[k]        = c_re;
+				z_im[k]        = 0;
+				is_multiple[k] = 1;
+			}
+	}
+
+	/* = Polish and deflate the real roots = */
+	unsigned int rem_deg = deg; /* degree of the deflated polynomial */
+	double      *q       = malloc((deg + 1) * sizeof(double));
+	for (unsigned int k = 0; k < deg && rem_deg > 0; k++) {
+		if (!is_multiple[k] &&
+		    fabs(z_im[k]) > 1e-6 * (1 + fabs(z_re[k])))
+			continue;
+
+		/* The multiple ones are polished against the whole polynomial
+		 * already. */
+		double x = z_re[k];
+		if (is_multiple[k]) {
+			;
+		} else if (rem_deg == 1) {
+			x = -a[1] / a[0];
+		} else {
+			for (int step = 0; step < 3; step++) {
+				double p  = hrn_synthetic_div(a, rem_deg, x, 0,
+				                              0, NULL, q);
+				double dp = hrn_synthetic_div(q, rem_deg - 1, x,
+				                              0, 0, NULL, q);
+				if (dp == 0)
+					break;
+				x -= p / dp;
+			}
+		}
+		z_re[k] = x;
+		z_im[k] = 0;
+
+		hrn_synthetic_div(a, rem_deg, x, 0, 0, NULL, a);
+		rem_deg--;
+	}
+
+	/* = Filling the output = */
+	/* A part below the precision asked for, like the real part of an
+	 * imaginary multiple root, is left from the other part and is 0. */
+	double tol = pow(10, -(double)precision);
+	for (unsigned int k = 0; k < deg; k++) {
+		double scale = process == HRN_SIGNIFICANT_DIGITS
+		                       ? fabs(z_re[k]) + fabs(z_im[k])
+		                       : 1;
+		if (fabs(z_re[k]) < tol * scale)
+			z_re[k] = 0;
+		if (fabs(z_im[k]) < tol * scale)
+			z_im[k] = 0;
+		hrn_r_ret[count].re = hrn_round(z_re[k], process, precision);
+		hrn_r_ret[count].im = hrn_round(z_im[k], process, precision);
+		count++;
+	}
+
+	/* = Cleanup = */
+	free(a);
+	free(z_re);
+	free(z_im);
+	free(w_re);
+	free(w_im);
+	free(is_ok);
+	free(group);
+	free(is_multiple);
+	free(q);
+
+	*n = count;
+	return hrn_r_ret;
+}
+
 #endif /* MRSPC_HORNER_IMPLEMENTATION */
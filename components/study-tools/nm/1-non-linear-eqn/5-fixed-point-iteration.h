@@ -127,7 +127,7 @@ int
 fp_iter_init(struct fp_iter_t *fp_iter_instance, char *fn_expr_str)
 {
 	/* tinyexpr */
-	te_variable fn_var[1] = { { "x", &(fp_iter_instance->fn_x) } };
+	te_variable fn_var[1] = { { "x", &(fp_iter_instance->fn_x), 0, NULL } };
 
 	int fn_expr_err;
 	fp_iter_instance->fn_expr =
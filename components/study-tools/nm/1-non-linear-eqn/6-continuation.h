@@ -0,0 +1,331 @@
+/*
+ ===============================================================================
+ |                                Dependencies                                 |
+ ===============================================================================
+ *
+ * -> tinyexpr
+ * -> sp-math.h
+ */
+
+/*
+ ===============================================================================
+ |                                    Usage                                    |
+ ===============================================================================
+ *
+ * Do this:
+ *
+ *         #define MRSPC_CONTINUATION_IMPLEMENTATION
+ *
+ * before you include this file in *one* C or C++ file to create the
+ * implementation.
+ */
+
+/*
+ ===============================================================================
+ |                                Example code                                 |
+ ===============================================================================
+ */
+#if 0
+#include <stdio.h>
+
+#define MRSPC_CONTINUATION_IMPLEMENTATION
+#include "6-continuation.h"
+
+int
+main(void)
+{
+	/* = Inputs for the continuation process = */
+	char *input_expr = "x^3 - a";               /* Input function */
+	float a_lower = 1, a_upper = 2;             /* Parameter range */
+	unsigned int a_steps = 5;                   /* Parameter steps */
+	float x_guess = 1;                          /* Guess for the first root */
+	enum cnt_process_t cnt_p = CNT_DECIMAL_PLACES; /* Process to execute */
+	int precision = 4, iter_c = 99; /* Precision and Max iterations count */
+
+	/* = Main process = */
+	printf("Evaluating:\n\t%s\n", input_expr);
+	struct cnt_t cnt_instance;
+	int          expr_err_loc = cnt_init(&cnt_instance, input_expr);
+	if (expr_err_loc != 0) {
+		fprintf(stderr, "\t%*s^\nError near here\n", expr_err_loc - 1,
+		        "");
+		exit(EXIT_FAILURE);
+	}
+
+	int                cnt_o_c;
+	struct cnt_output *cnt_o =
+		cnt_execute(&cnt_instance, a_lower, a_upper, a_steps, x_guess,
+	                    cnt_p, precision, iter_c, &cnt_o_c);
+
+	/* = Display output = */
+	for (int i = 0; i < cnt_o_c; i++)
+		printf("%d\t%.*g\t%.*g\t%.*g\t%d\n", i + 1, precision + 1,
+		       cnt_o[i].a, precision + 1, cnt_o[i].x, precision + 1,
+		       cnt_o[i].fn_x, cnt_o[i].iterations);
+
+	/* = Cleanup and Exit = */
+	cnt_instance_free(&cnt_instance);
+	free(cnt_o);
+	return 0;
+}
+#endif
+/* Output:
+ * Evaluating:
+ *         x^3 - a
+ * 1       1       1       0       2
+ * 2       1.2     1.0627  0       4
+ * 3       1.4     1.1187  0       3
+ * 4       1.6     1.1696  0       3
+ * 5       1.8     1.2164  0       3
+ * 6       2       1.2599  0       3
+ */
+
+/*
+ ===============================================================================
+ |                              HEADER-FILE MODE                               |
+ ===============================================================================
+ */
+
+#ifndef MRSPC_CONTINUATION_H
+#define MRSPC_CONTINUATION_H
+
+#include "../../../dep/tinyexpr.h"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+struct cnt_t {
+	te_expr      *fn_expr;
+	double        fn_x;         /* Current (last) value of `x` used in the
+	                               function. */
+	double        fn_a;         /* Current (last) value of `a` used in the
+	                               function. */
+	unsigned long fn_evals;     /* Times the function has been evaluated. */
+	unsigned long fn_evals_max; /* Where 'cnt_execute' stops, 0 for never. */
+};
+
+/* The process of getting root. */
+enum cnt_process_t {
+	CNT_ITERATIONS = 1,
+	CNT_DECIMAL_PLACES,
+	CNT_SIGNIFICANT_DIGITS,
+};
+
+struct cnt_output {
+	float a, x, fn_x;
+	int   iterations; /* Secant iterations spent on this parameter value. */
+};
+
+/*
+ ===============================================================================
+ |                            Function Declarations                            |
+ ===============================================================================
+ */
+int
+cnt_init(struct cnt_t *cnt_instance, char *fn_expr_str);
+/*
+ * Initialize continuation to use the given function expression of `x` and the
+ * parameter `a`.
+ *
+ * The expression is compiled only once here and reused for every parameter
+ * value in 'cnt_execute'.
+ *
+ * Returns 0 if there was no problem with the expression or >0 specifying the
+ * location where the problem was found.
+ */
+
+float
+cnt_point_val(struct cnt_t *cnt_instance, double point, double param);
+/* Calculate and return the value of the function at the given point. */
+
+struct cnt_output *
+cnt_execute(struct cnt_t *cnt_instance, float a_lower, float a_upper,
+            unsigned int a_steps, float x_guess, enum cnt_process_t process,
+            unsigned int precision, unsigned int iterations_c, int *n);
+/*
+ * Walks the parameter `a` from `a_lower` to `a_upper` in `a_steps` equal steps
+ * and returns the pointer to the array containing the root found for each
+ * value i.e. the root curve.
+ *
+ * The first root is found with the secant method starting from `x_guess`.
+ * Every next root is started from the root predicted by extrapolating the last
+ * two roots along `a`, so usually only a couple of secant iterations are
+ * needed per value.
+ *
+ * As the returned array is dynamically allocated, make sure to free it.
+ *
+ * `*n` is filled with the number of parameter values solved i.e.
+ * `a_steps + 1`, or fewer if the evaluations reached `fn_evals_max` in which
+ * case the last one may also be short of iterations.
+ *
+ * Precision specifies the count for the specified `process`.
+ *
+ * At most `iterations_c` iterations are performed per parameter value for all
+ * the `process`.
+ *
+ * Returns NULL if the array couldn't be allocated.
+ */
+
+void
+cnt_instance_free(struct cnt_t *cnt_instance);
+/*
+ * Destructor for the 'cnt_t'.
+ *
+ * Actually the 'te_expr' inside the struct is free'ed.
+ *
+ * This is safe to call on NULL pointers.
+ */
+
+#endif /* MRSPC_CONTINUATION_H */
+
+/*
+ ===============================================================================
+ |                             IMPLEMENTATION MODE                             |
+ ===============================================================================
+ */
+
+#ifdef MRSPC_CONTINUATION_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <math.h>
+
+#ifndef SPM_IMPLEMENTED /* Avoid sp-math.h's implementation twice. */
+#define SPM_IMPLEMENTATION
+#include "../../../dep/sp-math.h"
+#endif
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+int
+cnt_init(struct cnt_t *cnt_instance, char *fn_expr_str)
+{
+	/* tinyexpr */
+	te_variable fn_var[2] = { { "x", &(cnt_instance->fn_x), 0, NULL },
+		                  { "a", &(cnt_instance->fn_a), 0, NULL } };
+	cnt_instance->fn_evals     = 0;
+	cnt_instance->fn_evals_max = 0;
+
+	int fn_expr_err;
+	cnt_instance->fn_expr =
+		te_compile(fn_expr_str, fn_var, 2, &fn_expr_err);
+	if (!cnt_instance->fn_expr)
+		return fn_expr_err;
+
+	return 0;
+}
+
+float
+cnt_point_val(struct cnt_t *cnt_instance, double point, double param)
+{
+	cnt_instance->fn_x = point;
+	cnt_instance->fn_a = param;
+	cnt_instance->fn_evals++;
+
+	return te_eval(cnt_instance->fn_expr);
+}
+
+static int
+cnt_is_equal(float num1, float num2, enum cnt_process_t process,
+             unsigned int precision)
+{
+	if (process == CNT_ITERATIONS || process == CNT_DECIMAL_PLACES)
+		return spm_is_equal_deci(num1, num2, precision);
+
+	return spm_is_equal_signi(num1, num2, precision);
+}
+
+static float
+cnt_round(float num, enum cnt_process_t process, unsigned int precision)
+{
+	if (process == CNT_ITERATIONS || process == CNT_DECIMAL_PLACES)
+		return spm_round_off_d(num, precision + 1);
+	if (process == CNT_SIGNIFICANT_DIGITS)
+		return spm_signifi_d(num, precision + 1);
+
+	return num;
+}
+
+static int
+cnt_is_over(struct cnt_t *cnt_instance)
+{
+	return cnt_instance->fn_evals_max &&
+	       cnt_instance->fn_evals >= cnt_instance->fn_evals_max;
+}
+
+struct cnt_output *
+cnt_execute(struct cnt_t *cnt_instance, float a_lower, float a_upper,
+            unsigned int a_steps, float x_guess, enum cnt_process_t process,
+            unsigned int precision, unsigned int iterations_c, int *n)
+{
+	int                count = 0;
+	struct cnt_output *cnt_o_ret =
+		malloc((a_steps + 1) * sizeof(struct cnt_output));
+	if (cnt_o_ret == NULL) {
+		*n = 0;
+		return NULL;
+	}
+
+	double a_step = a_steps ? ((double)a_upper - a_lower) / a_steps : 0;
+	double root = x_guess, root_old = x_guess;
+
+	for (unsigned int k = 0; k <= a_steps; k++) {
+		if (cnt_is_over(cnt_instance))
+			break;
+		double a = a_lower + k * a_step;
+
+		/* = Predictor = */
+		/* Extrapolate the last two roots to the new parameter value; the
+		 * very first value has nothing to extrapolate from. */
+		double x0 = root;
+		double x1 = k > 1 ? 2 * root - root_old : root;
+		if (x1 == x0)
+			x1 = x0 + 1e-3 * (1 + fabs(x0));
+
+		/* = Corrector: secant iterations in `x` = */
+		double       fn_x0 = cnt_point_val(cnt_instance, x0, a);
+		double       fn_x1 = cnt_point_val(cnt_instance, x1, a);
+		unsigned int i     = 0;
+		while (i < iterations_c) {
+			i++;
+			if (fn_x1 == fn_x0)
+				break;
+
+			double x2 = x1 - fn_x1 * (x1 - x0) / (fn_x1 - fn_x0);
+			x0        = x1;
+			fn_x0     = fn_x1;
+			x1        = x2;
+			fn_x1     = cnt_point_val(cnt_instance, x1, a);
+
+			if (cnt_is_equal(x1, x0, process, precision) ||
+			    cnt_is_over(cnt_instance))
+				break;
+		}
+
+		root_old = root;
+		root     = x1;
+
+		/* filling the output */
+		cnt_o_ret[k].a          = cnt_round(a, process, precision);
+		cnt_o_ret[k].x          = cnt_round(root, process, precision);
+		cnt_o_ret[k].fn_x       = cnt_round(fn_x1, process, precision);
+		cnt_o_ret[k].iterations = i;
+
+		count++;
+	}
+
+	*n = count;
+	return cnt_o_ret;
+}
+
+void
+cnt_instance_free(struct cnt_t *cnt_instance)
+{
+	te_free(cnt_instance->fn_expr);
+}
+
+#endif /* MRSPC_CONTINUATION_IMPLEMENTATION */
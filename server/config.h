@@ -5,3 +5,99 @@
  */
 
 #define URI_STUDY_TOOLS "/api/components/study-tools"
+#define URI_SERVER      "/api/server"
+#define URI_METRICS     "/metrics" /* Where Prometheus scrapes */
+
+/*
+ ===============================================================================
+ |                                  Sessions                                   |
+ ===============================================================================
+ */
+
+#define SESSION_TTL_MS             (10 * 60 * 1000)  /* Idle time to expire */
+#define SESSION_SIZE_MAX           (16 * 1024 * 1024) /* Memory cap in bytes */
+#define SESSION_EXPIRE_INTERVAL_MS (30 * 1000)
+
+/*
+ ===============================================================================
+ |                                Result cache                                 |
+ ===============================================================================
+ */
+
+#define CACHE_SIZE_MAX  (32 * 1024 * 1024) /* Memory cap in bytes */
+#define CACHE_ENTRY_MAX (1024 * 1024)      /* Largest reply worth caching */
+
+/*
+ ===============================================================================
+ |                                   Workers                                   |
+ ===============================================================================
+ */
+
+#define WORKERS_COUNT 4 /* Threads running the solvers, see the -w flag */
+
+/* The solves wait in two lanes, interactive for the cheap ones and bulk for the
+ * costly ones and the problems of the batches. The interactive ones are taken
+ * LANE_WEIGHT_INTERACTIVE times as often, and get a worker of their own if
+ * there are several. */
+#define LANE_COST_INTERACTIVE   (64 * 1024) /* Most costly, see 's_cost' */
+#define LANE_WEIGHT_INTERACTIVE 4
+#define LANE_WEIGHT_BULK        1
+
+/*
+ ===============================================================================
+ |                                  Admission                                  |
+ ===============================================================================
+ */
+
+#define ADMIT_COST_MAX      (16 * 1024 * 1024) /* Being solved, see 's_cost' */
+#define ADMIT_RETRY_AFTER_S 1                  /* Sent when turned away */
+#define BUDGET_SOLVE_MS     (5 * 1000)         /* Wall clock per solve */
+#define BUDGET_EVALS        (1024 * 1024)      /* Evaluations per solve */
+#define PARAM_STEPS_MAX     (64 * 1024)        /* Steps of a continuation */
+
+/*
+ ===============================================================================
+ |                                 Event loops                                 |
+ ===============================================================================
+ */
+
+#define THREADS_COUNT 1 /* Event loops sharing the port, see the -t flag */
+#define LOOP_DONE_MAX 8 /* Solves replied to per poll, the rest after */
+
+/*
+ ===============================================================================
+ |                                  Streaming                                  |
+ ===============================================================================
+ */
+
+#define STREAM_ROWS        64               /* Iterations per reply chunk */
+#define STREAM_PENDING_MAX (4 * MG_IO_SIZE) /* Unsent, past which solves wait */
+#define STREAM_STALL_MS    (30 * 1000)      /* Waited on clients reading none */
+
+/*
+ ===============================================================================
+ |                                 Compression                                 |
+ ===============================================================================
+ */
+
+#define COMPRESS_SIZE_MIN 1024 /* Smaller replies are sent as they are */
+#define COMPRESS_LEVEL    4    /* From 1 (fastest) to 9 (smallest) */
+
+/*
+ ===============================================================================
+ |                                   Batches                                   |
+ ===============================================================================
+ */
+
+#define BATCH_PROBLEMS_MAX 64 /* Problems solved per batch request */
+
+/*
+ ===============================================================================
+ |                                Static assets                                |
+ ===============================================================================
+ */
+
+#define ASSETS_ROOT             "res"       /* Served from memory */
+#define ASSETS_PAGE_404         "/404.html" /* Asset sent for unknown paths */
+#define ASSETS_SYNC_INTERVAL_MS (2 * 1000)  /* Polling for changed files */
+#define ASSETS_FILE_MAX         (1 << 20)   /* Larger ones are sent from disk */
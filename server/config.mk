@@ -7,12 +7,12 @@ MANPREFIX = ${PREFIX}/share/man
 
 # Includes and Libs
 INCS =
-LIBS = -lm
+LIBS = -lm -pthread
 
 # Flags
-CPPFLAGS   = -DVERSION=\"${VERSION}\" -D_POSIX_C_SOURCE=199309L
+CPPFLAGS   = -DVERSION=\"${VERSION}\" -D_POSIX_C_SOURCE=200112L -D_DEFAULT_SOURCE -DMG_SOCK_LISTEN_BACKLOG_SIZE=1024
 EXTRAFLAGS = -g
-CFLAGS     = -std=c99 -pedantic -Wall -Wextra -Wno-deprecated-declarations ${EXTRAFLAGS} ${INCS} ${CPPFLAGS} ${RELEASEFLAGS}
+CFLAGS     = -std=c99 -pthread -pedantic -Wall -Wextra -Wno-deprecated-declarations ${EXTRAFLAGS} ${INCS} ${CPPFLAGS} ${RELEASEFLAGS}
 LDFLAGS    = ${LIBS}
 
 # Compiler and Linker
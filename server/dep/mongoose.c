@@ -395,6 +395,27 @@ void mg_call(struct mg_connection *c, int ev, void *ev_data) {
   if (c->pfn != NULL) c->pfn(c, ev, ev_data, c->pfn_data);
 }
 
+// With epoll, only the connections with an event or work left are visited by
+// mg_mgr_poll. Anything giving an idle one work puts it back in the list
+void mg_activate(struct mg_connection *c);
+void mg_activate(struct mg_connection *c) {
+#if MG_ENABLE_EPOLL
+  struct mg_mgr *mgr = c->mgr;
+  if (mgr == NULL || mgr->epoll_fd < 0 || c->is_active) return;
+  c->is_active = 1, c->next_active = mgr->active, mgr->active = c;
+#else
+  (void) c;
+#endif
+}
+
+// Clears is_full. What was read while it was set is handed to the handlers
+// again on the next poll, as an MG_EV_READ of no new bytes, so that the
+// requests held back in recv get parsed without waiting for more to come
+void mg_resume(struct mg_connection *c) {
+  c->is_full = 0, c->is_resuming = 1;
+  mg_activate(c);
+}
+
 void mg_error(struct mg_connection *c, const char *fmt, ...) {
   char mem[256], *buf = mem;
   va_list ap;
@@ -403,6 +424,7 @@ void mg_error(struct mg_connection *c, const char *fmt, ...) {
   va_end(ap);
   MG_ERROR(("%lu %p %s", c->id, c->fd, buf));
   c->is_closing = 1;             // Set is_closing before sending MG_EV_CALL
+  mg_activate(c);
   mg_call(c, MG_EV_ERROR, buf);  // Let user handler to override it
   if (buf != mem) free(buf);
 }
@@ -1280,7 +1302,7 @@ void mg_http_write_chunk(struct mg_connection *c, const char *buf, size_t len) {
 }
 
 // clang-format off
-static const char *mg_http_status_code_str(int status_code) {
+const char *mg_http_status_code_str(int status_code) {
   switch (status_code) {
     case 100: return "Continue";
     case 201: return "Created";
@@ -1294,7 +1316,11 @@ static const char *mg_http_status_code_str(int status_code) {
     case 401: return "Unauthorized";
     case 403: return "Forbidden";
     case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 416: return "Range Not Satisfiable";
     case 418: return "I'm a teapot";
+    case 429: return "Too Many Requests";
     case 500: return "Internal Server Error";
     case 501: return "Not Implemented";
     default: return "OK";
@@ -1348,7 +1374,56 @@ static void static_cb(struct mg_connection *c, int ev, void *ev_data,
   (void) ev_data;
 }
 
-static struct mg_str guess_content_type(struct mg_str path, const char *extra) {
+#if MG_ENABLE_SENDFILE && MG_ENABLE_EPOLL
+bool mg_sock_would_block(void);
+
+// Where sendfile_cb is in the file, kept in c->label. The length goes first,
+// as static_cb expects it, to fall back to it in the middle of a file
+struct sendfile_pos {
+  size_t cl;  // Left to send
+  off_t off;  // Next byte to send
+};
+
+// Sends the file from the page cache to the socket without copying it through
+// the send buffer. Waits for the headers to go out first, and for an epoll
+// edge once the socket is full
+static void sendfile_cb(struct mg_connection *c, int ev, void *ev_data,
+                        void *fn_data) {
+  if ((ev == MG_EV_WRITE || ev == MG_EV_POLL) && c->send.len == 0 &&
+      c->is_writable && !c->is_closing) {
+    struct mg_fd *fd = (struct mg_fd *) fn_data;
+    struct sendfile_pos *pos = (struct sendfile_pos *) c->label;
+    int sock = (int) (size_t) c->fd, in = fileno((FILE *) fd->fd);
+    while (pos->cl > 0) {
+      ssize_t n = sendfile(sock, in, &pos->off, pos->cl);
+      if (n > 0) {
+        pos->cl -= (size_t) n;
+      } else if (n < 0 && mg_sock_would_block()) {
+        c->is_writable = 0;
+        return;
+      } else if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+        // The file can't be mapped, copy it through the send buffer instead
+        fd->fs->sk(fd->fd, (size_t) pos->off);
+        c->pfn = static_cb;
+        return;
+      } else if (n == 0) {
+        mg_error(c, "file truncated");
+        return;
+      } else {
+        mg_error(c, "sendfile: %d", errno);
+        return;
+      }
+    }
+    restore_http_cb(c);
+  } else if (ev == MG_EV_CLOSE) {
+    restore_http_cb(c);
+  }
+  (void) ev_data;
+}
+#endif
+
+struct mg_str mg_http_guess_content_type(struct mg_str path,
+                                         const char *extra) {
   struct mg_str k, v, s = mg_str(extra);
   size_t i = 0;
 
@@ -1435,7 +1510,8 @@ void mg_http_serve_file(struct mg_connection *c, struct mg_http_message *hm,
   size_t size = 0;
   time_t mtime = 0;
   struct mg_str *inm = NULL;
-  struct mg_str mime = guess_content_type(mg_str(path), opts->mime_types);
+  struct mg_str mime =
+      mg_http_guess_content_type(mg_str(path), opts->mime_types);
   bool gzip = false;
 
   // If file does not exist, we try to open file PATH.gz - and if such
@@ -1450,7 +1526,7 @@ void mg_http_serve_file(struct mg_connection *c, struct mg_http_message *hm,
     } else if (opts->page404 != NULL) {
       // No precompressed file, serve 404
       fd = mg_fs_open(fs, opts->page404, MG_FS_READ);
-      mime = guess_content_type(mg_str(path), opts->mime_types);
+      mime = mg_http_guess_content_type(mg_str(path), opts->mime_types);
       path = opts->page404;
     }
   }
@@ -1505,6 +1581,13 @@ void mg_http_serve_file(struct mg_connection *c, struct mg_http_message *hm,
       c->pfn = static_cb;
       c->pfn_data = fd;
       *(size_t *) c->label = (size_t) cl;  // Track to-be-sent content length
+#if MG_ENABLE_SENDFILE && MG_ENABLE_EPOLL
+      if (fs == &mg_fs_posix && !c->is_tls && c->mgr->epoll_fd >= 0) {
+        struct sendfile_pos *pos = (struct sendfile_pos *) c->label;
+        pos->off = (off_t) r1;
+        c->pfn = sendfile_cb;
+      }
+#endif
     }
   }
 }
@@ -1888,6 +1971,8 @@ static void http_cb(struct mg_connection *c, int ev, void *evd, void *fnd) {
   if (ev == MG_EV_READ || ev == MG_EV_CLOSE) {
     struct mg_http_message hm;
     while (c->recv.buf != NULL && c->recv.len > 0) {
+      // The user is still replying to the last one, see mg_resume()
+      if (c->is_full) break;
       int n = mg_http_parse((char *) c->recv.buf, c->recv.len, &hm);
       bool is_chunked = n > 0 && mg_is_chunked(&hm);
       if (ev == MG_EV_CLOSE) {
@@ -1952,6 +2037,7 @@ struct mg_connection *mg_http_listen(struct mg_mgr *mgr, const char *url,
 
 #include <string.h>
 
+#if MG_IOBUF_WIPE
 // Not using memset for zeroing memory, cause it can be dropped by compiler
 // See https://github.com/cesanta/mongoose/pull/1265
 static void zeromem(volatile unsigned char *buf, size_t len) {
@@ -1959,6 +2045,9 @@ static void zeromem(volatile unsigned char *buf, size_t len) {
     while (len--) *buf++ = 0;
   }
 }
+#else
+#define zeromem(buf, len) ((void) (buf), (void) (len))
+#endif
 
 int mg_iobuf_resize(struct mg_iobuf *io, size_t new_size) {
   int ok = 1;
@@ -2145,8 +2234,11 @@ int mg_json_get(const char *s, int len, const char *path, int *toklen) {
           int n = mg_pass_string(&s[i + 1], len - i - 1);
           if (n < 0) return n;
           // printf("K[%.*s] %d %d\n", n, &s[i + 1], depth, ed);
+          // The whole key must match, not just be a prefix of the path
           if (depth == ed && path[pos - 1] == '.' &&
-              memcmp(&s[i + 1], &path[pos], (size_t) n) == 0) {
+              strncmp(&s[i + 1], &path[pos], (size_t) n) == 0 &&
+              (path[pos + n] == '\0' || path[pos + n] == '.' ||
+               path[pos + n] == '[')) {
             pos += n;
           }
           i += n + 1;
@@ -2206,7 +2298,7 @@ bool mg_json_get_bool(struct mg_str json, const char *path, bool *v) {
   return found;
 }
 
-static bool json_unescape(const char *s, size_t len, char *to, size_t n) {
+bool mg_json_unescape(const char *s, size_t len, char *to, size_t n) {
   size_t i, j;
   for (i = 0, j = 0; i < len && j < n; i++, j++) {
     if (s[i] == '\\' && i + 5 < len && s[i + 1] == 'u') {
@@ -2237,7 +2329,7 @@ char *mg_json_get_str(struct mg_str json, const char *path) {
   if ((n = mg_json_get(json.ptr, (int) json.len, path, &toklen)) >= 0 &&
       json.ptr[n] == '"') {
     if ((result = (char *) calloc(1, (size_t) toklen)) != NULL &&
-        !json_unescape(json.ptr + n + 1, (size_t) (toklen - 2), result,
+        !mg_json_unescape(json.ptr + n + 1, (size_t) (toklen - 2), result,
                        (size_t) toklen)) {
       free(result);
       result = NULL;
@@ -2972,8 +3064,17 @@ bool mg_aton(struct mg_str str, struct mg_addr *addr) {
 }
 
 struct mg_connection *mg_alloc_conn(struct mg_mgr *mgr) {
-  struct mg_connection *c =
-      (struct mg_connection *) calloc(1, sizeof(*c) + mgr->extraconnsize);
+  struct mg_connection *c = mgr->pool;
+  if (c != NULL) {
+    // Keep the buffers, they're likely to grow to the same size again
+    struct mg_iobuf recv = c->recv, send = c->send;
+    mgr->pool = c->next;
+    if (--mgr->pool_len < mgr->pool_low) mgr->pool_low = mgr->pool_len;
+    memset(c, 0, sizeof(*c) + mgr->extraconnsize);
+    c->recv = recv, c->send = send;
+  } else {
+    c = (struct mg_connection *) calloc(1, sizeof(*c) + mgr->extraconnsize);
+  }
   if (c != NULL) {
     c->mgr = mgr;
     c->id = ++mgr->nextid;
@@ -2981,6 +3082,39 @@ struct mg_connection *mg_alloc_conn(struct mg_mgr *mgr) {
   return c;
 }
 
+static void mg_free_conn(struct mg_connection *c) {
+  struct mg_mgr *mgr = c->mgr;
+  if (MG_IOBUF_WIPE || c->recv.size > MG_CONN_POOL_BUF_MAX)
+    mg_iobuf_free(&c->recv);
+  if (MG_IOBUF_WIPE || c->send.size > MG_CONN_POOL_BUF_MAX)
+    mg_iobuf_free(&c->send);
+  if (mgr->pool_len < MG_CONN_POOL_SIZE) {
+    c->recv.len = c->send.len = 0;
+    c->next = mgr->pool;
+    mgr->pool = c;
+    mgr->pool_len++;
+  } else {
+    mg_iobuf_free(&c->recv);
+    mg_iobuf_free(&c->send);
+    memset(c, 0, sizeof(*c));
+    free(c);
+  }
+}
+
+// Free the pooled connections that no allocation needed since the last trim
+static void mg_trim_conns(struct mg_mgr *mgr, uint64_t now) {
+  if (now < mgr->pool_trim) return;
+  for (; mgr->pool_low > 0; mgr->pool_low--, mgr->pool_len--) {
+    struct mg_connection *c = mgr->pool;
+    mgr->pool = c->next;
+    mg_iobuf_free(&c->recv);
+    mg_iobuf_free(&c->send);
+    free(c);
+  }
+  mgr->pool_low = mgr->pool_len;
+  mgr->pool_trim = now + MG_CONN_POOL_TRIM_MS;
+}
+
 void mg_close_conn(struct mg_connection *c) {
   mg_resolve_cancel(c);  // Close any pending DNS query
   LIST_DELETE(struct mg_connection, &c->mgr->conns, c);
@@ -2992,10 +3126,7 @@ void mg_close_conn(struct mg_connection *c) {
   MG_DEBUG(("%lu closed", c->id));
 
   mg_tls_free(c);
-  mg_iobuf_free(&c->recv);
-  mg_iobuf_free(&c->send);
-  memset(c, 0, sizeof(*c));
-  free(c);
+  mg_free_conn(c);
 }
 
 struct mg_connection *mg_connect(struct mg_mgr *mgr, const char *url,
@@ -3019,6 +3150,28 @@ struct mg_connection *mg_connect(struct mg_mgr *mgr, const char *url,
   return c;
 }
 
+#if MG_ENABLE_EPOLL
+// Register once for every event. Stream readiness is edge-triggered, so the
+// is_readable/is_writable flags stay set till an I/O call would block. UDP
+// sockets may be blocking, they're level-triggered and read once per poll
+static void mg_epoll_add(struct mg_connection *c) {
+  struct epoll_event ev;
+  int fd = (int) (size_t) c->fd;
+  if (c->mgr->epoll_fd < 0 || fd < 0) return;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = c->is_udp ? EPOLLIN : EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  ev.data.ptr = c;
+  if (epoll_ctl(c->mgr->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+    MG_ERROR(("%lu epoll_ctl: %d", c->id, errno));
+  }
+  mg_activate(c);
+}
+#define mg_epoll_on(mgr) ((mgr)->epoll_fd >= 0)
+#else
+#define mg_epoll_add(c)
+#define mg_epoll_on(mgr) false
+#endif
+
 struct mg_connection *mg_listen(struct mg_mgr *mgr, const char *url,
                                 mg_event_handler_t fn, void *fn_data) {
   struct mg_connection *c = NULL;
@@ -3026,7 +3179,7 @@ struct mg_connection *mg_listen(struct mg_mgr *mgr, const char *url,
     MG_ERROR(("OOM %s", url));
   } else if (!mg_open_listener(c, url)) {
     MG_ERROR(("Failed: %s, errno %d", url, errno));
-    free(c);
+    mg_free_conn(c);
     c = NULL;
   } else {
     c->is_listening = 1;
@@ -3034,6 +3187,7 @@ struct mg_connection *mg_listen(struct mg_mgr *mgr, const char *url,
     LIST_ADD_HEAD(struct mg_connection, &mgr->conns, c);
     c->fn = fn;
     c->fn_data = fn_data;
+    mg_epoll_add(c);
     mg_call(c, MG_EV_OPEN, NULL);
     MG_DEBUG(("%lu %p %s", c->id, c->fd, url));
   }
@@ -3047,6 +3201,7 @@ struct mg_connection *mg_wrapfd(struct mg_mgr *mgr, int fd,
     c->fd = (void *) (size_t) fd;
     c->fn = fn;
     c->fn_data = fn_data;
+    mg_epoll_add(c);
     mg_call(c, MG_EV_OPEN, NULL);
     LIST_ADD_HEAD(struct mg_connection, &mgr->conns, c);
   }
@@ -3065,10 +3220,19 @@ void mg_mgr_free(struct mg_mgr *mgr) {
   struct mg_timer *tmp, *t = mgr->timers;
   while (t != NULL) tmp = t->next, free(t), t = tmp;
   mgr->timers = NULL;  // Important. Next call to poll won't touch timers
-  for (c = mgr->conns; c != NULL; c = c->next) c->is_closing = 1;
+  for (c = mgr->conns; c != NULL; c = c->next) {
+    c->is_closing = 1;
+    mg_activate(c);
+  }
   mg_mgr_poll(mgr, 0);
+  mgr->pool_low = mgr->pool_len, mgr->pool_trim = 0;
+  mg_trim_conns(mgr, 0);
 #if MG_ARCH == MG_ARCH_FREERTOS_TCP
   FreeRTOS_DeleteSocketSet(mgr->ss);
+#endif
+#if MG_ENABLE_EPOLL
+  if (mgr->epoll_fd >= 0) close(mgr->epoll_fd);
+  mgr->epoll_fd = -1;
 #endif
   MG_DEBUG(("All connections closed"));
 }
@@ -3085,6 +3249,13 @@ void mg_mgr_init(struct mg_mgr *mgr) {
   // Ignore SIGPIPE signal, so if client cancels the request, it
   // won't kill the whole process.
   signal(SIGPIPE, SIG_IGN);
+#endif
+#if MG_ENABLE_EPOLL
+  // TLS keeps decrypted data the kernel doesn't know about, leave it to poll
+  mgr->epoll_fd = MG_ENABLE_MBEDTLS || MG_ENABLE_OPENSSL
+                      ? -1
+                      : epoll_create1(EPOLL_CLOEXEC);
+  if (mgr->epoll_fd < 0) MG_DEBUG(("epoll disabled, using poll/select"));
 #endif
   mgr->dnstimeout = 3000;
   mgr->dns4.url = "udp://8.8.8.8:53";
@@ -3558,6 +3729,7 @@ bool mg_send(struct mg_connection *c, const void *buf, size_t len) {
     iolog(c, (char *) buf, n, false);
     return n > 0;
   } else {
+    mg_activate(c);
     return mg_iobuf_add(&c->send, c->send.len, buf, len, MG_IO_SIZE);
   }
 }
@@ -3628,6 +3800,14 @@ bool mg_open_listener(struct mg_connection *c, const char *url) {
       //    but won't work! (setsockopt will return EINVAL)
       MG_ERROR(("reuseaddr: %d", MG_SOCK_ERRNO));
 #endif
+#if defined(SO_REUSEPORT)
+    } else if (c->mgr->reuseport &&
+               setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (char *) &on,
+                          sizeof(on)) != 0) {
+      // Lets several managers listen on the same port, the kernel then
+      // spreads the incoming connections across them
+      MG_ERROR(("reuseport: %d", MG_SOCK_ERRNO));
+#endif
 #if MG_ARCH == MG_ARCH_WIN32 && !defined(SO_EXCLUSIVEADDRUSE) && !defined(WINCE)
     } else if (setsockopt(fd, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (char *) &on,
                           sizeof(on)) != 0) {
@@ -3681,6 +3861,7 @@ static void read_conn(struct mg_connection *c) {
     MG_DEBUG(("%lu %p %d:%d %ld err %d", c->id, c->fd, (int) c->send.len,
               (int) c->recv.len, n, MG_SOCK_ERRNO));
     iolog(c, buf, n, true);
+    if (mg_epoll_on(c->mgr) && (n == 0 || c->is_udp)) c->is_readable = 0;
   }
 }
 
@@ -3691,6 +3872,9 @@ static void write_conn(struct mg_connection *c) {
   MG_DEBUG(("%lu %p %d:%d %ld err %d", c->id, c->fd, (int) c->send.len,
             (int) c->recv.len, n, MG_SOCK_ERRNO));
   iolog(c, buf, n, false);
+  // A short write means the socket buffer is full, wait for the next edge
+  if (mg_epoll_on(c->mgr) && (n == 0 || (n > 0 && (size_t) n < len)))
+    c->is_writable = 0;
 }
 
 static void close_conn(struct mg_connection *c) {
@@ -3728,6 +3912,7 @@ void mg_connect_resolved(struct mg_connection *c) {
   // mg_straddr(&c->rem, buf, sizeof(buf));
   c->fd = S2PTR(socket(af, type, 0));
   c->is_resolving = 0;
+  mg_epoll_add(c);
   if (FD(c) == INVALID_SOCKET) {
     mg_error(c, "socket(): %d", MG_SOCK_ERRNO);
   } else if (c->is_udp) {
@@ -3764,7 +3949,9 @@ static void accept_conn(struct mg_mgr *mgr, struct mg_connection *lsn) {
   union usa usa;
   socklen_t sa_len = sizeof(usa);
   SOCKET fd = raccept(FD(lsn), &usa, sa_len);
-  if (fd == INVALID_SOCKET) {
+  if (fd == INVALID_SOCKET && mg_epoll_on(mgr) && mg_sock_would_block()) {
+    lsn->is_readable = 0;  // Backlog drained, wait for the next edge
+  } else if (fd == INVALID_SOCKET) {
 #if MG_ARCH == MG_ARCH_AZURERTOS
     // AzureRTOS, in non-block socket mode can mark listening socket readable
     // even it is not. See comment for 'select' func implementation in
@@ -3790,6 +3977,7 @@ static void accept_conn(struct mg_mgr *mgr, struct mg_connection *lsn) {
     c->fd = S2PTR(fd);
     mg_set_non_blocking_mode(FD(c));
     setsockopts(c);
+    mg_epoll_add(c);
     c->is_accepted = 1;
     c->is_hexdumping = lsn->is_hexdumping;
     c->loc = lsn->loc;
@@ -3873,7 +4061,39 @@ static bool skip_iotest(const struct mg_connection *c) {
          (can_read(c) == false && can_write(c) == false);
 }
 
+#if MG_ENABLE_EPOLL
+static void mg_epoll_iotest(struct mg_mgr *mgr, int ms) {
+  struct epoll_event evs[MG_EPOLL_EVENTS];
+  struct mg_connection *c;
+  int i, n;
+
+  // Flags left set by the last poll mean there's I/O to do without waiting
+  for (c = mgr->active; c != NULL && ms > 0; c = c->next_active) {
+    if (c->is_resolving) continue;
+    if (c->is_closing || c->is_resuming || (c->is_readable && can_read(c)) ||
+        (c->is_writable && can_write(c)))
+      ms = 0;
+  }
+
+  n = epoll_wait(mgr->epoll_fd, evs, MG_EPOLL_EVENTS, ms);
+  if (n < 0 && errno != EINTR) MG_ERROR(("epoll_wait: %d", errno));
+  for (i = 0; i < n; i++) {
+    uint32_t e = evs[i].events;
+    c = (struct mg_connection *) evs[i].data.ptr;
+    if (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) c->is_readable = 1;
+    if (e & (EPOLLOUT | EPOLLHUP | EPOLLERR)) c->is_writable = 1;
+    mg_activate(c);
+  }
+}
+#endif
+
 static void mg_iotest(struct mg_mgr *mgr, int ms) {
+#if MG_ENABLE_EPOLL
+  if (mg_epoll_on(mgr)) {
+    mg_epoll_iotest(mgr, ms);
+    return;
+  }
+#endif
 #if MG_ARCH == MG_ARCH_FREERTOS_TCP
   struct mg_connection *c;
   for (c = mgr->conns; c != NULL; c = c->next) {
@@ -3909,6 +4129,7 @@ static void mg_iotest(struct mg_mgr *mgr, int ms) {
       n++;
       if (mg_tls_pending(c) > 0) ms = 0;  // Don't wait if TLS is ready
     }
+    if (c->is_resuming) ms = 0;
   }
 
   if (poll(fds, n, ms) < 0) {
@@ -3942,7 +4163,7 @@ static void mg_iotest(struct mg_mgr *mgr, int ms) {
     if (skip_iotest(c)) continue;
     if (can_read(c)) FD_SET(FD(c), &rset);
     if (can_write(c)) FD_SET(FD(c), &wset);
-    if (mg_tls_pending(c) > 0) tv = tv_zero;
+    if (mg_tls_pending(c) > 0 || c->is_resuming) tv = tv_zero;
     if (FD(c) > maxfd) maxfd = FD(c);
   }
 
@@ -3982,6 +4203,52 @@ static void connect_conn(struct mg_connection *c) {
   }
 }
 
+// Returns false if the connection was closed
+static bool mg_poll_conn(struct mg_mgr *mgr, struct mg_connection *c,
+                         uint64_t *now) {
+  mg_call(c, MG_EV_POLL, now);
+  MG_VERBOSE(("%lu %c%c %c%c%c%c%c", c->id, c->is_readable ? 'r' : '-',
+              c->is_writable ? 'w' : '-', c->is_tls ? 'T' : 't',
+              c->is_connecting ? 'C' : 'c', c->is_tls_hs ? 'H' : 'h',
+              c->is_resolving ? 'R' : 'r', c->is_closing ? 'C' : 'c'));
+  if (c->is_resolving || c->is_closing) {
+    // Do nothing
+  } else if (c->is_listening && c->is_udp == 0) {
+    if (c->is_readable) accept_conn(mgr, c);
+  } else if (c->is_connecting) {
+    if (c->is_readable || c->is_writable) connect_conn(c);
+  } else if (c->is_tls_hs) {
+    if ((c->is_readable || c->is_writable)) mg_tls_handshake(c);
+  } else {
+    if (c->is_resuming) {
+      struct mg_str evd = mg_str_n("", 0);
+      c->is_resuming = 0;
+      mg_call(c, MG_EV_READ, &evd);
+    }
+    if (c->is_readable && can_read(c)) read_conn(c);
+    if (c->is_writable && can_write(c)) write_conn(c);
+  }
+
+  if (c->is_draining && c->send.len == 0) c->is_closing = 1;
+  if (c->is_closing == 0) return true;
+  close_conn(c);
+  return false;
+}
+
+#if MG_ENABLE_EPOLL
+// Work a connection has left that no epoll event is going to report: I/O
+// flags still set, a pending connect or DNS query, or a file being sent
+static bool mg_has_work(const struct mg_connection *c) {
+  return c->is_draining || c->is_resolving || c->is_connecting ||
+         c->is_tls_hs || c->is_resuming || (c->is_readable && can_read(c)) ||
+         (c->is_writable && can_write(c)) || c->pfn == static_cb ||
+#if MG_ENABLE_SENDFILE
+         c->pfn == sendfile_cb ||
+#endif
+         (c->pfn == dns_cb && c->mgr->active_dns_requests != NULL);
+}
+#endif
+
 void mg_mgr_poll(struct mg_mgr *mgr, int ms) {
   struct mg_connection *c, *tmp;
   uint64_t now;
@@ -3989,29 +4256,28 @@ void mg_mgr_poll(struct mg_mgr *mgr, int ms) {
   mg_iotest(mgr, ms);
   now = mg_millis();
   mg_timer_poll(&mgr->timers, now);
-
+  mg_trim_conns(mgr, now);
+
+#if MG_ENABLE_EPOLL
+  // Idle connections are left out, so they get no MG_EV_POLL either. A
+  // visited one stays in the list while it has work left
+  if (mg_epoll_on(mgr)) {
+    tmp = mgr->active, mgr->active = NULL;
+    while ((c = tmp) != NULL) {
+      tmp = c->next_active;
+      if (!mg_poll_conn(mgr, c, &now)) continue;
+      if (mg_has_work(c)) {
+        c->next_active = mgr->active, mgr->active = c;
+      } else {
+        c->is_active = 0;
+      }
+    }
+    return;
+  }
+#endif
   for (c = mgr->conns; c != NULL; c = tmp) {
     tmp = c->next;
-    mg_call(c, MG_EV_POLL, &now);
-    MG_VERBOSE(("%lu %c%c %c%c%c%c%c", c->id, c->is_readable ? 'r' : '-',
-                c->is_writable ? 'w' : '-', c->is_tls ? 'T' : 't',
-                c->is_connecting ? 'C' : 'c', c->is_tls_hs ? 'H' : 'h',
-                c->is_resolving ? 'R' : 'r', c->is_closing ? 'C' : 'c'));
-    if (c->is_resolving || c->is_closing) {
-      // Do nothing
-    } else if (c->is_listening && c->is_udp == 0) {
-      if (c->is_readable) accept_conn(mgr, c);
-    } else if (c->is_connecting) {
-      if (c->is_readable || c->is_writable) connect_conn(c);
-    } else if (c->is_tls_hs) {
-      if ((c->is_readable || c->is_writable)) mg_tls_handshake(c);
-    } else {
-      if (c->is_readable) read_conn(c);
-      if (c->is_writable) write_conn(c);
-    }
-
-    if (c->is_draining && c->send.len == 0) c->is_closing = 1;
-    if (c->is_closing) close_conn(c);
+    mg_poll_conn(mgr, c, &now);
   }
 }
 #endif
@@ -6568,6 +6834,7 @@ void mg_mgr_poll(struct mg_mgr *mgr, int ms) {
   uint64_t now = mg_millis();
   mip_poll((struct mip_if *) mgr->priv, now);
   mg_timer_poll(&mgr->timers, now);
+  mg_trim_conns(mgr, now);
   for (c = mgr->conns; c != NULL; c = tmp) {
     tmp = c->next;
     if (c->send.len > 0) write_conn(c);
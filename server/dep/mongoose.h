@@ -416,6 +416,14 @@ extern int SockSet(SOCKET hSock, int Type, int Prop, void *pbuf, int size);
 #define MG_ENABLE_POLL 1
 #endif
 
+#if !defined(MG_ENABLE_EPOLL) && defined(__linux__)
+#define MG_ENABLE_EPOLL 1
+#endif
+
+#if !defined(MG_ENABLE_SENDFILE) && defined(__linux__)
+#define MG_ENABLE_SENDFILE 1
+#endif
+
 #include <arpa/inet.h>
 #include <ctype.h>
 #include <dirent.h>
@@ -439,6 +447,12 @@ extern int SockSet(SOCKET hSock, int Type, int Prop, void *pbuf, int size);
 #else
 #include <sys/select.h>
 #endif
+#if defined(MG_ENABLE_EPOLL) && MG_ENABLE_EPOLL
+#include <sys/epoll.h>
+#endif
+#if defined(MG_ENABLE_SENDFILE) && MG_ENABLE_SENDFILE
+#include <sys/sendfile.h>
+#endif
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -588,6 +602,22 @@ int sscanf(const char *, const char *, ...);
 #define MG_ENABLE_POLL 0
 #endif
 
+// Edge-triggered epoll with persistent registrations. Falls back to the
+// poll/select code at run time if the epoll instance can't be created
+#ifndef MG_ENABLE_EPOLL
+#define MG_ENABLE_EPOLL 0
+#endif
+
+#ifndef MG_EPOLL_EVENTS
+#define MG_EPOLL_EVENTS 64  // Max events taken by a single epoll_wait()
+#endif
+
+// Serve posix files with sendfile(2) on plain connections. It's woken up by
+// the epoll edges, so it's only used while epoll is on
+#ifndef MG_ENABLE_SENDFILE
+#define MG_ENABLE_SENDFILE 0
+#endif
+
 #ifndef MG_ENABLE_FATFS
 #define MG_ENABLE_FATFS 0
 #endif
@@ -651,6 +681,27 @@ int sscanf(const char *, const char *, ...);
 #define MG_MAX_RECV_SIZE (3 * 1024 * 1024)
 #endif
 
+// Zero the IO buffers before freeing or shrinking them, not to leave secrets
+// behind in the heap. Off without TLS, when there are none to leave
+#ifndef MG_IOBUF_WIPE
+#define MG_IOBUF_WIPE (MG_ENABLE_MBEDTLS || MG_ENABLE_OPENSSL)
+#endif
+
+// Closed connections are kept by their manager for the next ones to reuse,
+// along with their IO buffers. The pool gives back what went unused for a
+// trim period, so it shrinks again after a burst of connections
+#ifndef MG_CONN_POOL_SIZE
+#define MG_CONN_POOL_SIZE 256  // Max pooled connections per manager, 0 off
+#endif
+
+#ifndef MG_CONN_POOL_BUF_MAX
+#define MG_CONN_POOL_BUF_MAX (8 * MG_IO_SIZE)  // Larger buffers aren't kept
+#endif
+
+#ifndef MG_CONN_POOL_TRIM_MS
+#define MG_CONN_POOL_TRIM_MS 1000
+#endif
+
 #ifndef MG_MAX_HTTP_HEADERS
 #define MG_MAX_HTTP_HEADERS 40
 #endif
@@ -974,6 +1025,15 @@ struct mg_mgr {
   struct mg_timer *timers;      // Active timers
   void *priv;                   // Used by the experimental stack
   size_t extraconnsize;         // Used by the experimental stack
+  bool reuseport;               // Listeners share the port, see SO_REUSEPORT
+  struct mg_connection *pool;   // Closed connections kept for reuse
+  size_t pool_len;              // Number of them
+  size_t pool_low;              // Fewest pooled since the last trim
+  uint64_t pool_trim;           // When to free the ones that went unused
+#if MG_ENABLE_EPOLL
+  int epoll_fd;                  // epoll instance, or -1 to use poll/select
+  struct mg_connection *active;  // Ones to visit on the next poll
+#endif
 #if MG_ARCH == MG_ARCH_FREERTOS_TCP
   SocketSet_t ss;  // NOTE(lsm): referenced from socket struct
 #endif
@@ -1006,9 +1066,13 @@ struct mg_connection {
   unsigned is_hexdumping : 1;  // Hexdump in/out traffic
   unsigned is_draining : 1;    // Send remaining data, then close and free
   unsigned is_closing : 1;     // Close and free the connection immediately
-  unsigned is_full : 1;        // Stop reads, until cleared
+  unsigned is_full : 1;        // Stop reads and HTTP parsing, see mg_resume()
   unsigned is_readable : 1;    // Connection is ready to read
   unsigned is_writable : 1;    // Connection is ready to write
+  unsigned is_active : 1;      // In mgr->active, or being visited
+  unsigned is_resuming : 1;    // Go over recv again on the next poll
+
+  struct mg_connection *next_active;  // Linkage in struct mg_mgr :: active
 };
 
 void mg_mgr_poll(struct mg_mgr *, int ms);
@@ -1023,6 +1087,7 @@ struct mg_connection *mg_wrapfd(struct mg_mgr *mgr, int fd,
                                 mg_event_handler_t fn, void *fn_data);
 void mg_connect_resolved(struct mg_connection *);
 bool mg_send(struct mg_connection *, const void *, size_t);
+void mg_resume(struct mg_connection *);
 size_t mg_printf(struct mg_connection *, const char *fmt, ...);
 size_t mg_vprintf(struct mg_connection *, const char *fmt, va_list ap);
 char *mg_straddr(struct mg_addr *, char *, size_t);
@@ -1088,6 +1153,9 @@ void mg_http_serve_dir(struct mg_connection *, struct mg_http_message *hm,
                        const struct mg_http_serve_opts *);
 void mg_http_serve_file(struct mg_connection *, struct mg_http_message *hm,
                         const char *path, const struct mg_http_serve_opts *);
+struct mg_str mg_http_guess_content_type(struct mg_str path,
+                                         const char *extra);
+const char *mg_http_status_code_str(int status_code);
 void mg_http_reply(struct mg_connection *, int status_code, const char *headers,
                    const char *body_fmt, ...);
 struct mg_str *mg_http_get_header(struct mg_http_message *, const char *name);
@@ -1310,6 +1378,7 @@ int mg_json_get(const char *buf, int len, const char *path, int *toklen);
 bool mg_json_get_num(struct mg_str json, const char *path, double *v);
 bool mg_json_get_bool(struct mg_str json, const char *path, bool *v);
 char *mg_json_get_str(struct mg_str json, const char *path);
+bool mg_json_unescape(const char *s, size_t len, char *to, size_t n);
 char *mg_json_get_hex(struct mg_str json, const char *path);
 
 
@@ -0,0 +1,550 @@
+/*
+ ===============================================================================
+ |                                Dependencies                                 |
+ ===============================================================================
+ *
+ * -> mongoose
+ * -> deflate (lib/deflate.h)
+ * -> pthreads
+ */
+
+/*
+ ===============================================================================
+ |                                    Usage                                    |
+ ===============================================================================
+ *
+ * Do this:
+ *
+ *         #define MRSPS_ASSETS_IMPLEMENTATION
+ *
+ * before you include this file in *one* C or C++ file to create the
+ * implementation.
+ *
+ * An in-memory copy of a directory of static files, looked up by request path.
+ * Every file is kept along with its gzip and deflate encodings, when smaller,
+ * and an ETag per encoding derived from its contents.
+ *
+ * The encodings are taken from the files with the '.gz' and '.zz' suffixes
+ * next to the file if there are any not older than it, as 'tools/pack.c'
+ * writes, and compressed at load otherwise.
+ *
+ * 'ast_sync' reloads the files changed on disk since the last call, so serving
+ * an asset never touches the filesystem.
+ *
+ * Files larger than the store's `file_max` are only listed, without a body, to
+ * be sent from disk with 'mg_http_serve_file' instead.
+ */
+
+/*
+ ===============================================================================
+ |                              HEADER-FILE MODE                               |
+ ===============================================================================
+ */
+
+#ifndef MRSPS_ASSETS_H
+#define MRSPS_ASSETS_H
+
+#include <pthread.h>
+
+#include "../dep/mongoose.h"
+#include "deflate.h"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* = Options = */
+#define AST_BUCKETS   256
+#define AST_DEPTH_MAX 8  /* Deepest subdirectory loaded. */
+#define AST_ETAG_LEN  21 /* Quoted 64-bit hex and the encoding suffix. */
+
+enum ast_enc_t {
+	AST_IDENTITY = 0,
+	AST_GZIP,
+	AST_DEFLATE,
+	AST_ENC_C,
+};
+
+struct ast_asset {
+	char         *path; /* Request path, starting with '/'. */
+	size_t        path_len;
+	uint64_t      hash;
+	struct mg_str mime;
+	size_t        size; /* On disk, to notice changes. */
+	time_t        mtime;
+	struct mg_str bodies[AST_ENC_C]; /* Encodings empty if not smaller. */
+	                                 /* All NULL if the file's on disk. */
+	char          etags[AST_ENC_C][AST_ETAG_LEN + 1];
+	unsigned int  gen; /* Sync that last saw the file. */
+
+	struct ast_asset *next; /* Linkage in the bucket. */
+};
+
+struct ast_store {
+	struct mg_fs     *fs;
+	char              root[MG_PATH_MAX];
+	struct ast_asset *buckets[AST_BUCKETS];
+	unsigned int      count, gen;
+	size_t            size;     /* Bytes held by the bodies. */
+	size_t            file_max; /* Largest file held in memory, 0 for all. */
+};
+
+/*
+ ===============================================================================
+ |                            Function Declarations                            |
+ ===============================================================================
+ */
+void
+ast_init(struct ast_store *store, struct mg_fs *fs, const char *root,
+         size_t file_max);
+/*
+ * Initialize an empty store for the files under the `root` directory. Files
+ * larger than `file_max` bytes are left on disk, none are if it's 0.
+ */
+
+unsigned int
+ast_sync(struct ast_store *store, pthread_rwlock_t *lock);
+/*
+ * Load the files added or changed since the last sync and drop the removed
+ * ones. The files are read and compressed without holding `lock`, it's only
+ * taken for writing to swap the assets in. It may be NULL.
+ *
+ * Should only be called from one thread at a time.
+ *
+ * Returns the number of assets changed.
+ */
+
+int
+ast_is_on_disk(const struct ast_asset *asset);
+/* Whether the asset is too large to be held and has to be sent from disk. */
+
+const struct ast_asset *
+ast_find(const struct ast_store *store, struct mg_str path);
+/*
+ * Return the asset for the request path, or NULL if there is none. A directory
+ * maps to its 'index.html'.
+ *
+ * The asset stays valid till the next sync.
+ */
+
+enum ast_enc_t
+ast_negotiate(const struct ast_asset *asset,
+              const struct mg_str    *accept_encoding);
+/*
+ * Pick the encoding of the asset the 'Accept-Encoding' header value rates the
+ * highest, gzip first on ties. `accept_encoding` may be NULL.
+ */
+
+double
+ast_accept_q(const struct mg_str *accept, const char *name);
+/*
+ * Quality the value of an 'Accept' like header gives to `name`, that of "*" if
+ * it isn't listed, 0 if neither is.
+ */
+
+const char *
+ast_enc_name(enum ast_enc_t enc);
+/* Name of the encoding as in 'Content-Encoding', NULL for AST_IDENTITY. */
+
+void
+ast_free(struct ast_store *store);
+/* Free every asset in the store. */
+
+#endif /* MRSPS_ASSETS_H */
+
+/*
+ ===============================================================================
+ |                             IMPLEMENTATION MODE                             |
+ ===============================================================================
+ */
+
+#ifdef MRSPS_ASSETS_IMPLEMENTATION
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* Suffixes of the precompressed files. */
+static const char *ast_suffixes[AST_ENC_C] = { "", ".gz", ".zz" };
+
+struct ast_walk {
+	struct ast_store *store;
+	pthread_rwlock_t *lock;
+	char              path[MG_PATH_MAX]; /* On disk. */
+	size_t            root_len;
+	int               depth;
+	unsigned int      changed;
+};
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+static uint64_t
+ast_hash(const char *s, size_t len)
+{
+	/* FNV-1a */
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (unsigned char)s[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+static struct ast_asset **
+ast_slot(const struct ast_store *store, const char *path, size_t path_len,
+         uint64_t hash)
+{
+	struct ast_asset **slot =
+		(struct ast_asset **)&store->buckets[hash % AST_BUCKETS];
+	for (; *slot; slot = &(*slot)->next)
+		if ((*slot)->hash == hash && (*slot)->path_len == path_len &&
+		    memcmp((*slot)->path, path, path_len) == 0)
+			break;
+
+	return slot;
+}
+
+static void
+ast_asset_free(struct ast_asset *asset)
+{
+	for (int i = 0; i < AST_ENC_C; i++)
+		free((void *)asset->bodies[i].ptr);
+	free(asset->path);
+	free(asset);
+}
+
+static size_t
+ast_asset_size(const struct ast_asset *asset)
+{
+	size_t size = 0;
+	for (int i = 0; i < AST_ENC_C; i++)
+		size += asset->bodies[i].len;
+
+	return size;
+}
+
+static struct ast_asset *
+ast_load(struct ast_walk *w, size_t size, time_t mtime)
+{
+	struct ast_asset *asset = calloc(1, sizeof(struct ast_asset));
+	const char       *path  = w->path + w->root_len;
+	asset->path_len         = strlen(path);
+	asset->path             = strdup(path);
+	asset->hash             = ast_hash(path, asset->path_len);
+	asset->mime  = mg_http_guess_content_type(mg_str(path), NULL);
+	asset->size  = size;
+	asset->mtime = mtime;
+	if (w->store->file_max && size > w->store->file_max)
+		return asset;
+
+	size_t len;
+	char  *body = mg_file_read(w->store->fs, w->path, &len);
+	if (!body) {
+		ast_asset_free(asset);
+		return NULL;
+	}
+
+	asset->bodies[AST_IDENTITY] = mg_str_n(body, len);
+	static const enum dfl_format_t formats[AST_ENC_C] = {
+		[AST_GZIP] = DFL_GZIP, [AST_DEFLATE] = DFL_ZLIB
+	};
+	for (int i = AST_IDENTITY + 1; i < AST_ENC_C; i++) {
+		char   pre[MG_PATH_MAX];
+		size_t pre_size, pre_len;
+		time_t pre_mtime;
+		char  *pre_body = NULL;
+		if (mg_snprintf(pre, sizeof(pre), "%s%s", w->path,
+		                ast_suffixes[i]) < sizeof(pre) &&
+		    w->store->fs->st(pre, &pre_size, &pre_mtime) &&
+		    pre_mtime >= mtime)
+			pre_body = mg_file_read(w->store->fs, pre, &pre_len);
+		if (pre_body) {
+			if (pre_len < len)
+				asset->bodies[i] = mg_str_n(pre_body, pre_len);
+			else
+				free(pre_body);
+			continue;
+		}
+
+		/* Spend the time once, it's served many times over. */
+		struct mg_iobuf io = { 0 };
+		if (dfl_compress(&io, body, len, DFL_LEVEL_MAX, formats[i]) &&
+		    io.len < len)
+			asset->bodies[i] = mg_str_n((char *)io.buf, io.len);
+		else
+			mg_iobuf_free(&io);
+	}
+
+	static const char *suffixes[AST_ENC_C] = { "", "-gz", "-df" };
+	uint64_t           hash = ast_hash(body, len);
+	for (int i = 0; i < AST_ENC_C; i++)
+		mg_snprintf(asset->etags[i], AST_ETAG_LEN + 1, "\"%016llx%s\"",
+		            (unsigned long long)hash, suffixes[i]);
+
+	return asset;
+}
+
+static void
+ast_walk_file(struct ast_walk *w, size_t size, time_t mtime)
+{
+	struct ast_store *store = w->store;
+	const char       *path  = w->path + w->root_len;
+	size_t            len   = strlen(path);
+	struct ast_asset **slot =
+		ast_slot(store, path, len, ast_hash(path, len));
+	struct ast_asset *old = *slot;
+
+	if (old && old->size == size && old->mtime == mtime) {
+		old->gen = store->gen;
+		return;
+	}
+
+	struct ast_asset *asset = ast_load(w, size, mtime);
+	if (!asset) {
+		if (old)
+			old->gen = store->gen; /* keep serving the last copy */
+		return;
+	}
+	asset->gen = store->gen;
+
+	if (w->lock)
+		pthread_rwlock_wrlock(w->lock);
+	if (old) {
+		asset->next = old->next;
+		store->size -= ast_asset_size(old);
+	} else {
+		store->count++;
+	}
+	*slot = asset;
+	store->size += ast_asset_size(asset);
+	if (w->lock)
+		pthread_rwlock_unlock(w->lock);
+
+	if (old)
+		ast_asset_free(old);
+	w->changed++;
+}
+
+static int
+ast_is_precompressed(struct ast_walk *w)
+{
+	/* Whether the file at `w->path` is an encoding of another file. */
+	size_t len = strlen(w->path);
+	for (int i = AST_IDENTITY + 1; i < AST_ENC_C; i++) {
+		size_t suffix_len = strlen(ast_suffixes[i]);
+		if (len <= suffix_len ||
+		    strcmp(w->path + len - suffix_len, ast_suffixes[i]) != 0)
+			continue;
+
+		char base[MG_PATH_MAX];
+		mg_snprintf(base, sizeof(base), "%.*s", (int)(len - suffix_len),
+		            w->path);
+		if (w->store->fs->st(base, NULL, NULL))
+			return 1;
+	}
+
+	return 0;
+}
+
+static void
+ast_walk_fn(const char *name, void *userdata)
+{
+	struct ast_walk *w   = userdata;
+	size_t           len = strlen(w->path);
+
+	/* Hidden files are skipped. */
+	if (name[0] == '.' ||
+	    mg_snprintf(w->path + len, sizeof(w->path) - len, "/%s", name) >=
+	            sizeof(w->path) - len) {
+		w->path[len] = '\0';
+		return;
+	}
+
+	size_t size;
+	time_t mtime;
+	int    flags = w->store->fs->st(w->path, &size, &mtime);
+	if ((flags & MG_FS_DIR) && w->depth < AST_DEPTH_MAX) {
+		w->depth++;
+		w->store->fs->ls(w->path, ast_walk_fn, w);
+		w->depth--;
+	} else if (flags && !(flags & MG_FS_DIR) && !ast_is_precompressed(w)) {
+		/* the encodings are loaded along with their file */
+		ast_walk_file(w, size, mtime);
+	}
+	w->path[len] = '\0';
+}
+
+void
+ast_init(struct ast_store *store, struct mg_fs *fs, const char *root,
+         size_t file_max)
+{
+	memset(store, 0, sizeof(*store));
+	store->fs       = fs;
+	store->file_max = file_max;
+	mg_snprintf(store->root, sizeof(store->root), "%s", root);
+
+	/* Paths are joined with '/' after the root. */
+	size_t len = strlen(store->root);
+	while (len > 1 && store->root[len - 1] == '/')
+		store->root[--len] = '\0';
+}
+
+unsigned int
+ast_sync(struct ast_store *store, pthread_rwlock_t *lock)
+{
+	struct ast_walk w = { 0 };
+	w.store           = store;
+	w.lock            = lock;
+	w.root_len        = strlen(store->root);
+	memcpy(w.path, store->root, w.root_len + 1);
+
+	store->gen++;
+	store->fs->ls(store->root, ast_walk_fn, &w);
+
+	/* = Drop the removed files = */
+	struct ast_asset *gone = NULL;
+	if (lock)
+		pthread_rwlock_wrlock(lock);
+	for (size_t i = 0; i < AST_BUCKETS; i++) {
+		struct ast_asset **slot = &store->buckets[i];
+		while (*slot) {
+			struct ast_asset *asset = *slot;
+			if (asset->gen == store->gen) {
+				slot = &asset->next;
+				continue;
+			}
+			*slot       = asset->next;
+			asset->next = gone;
+			gone        = asset;
+			store->count--;
+			store->size -= ast_asset_size(asset);
+		}
+	}
+	if (lock)
+		pthread_rwlock_unlock(lock);
+
+	for (struct ast_asset *next; gone; gone = next, w.changed++) {
+		next = gone->next;
+		ast_asset_free(gone);
+	}
+
+	return w.changed;
+}
+
+int
+ast_is_on_disk(const struct ast_asset *asset)
+{
+	return asset->bodies[AST_IDENTITY].ptr == NULL;
+}
+
+const struct ast_asset *
+ast_find(const struct ast_store *store, struct mg_str path)
+{
+	char buf[MG_PATH_MAX];
+	int  len = mg_url_decode(path.ptr, path.len, buf,
+	                         sizeof(buf) - sizeof("/index.html"), 0);
+	if (len < 0)
+		return NULL;
+
+	/* Directories are looked up as their index. */
+	int is_dir = len == 0 || buf[len - 1] == '/';
+	if (is_dir)
+		len += mg_snprintf(buf + len, sizeof(buf) - len, "%sindex.html",
+		                   len ? "" : "/");
+
+	struct ast_asset *asset = *ast_slot(store, buf, len, ast_hash(buf, len));
+	if (!asset && !is_dir) {
+		len += mg_snprintf(buf + len, sizeof(buf) - len, "/index.html");
+		asset = *ast_slot(store, buf, len, ast_hash(buf, len));
+	}
+
+	return asset;
+}
+
+double
+ast_accept_q(const struct mg_str *accept, const char *name)
+{
+	/* A list like "gzip;q=0.8, deflate, *;q=0". */
+	struct mg_str s      = *accept;
+	double        q_star = -1;
+
+	while (s.len) {
+		size_t n = 0;
+		while (n < s.len && s.ptr[n] != ',')
+			n++;
+		struct mg_str item = mg_strstrip(mg_str_n(s.ptr, n));
+		s = mg_str_n(s.ptr + (n < s.len ? n + 1 : n),
+		             s.len - (n < s.len ? n + 1 : n));
+
+		size_t k = 0;
+		while (k < item.len && item.ptr[k] != ';')
+			k++;
+		struct mg_str coding = mg_strstrip(mg_str_n(item.ptr, k));
+		double        q      = 1;
+		for (; k + 2 < item.len; k++) {
+			if ((item.ptr[k] == 'q' || item.ptr[k] == 'Q') &&
+			    item.ptr[k + 1] == '=') {
+				q = mg_atod(item.ptr + k + 2, item.len - k - 2, NULL);
+				break;
+			}
+		}
+
+		if (mg_vcasecmp(&coding, name) == 0)
+			return q;
+		if (mg_vcmp(&coding, "*") == 0)
+			q_star = q;
+	}
+
+	return q_star < 0 ? 0 : q_star;
+}
+
+enum ast_enc_t
+ast_negotiate(const struct ast_asset *asset,
+              const struct mg_str    *accept_encoding)
+{
+	enum ast_enc_t best   = AST_IDENTITY;
+	double         best_q = 0;
+
+	if (!accept_encoding)
+		return best;
+	for (int i = AST_IDENTITY + 1; i < AST_ENC_C; i++) {
+		if (!asset->bodies[i].len)
+			continue;
+		double q = ast_accept_q(accept_encoding, ast_enc_name(i));
+		if (q > best_q) {
+			best   = i;
+			best_q = q;
+		}
+	}
+
+	return best;
+}
+
+const char *
+ast_enc_name(enum ast_enc_t enc)
+{
+	static const char *names[AST_ENC_C] = { NULL, "gzip", "deflate" };
+
+	return names[enc];
+}
+
+void
+ast_free(struct ast_store *store)
+{
+	for (size_t i = 0; i < AST_BUCKETS; i++) {
+		struct ast_asset *asset = store->buckets[i], *next;
+		for (; asset; asset = next) {
+			next = asset->next;
+			ast_asset_free(asset);
+		}
+	}
+	memset(store, 0, sizeof(*store));
+}
+
+#endif /* MRSPS_ASSETS_IMPLEMENTATION */
@@ -0,0 +1,249 @@
+/*
+ ===============================================================================
+ |                                Dependencies                                 |
+ ===============================================================================
+ *
+ * -> mongoose
+ */
+
+/*
+ ===============================================================================
+ |                                    Usage                                    |
+ ===============================================================================
+ *
+ * Do this:
+ *
+ *         #define MRSPS_CACHE_IMPLEMENTATION
+ *
+ * before you include this file in *one* C or C++ file to create the
+ * implementation.
+ *
+ * A bounded in-memory cache of response bodies keyed by a caller built string.
+ * Once the total size reaches the cap, the least recently used entries are
+ * evicted. Every entry carries an ETag derived from its key.
+ */
+
+/*
+ ===============================================================================
+ |                              HEADER-FILE MODE                               |
+ ===============================================================================
+ */
+
+#ifndef MRSPS_CACHE_H
+#define MRSPS_CACHE_H
+
+#include "../dep/mongoose.h"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* = Options = */
+#define CACHE_BUCKETS  4096
+#define CACHE_ETAG_LEN 18 /* Quoted 64-bit hex. */
+
+struct cache_entry {
+	char    *key;
+	size_t   key_len;
+	uint64_t hash;
+	char    *body;
+	size_t   body_len;
+	char     etag[CACHE_ETAG_LEN + 1];
+
+	struct cache_entry *next;               /* Linkage in the bucket. */
+	struct cache_entry *lru_prev, *lru_next; /* Most recent at the head. */
+};
+
+struct cache {
+	struct cache_entry *buckets[CACHE_BUCKETS];
+	struct cache_entry *lru_head, *lru_tail;
+	unsigned int        count;
+	size_t              size, size_max;
+	uint64_t            hits, misses;
+};
+
+/*
+ ===============================================================================
+ |                            Function Declarations                            |
+ ===============================================================================
+ */
+void
+cache_init(struct cache *cache, size_t size_max);
+/* Initialize an empty cache holding at most `size_max` bytes. */
+
+struct cache_entry *
+cache_get(struct cache *cache, const char *key, size_t key_len);
+/*
+ * Return the entry for the key and mark it as recently used, or NULL if there
+ * is none.
+ *
+ * Counts as a hit or a miss in the cache's stats.
+ */
+
+struct cache_entry *
+cache_put(struct cache *cache, const char *key, size_t key_len,
+          const char *body, size_t body_len);
+/*
+ * Store a copy of `body` under the key, replacing any older entry, and return
+ * the new entry.
+ *
+ * Returns NULL if the entry alone is larger than the cap.
+ */
+
+void
+cache_free(struct cache *cache);
+/* Free every entry in the cache. */
+
+#endif /* MRSPS_CACHE_H */
+
+/*
+ ===============================================================================
+ |                             IMPLEMENTATION MODE                             |
+ ===============================================================================
+ */
+
+#ifdef MRSPS_CACHE_IMPLEMENTATION
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+static uint64_t
+cache_hash(const char *key, size_t key_len)
+{
+	/* FNV-1a */
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < key_len; i++) {
+		hash ^= (unsigned char)key[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+static size_t
+cache_entry_size(struct cache_entry *entry)
+{
+	return sizeof(struct cache_entry) + entry->key_len + entry->body_len;
+}
+
+static void
+cache_lru_unlink(struct cache *cache, struct cache_entry *entry)
+{
+	if (entry->lru_prev)
+		entry->lru_prev->lru_next = entry->lru_next;
+	else
+		cache->lru_head = entry->lru_next;
+	if (entry->lru_next)
+		entry->lru_next->lru_prev = entry->lru_prev;
+	else
+		cache->lru_tail = entry->lru_prev;
+}
+
+static void
+cache_lru_push(struct cache *cache, struct cache_entry *entry)
+{
+	entry->lru_prev = NULL;
+	entry->lru_next = cache->lru_head;
+	if (cache->lru_head)
+		cache->lru_head->lru_prev = entry;
+	cache->lru_head = entry;
+	if (!cache->lru_tail)
+		cache->lru_tail = entry;
+}
+
+static void
+cache_delete(struct cache *cache, struct cache_entry *entry)
+{
+	LIST_DELETE(struct cache_entry,
+	            &cache->buckets[entry->hash % CACHE_BUCKETS], entry);
+	cache_lru_unlink(cache, entry);
+	cache->count--;
+	cache->size -= cache_entry_size(entry);
+
+	free(entry->key);
+	free(entry->body);
+	free(entry);
+}
+
+static struct cache_entry *
+cache_find(struct cache *cache, const char *key, size_t key_len,
+           uint64_t hash)
+{
+	for (struct cache_entry *e = cache->buckets[hash % CACHE_BUCKETS]; e;
+	     e = e->next)
+		if (e->hash == hash && e->key_len == key_len &&
+		    memcmp(e->key, key, key_len) == 0)
+			return e;
+
+	return NULL;
+}
+
+void
+cache_init(struct cache *cache, size_t size_max)
+{
+	memset(cache, 0, sizeof(*cache));
+	cache->size_max = size_max;
+}
+
+struct cache_entry *
+cache_get(struct cache *cache, const char *key, size_t key_len)
+{
+	struct cache_entry *e =
+		cache_find(cache, key, key_len, cache_hash(key, key_len));
+	if (!e) {
+		cache->misses++;
+		return NULL;
+	}
+
+	cache->hits++;
+	cache_lru_unlink(cache, e);
+	cache_lru_push(cache, e);
+	return e;
+}
+
+struct cache_entry *
+cache_put(struct cache *cache, const char *key, size_t key_len,
+          const char *body, size_t body_len)
+{
+	uint64_t hash = cache_hash(key, key_len);
+	size_t   size = sizeof(struct cache_entry) + key_len + body_len;
+	if (size > cache->size_max)
+		return NULL;
+
+	struct cache_entry *old = cache_find(cache, key, key_len, hash);
+	if (old)
+		cache_delete(cache, old);
+	while (cache->size + size > cache->size_max)
+		cache_delete(cache, cache->lru_tail);
+
+	struct cache_entry *entry = calloc(1, sizeof(struct cache_entry));
+	entry->key                = malloc(key_len);
+	entry->body               = malloc(body_len);
+	memcpy(entry->key, key, key_len);
+	memcpy(entry->body, body, body_len);
+	entry->key_len  = key_len;
+	entry->body_len = body_len;
+	entry->hash     = hash;
+	mg_snprintf(entry->etag, sizeof(entry->etag), "\"%016llx\"",
+	            (unsigned long long)hash);
+
+	LIST_ADD_HEAD(struct cache_entry, &cache->buckets[hash % CACHE_BUCKETS],
+	              entry);
+	cache_lru_push(cache, entry);
+	cache->count++;
+	cache->size += size;
+
+	return entry;
+}
+
+void
+cache_free(struct cache *cache)
+{
+	while (cache->lru_head)
+		cache_delete(cache, cache->lru_head);
+}
+
+#endif /* MRSPS_CACHE_IMPLEMENTATION */
@@ -0,0 +1,259 @@
+/*
+ ===============================================================================
+ |                                Dependencies                                 |
+ ===============================================================================
+ *
+ * -> mongoose
+ */
+
+/*
+ ===============================================================================
+ |                                    Usage                                    |
+ ===============================================================================
+ *
+ * Do this:
+ *
+ *         #define MRSPS_CBORW_IMPLEMENTATION
+ *
+ * before you include this file in *one* C or C++ file to create the
+ * implementation.
+ *
+ * A CBOR (RFC 8949) writer appending straight to a 'struct mg_iobuf'. Values
+ * are written in order, the maps as their keys and values in turn:
+ *
+ *         cw_map(&w, 2);
+ *         cw_text(&w, "n", 1);
+ *         cw_uint(&w, 1);
+ *         cw_text(&w, "x", 1);
+ *         cw_floats(&w, &row.x, 1, sizeof(row));
+ *
+ * Columns of floats are written as typed arrays (RFC 8746, tag 85): the raw
+ * little endian IEEE 754 singles in a byte string, which the clients can map
+ * as they are, e.g. numpy.frombuffer(value, "<f4").
+ */
+
+/*
+ ===============================================================================
+ |                              HEADER-FILE MODE                               |
+ ===============================================================================
+ */
+
+#ifndef MRSPS_CBORW_H
+#define MRSPS_CBORW_H
+
+#include "../dep/mongoose.h"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+struct cw {
+	struct mg_iobuf *io;           /* Appended to. */
+	int              is_truncated; /* Set if something didn't fit. */
+};
+
+/*
+ ===============================================================================
+ |                            Function Declarations                            |
+ ===============================================================================
+ */
+void
+cw_init(struct cw *w, struct mg_iobuf *io);
+/*
+ * Write to the end of `io`, growing it as needed.
+ *
+ * `io->len` can be reset between the values, e.g. once sent, without
+ * disturbing the writer.
+ */
+
+void
+cw_array(struct cw *w, size_t n);
+/* Begin an array of the `n` values written next. */
+
+void
+cw_map(struct cw *w, size_t n);
+/* Begin a map of the `n` pairs of key and value written next. */
+
+void
+cw_array_begin(struct cw *w);
+/* Begin an array of unknown length, ended by 'cw_end'. */
+
+void
+cw_end(struct cw *w);
+
+void
+cw_uint(struct cw *w, uint64_t num);
+
+void
+cw_text(struct cw *w, const char *str, size_t len);
+/* Write the UTF-8 string. */
+
+void
+cw_floats(struct cw *w, const float *first, size_t n, size_t stride);
+/*
+ * Write the `n` floats, `stride` bytes apart from the `first`, as a typed
+ * array. With a stride of the size of a struct a field of an array of them is
+ * written as a column.
+ */
+
+#endif /* MRSPS_CBORW_H */
+
+/*
+ ===============================================================================
+ |                             IMPLEMENTATION MODE                             |
+ ===============================================================================
+ */
+
+#ifdef MRSPS_CBORW_IMPLEMENTATION
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* Major types, in the top 3 bits of the initial byte. */
+enum {
+	CW_UINT  = 0 << 5,
+	CW_BYTES = 2 << 5,
+	CW_TEXT  = 3 << 5,
+	CW_ARRAY = 4 << 5,
+	CW_MAP   = 5 << 5,
+	CW_TAG   = 6 << 5,
+};
+
+#define CW_INDEFINITE    31
+#define CW_BREAK         0xff
+#define CW_TAG_FLOAT32LE 85
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+static unsigned char *
+cw_reserve(struct cw *w, size_t n)
+{
+	struct mg_iobuf *io = w->io;
+	if (io->len + n > io->size) {
+		size_t size = io->size * 2;
+		if (size < io->len + n)
+			size = io->len + n + MG_IO_SIZE;
+		if (!mg_iobuf_resize(io, size)) {
+			w->is_truncated = 1;
+			return NULL;
+		}
+	}
+
+	return io->buf + io->len;
+}
+
+static void
+cw_head(struct cw *w, unsigned char type, uint64_t arg)
+{
+	/* The argument in the initial byte if small, else in the 1, 2, 4 or 8
+	 * bytes after it, big endian. */
+	unsigned char *p = cw_reserve(w, 9);
+	if (!p)
+		return;
+
+	size_t n = 0;
+	if (arg < 24) {
+		p[0] = type | (unsigned char)arg;
+	} else if (arg <= 0xff) {
+		p[0] = type | 24;
+		n    = 1;
+	} else if (arg <= 0xffff) {
+		p[0] = type | 25;
+		n    = 2;
+	} else if (arg <= 0xffffffff) {
+		p[0] = type | 26;
+		n    = 4;
+	} else {
+		p[0] = type | 27;
+		n    = 8;
+	}
+	for (size_t i = 0; i < n; i++)
+		p[1 + i] = (unsigned char)(arg >> (8 * (n - 1 - i)));
+	w->io->len += 1 + n;
+}
+
+void
+cw_init(struct cw *w, struct mg_iobuf *io)
+{
+	memset(w, 0, sizeof(*w));
+	w->io = io;
+}
+
+void
+cw_array(struct cw *w, size_t n)
+{
+	cw_head(w, CW_ARRAY, n);
+}
+
+void
+cw_map(struct cw *w, size_t n)
+{
+	cw_head(w, CW_MAP, n);
+}
+
+void
+cw_array_begin(struct cw *w)
+{
+	unsigned char *p = cw_reserve(w, 1);
+	if (!p)
+		return;
+	*p = CW_ARRAY | CW_INDEFINITE;
+	w->io->len++;
+}
+
+void
+cw_end(struct cw *w)
+{
+	unsigned char *p = cw_reserve(w, 1);
+	if (!p)
+		return;
+	*p = CW_BREAK;
+	w->io->len++;
+}
+
+void
+cw_uint(struct cw *w, uint64_t num)
+{
+	cw_head(w, CW_UINT, num);
+}
+
+void
+cw_text(struct cw *w, const char *str, size_t len)
+{
+	cw_head(w, CW_TEXT, len);
+	unsigned char *p = cw_reserve(w, len);
+	if (!p)
+		return;
+	memcpy(p, str, len);
+	w->io->len += len;
+}
+
+void
+cw_floats(struct cw *w, const float *first, size_t n, size_t stride)
+{
+	cw_head(w, CW_TAG, CW_TAG_FLOAT32LE);
+	cw_head(w, CW_BYTES, n * 4);
+	unsigned char *p = cw_reserve(w, n * 4);
+	if (!p)
+		return;
+
+	/* Copied through an integer to be little endian on any host. */
+	const unsigned char *src = (const unsigned char *)first;
+	for (size_t i = 0; i < n; i++, src += stride, p += 4) {
+		uint32_t bits;
+		memcpy(&bits, src, 4);
+		p[0] = (unsigned char)bits;
+		p[1] = (unsigned char)(bits >> 8);
+		p[2] = (unsigned char)(bits >> 16);
+		p[3] = (unsigned char)(bits >> 24);
+	}
+	w->io->len += n * 4;
+}
+
+#endif /* MRSPS_CBORW_IMPLEMENTATION */
@@ -0,0 +1,822 @@
+/*
+ ===============================================================================
+ |                                Dependencies                                 |
+ ===============================================================================
+ *
+ * -> mongoose
+ */
+
+/*
+ ===============================================================================
+ |                                    Usage                                    |
+ ===============================================================================
+ *
+ * Do this:
+ *
+ *         #define MRSPS_DEFLATE_IMPLEMENTATION
+ *
+ * before you include this file in *one* C or C++ file to create the
+ * implementation.
+ *
+ * A DEFLATE (RFC 1951) compressor with the zlib (RFC 1950) and gzip (RFC 1952)
+ * framings used by the 'deflate' and 'gzip' content codings.
+ *
+ * Input can be given in pieces to 'dfl_write', the compressed bytes are
+ * appended to a mongoose iobuf. Matches are found through hash chains over a
+ * 32K window, with lazy matching from level 4, and every block gets its own
+ * Huffman codes.
+ */
+
+/*
+ ===============================================================================
+ |                              HEADER-FILE MODE                               |
+ ===============================================================================
+ */
+
+#ifndef MRSPS_DEFLATE_H
+#define MRSPS_DEFLATE_H
+
+#include "../dep/mongoose.h"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* = Options = */
+#define DFL_LEVEL_MAX 9
+#define DFL_SYMS_MAX  16384 /* Symbols per block. */
+
+/* = Internals = */
+#define DFL_WSIZE     32768
+#define DFL_HBITS     15
+#define DFL_LIT_C     286
+#define DFL_DIST_C    30
+
+enum dfl_format_t {
+	DFL_RAW = 0,
+	DFL_ZLIB, /* Content-Encoding: deflate */
+	DFL_GZIP, /* Content-Encoding: gzip */
+};
+
+enum dfl_flush_t {
+	DFL_NO_FLUSH = 0,
+	DFL_SYNC, /* Emit everything so far, ending on a byte boundary. */
+	DFL_FINISH,
+};
+
+struct dfl {
+	enum dfl_format_t format;
+	unsigned int      chain_max, nice_len;
+	int               is_lazy;
+
+	unsigned char win[2 * DFL_WSIZE];
+	size_t        win_len, pos;
+	uint32_t      head[1 << DFL_HBITS]; /* Position + 1, 0 for none. */
+	uint32_t      prev[DFL_WSIZE];
+	unsigned int  prev_len, prev_dist; /* Pending lazy match. */
+	int           has_prev;
+
+	uint16_t     syms_lit[DFL_SYMS_MAX], syms_dist[DFL_SYMS_MAX];
+	unsigned int syms_c;
+	uint32_t     freq_lit[DFL_LIT_C], freq_dist[DFL_DIST_C];
+
+	uint64_t     bits;
+	unsigned int bits_c;
+	uint32_t     check; /* CRC-32 or Adler-32 of the input. */
+	uint32_t     in_len;
+	int          is_started, is_finished;
+};
+
+/*
+ ===============================================================================
+ |                            Function Declarations                            |
+ ===============================================================================
+ */
+struct dfl *
+dfl_new(int level, enum dfl_format_t format);
+/*
+ * Allocate a compressor, `level` going from 1 (fastest) to DFL_LEVEL_MAX
+ * (smallest).
+ *
+ * Returns NULL on failure.
+ */
+
+int
+dfl_write(struct dfl *d, struct mg_iobuf *out, const void *buf, size_t len,
+          enum dfl_flush_t flush);
+/*
+ * Compress `len` bytes of `buf`, appending the output to `out`. Without a
+ * flush, the tail of the input can be held back till the next call.
+ *
+ * Nothing can be written after DFL_FINISH.
+ *
+ * Returns 0 on failure to grow `out`.
+ */
+
+int
+dfl_compress(struct mg_iobuf *out, const void *buf, size_t len, int level,
+             enum dfl_format_t format);
+/* One shot 'dfl_write' with DFL_FINISH. */
+
+void
+dfl_free(struct dfl *d);
+
+#endif /* MRSPS_DEFLATE_H */
+
+/*
+ ===============================================================================
+ |                             IMPLEMENTATION MODE                             |
+ ===============================================================================
+ */
+
+#if defined(MRSPS_DEFLATE_IMPLEMENTATION) && !defined(MRSPS_DEFLATE_IMPLEMENTED)
+#define MRSPS_DEFLATE_IMPLEMENTED /* Other libs include this file too. */
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+#define DFL_WMASK     (DFL_WSIZE - 1)
+#define DFL_HMASK     ((1 << DFL_HBITS) - 1)
+#define DFL_MIN_MATCH 3
+#define DFL_MAX_MATCH 258
+#define DFL_LOOKAHEAD (DFL_MAX_MATCH + DFL_MIN_MATCH + 1)
+#define DFL_CL_C      19
+
+struct dfl_sym {
+	uint32_t key; /* Frequency, then code length. */
+	uint16_t sym;
+};
+
+/* chain_max, nice_len, is_lazy */
+static const unsigned int dfl_levels[DFL_LEVEL_MAX + 1][3] = {
+	{ 0, 0, 0 },       { 4, 8, 0 },      { 8, 16, 0 },
+	{ 16, 32, 0 },     { 16, 32, 1 },    { 32, 64, 1 },
+	{ 128, 128, 1 },   { 256, 128, 1 },  { 1024, 258, 1 },
+	{ 4096, 258, 1 },
+};
+
+static const uint16_t dfl_len_base[29] = {
+	3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+	31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+
+static const uint16_t dfl_dist_base[DFL_DIST_C] = {
+	1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+	33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+	1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577,
+};
+
+static const unsigned char dfl_cl_order[DFL_CL_C] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+};
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+/* = Output = */
+static int
+dfl_reserve(struct mg_iobuf *out, size_t n)
+{
+	if (out->len + n <= out->size)
+		return 1;
+
+	size_t size = out->size ? out->size * 2 : 256;
+	while (size < out->len + n)
+		size *= 2;
+	return mg_iobuf_resize(out, size);
+}
+
+static int
+dfl_put_bits(struct dfl *d, struct mg_iobuf *out, uint32_t v, unsigned int n)
+{
+	d->bits |= (uint64_t)v << d->bits_c;
+	d->bits_c += n;
+	if (d->bits_c < 32)
+		return 1;
+
+	if (!dfl_reserve(out, 4))
+		return 0;
+	for (int i = 0; i < 4; i++, d->bits >>= 8)
+		out->buf[out->len++] = (unsigned char)d->bits;
+	d->bits_c -= 32;
+
+	return 1;
+}
+
+static int
+dfl_align(struct dfl *d, struct mg_iobuf *out)
+{
+	if (!dfl_reserve(out, 4))
+		return 0;
+	while (d->bits_c > 0) {
+		out->buf[out->len++] = (unsigned char)d->bits;
+		d->bits >>= 8;
+		d->bits_c = d->bits_c > 8 ? d->bits_c - 8 : 0;
+	}
+	d->bits = 0;
+
+	return 1;
+}
+
+static int
+dfl_put_bytes(struct mg_iobuf *out, const void *buf, size_t len)
+{
+	if (!dfl_reserve(out, len))
+		return 0;
+	memcpy(out->buf + out->len, buf, len);
+	out->len += len;
+
+	return 1;
+}
+
+/* = Huffman codes = */
+static void
+dfl_codes(const unsigned char *lens, int n, uint16_t *codes)
+{
+	/* Canonical codes, bit reversed as they're sent LSB first. */
+	unsigned int len_c[16] = { 0 };
+	uint16_t     next_code[16];
+
+	for (int i = 0; i < n; i++)
+		len_c[lens[i]]++;
+	next_code[1] = 0;
+	for (unsigned int len = 1; len < 15; len++)
+		next_code[len + 1] = (next_code[len] + len_c[len]) << 1;
+	for (int i = 0; i < n; i++) {
+		if (!lens[i])
+			continue;
+		uint16_t code = next_code[lens[i]]++, rev = 0;
+		for (unsigned int b = 0; b < lens[i]; b++, code >>= 1)
+			rev = (rev << 1) | (code & 1);
+		codes[i] = rev;
+	}
+}
+
+static int
+dfl_sym_cmp(const void *a, const void *b)
+{
+	const struct dfl_sym *sa = a, *sb = b;
+	if (sa->key != sb->key)
+		return sa->key < sb->key ? -1 : 1;
+	return (int)sa->sym - (int)sb->sym;
+}
+
+static void
+dfl_min_redundancy(struct dfl_sym *a, int n)
+{
+	/* In-place code lengths of Moffat and Katajainen over `a` sorted by
+	 * ascending frequency. */
+	int root, leaf, next, avbl, used, dpth;
+
+	if (n == 1) {
+		a[0].key = 1;
+		return;
+	}
+
+	a[0].key += a[1].key;
+	root = 0;
+	leaf = 2;
+	for (next = 1; next < n - 1; next++) {
+		if (leaf >= n || a[root].key < a[leaf].key) {
+			a[next].key   = a[root].key;
+			a[root++].key = next;
+		} else {
+			a[next].key = a[leaf++].key;
+		}
+		if (leaf >= n || (root < next && a[root].key < a[leaf].key)) {
+			a[next].key += a[root].key;
+			a[root++].key = next;
+		} else {
+			a[next].key += a[leaf++].key;
+		}
+	}
+
+	a[n - 2].key = 0;
+	for (next = n - 3; next >= 0; next--)
+		a[next].key = a[a[next].key].key + 1;
+
+	avbl = 1;
+	used = dpth = 0;
+	root = n - 2;
+	next = n - 1;
+	while (avbl > 0) {
+		while (root >= 0 && (int)a[root].key == dpth) {
+			used++;
+			root--;
+		}
+		while (avbl > used) {
+			a[next--].key = dpth;
+			avbl--;
+		}
+		avbl = 2 * used;
+		dpth++;
+		used = 0;
+	}
+}
+
+static void
+dfl_build(const uint32_t *freq, int n, unsigned int bits_max,
+          unsigned char *lens, uint16_t *codes)
+{
+	struct dfl_sym syms[DFL_LIT_C];
+	int            used = 0;
+
+	for (int i = 0; i < n; i++) {
+		lens[i] = 0;
+		if (freq[i])
+			syms[used].key = freq[i], syms[used++].sym = i;
+	}
+	/* Inflaters want complete codes, so at least two of them. */
+	for (int i = 0; used < 2 && i < n; i++)
+		if (!freq[i])
+			syms[used].key = 1, syms[used++].sym = i;
+	qsort(syms, used, sizeof(struct dfl_sym), dfl_sym_cmp);
+	dfl_min_redundancy(syms, used);
+
+	/* Limit the lengths to `bits_max` while keeping the code complete. */
+	unsigned int len_c[16] = { 0 };
+	for (int i = 0; i < used; i++)
+		len_c[syms[i].key < bits_max ? syms[i].key : bits_max]++;
+	uint32_t total = 0;
+	for (unsigned int i = 1; i <= bits_max; i++)
+		total += len_c[i] << (bits_max - i);
+	for (; total != 1u << bits_max; total--) {
+		len_c[bits_max]--;
+		for (unsigned int i = bits_max - 1; i > 0; i--) {
+			if (len_c[i]) {
+				len_c[i]--;
+				len_c[i + 1] += 2;
+				break;
+			}
+		}
+	}
+	for (unsigned int len = 1, j = used; len <= bits_max; len++)
+		for (unsigned int k = len_c[len]; k > 0; k--)
+			lens[syms[--j].sym] = len;
+
+	dfl_codes(lens, n, codes);
+}
+
+static void
+dfl_fixed(unsigned char *lens_lit, uint16_t *codes_lit,
+          unsigned char *lens_dist, uint16_t *codes_dist)
+{
+	/* The two unused symbols at the end still take up codes. */
+	unsigned char lens[DFL_LIT_C + 2];
+	uint16_t      codes[DFL_LIT_C + 2];
+
+	for (int i = 0; i < DFL_LIT_C + 2; i++)
+		lens[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+	dfl_codes(lens, DFL_LIT_C + 2, codes);
+	memcpy(lens_lit, lens, DFL_LIT_C);
+	memcpy(codes_lit, codes, sizeof(uint16_t) * DFL_LIT_C);
+
+	memset(lens_dist, 5, DFL_DIST_C);
+	dfl_codes(lens_dist, DFL_DIST_C, codes_dist);
+}
+
+/* = Blocks = */
+static unsigned int
+dfl_len_code(unsigned int len)
+{
+	unsigned int l = len - DFL_MIN_MATCH;
+	if (l < 8)
+		return l;
+	if (len == DFL_MAX_MATCH)
+		return 28;
+
+	unsigned int nb = 0;
+	while (l >> (nb + 1))
+		nb++;
+	return 4 * (nb - 1) + ((l >> (nb - 2)) & 3);
+}
+
+static unsigned int
+dfl_dist_code(unsigned int dist)
+{
+	unsigned int d = dist - 1;
+	if (d < 4)
+		return d;
+
+	unsigned int nb = 0;
+	while (d >> (nb + 1))
+		nb++;
+	return 2 * nb + ((d >> (nb - 1)) & 1);
+}
+
+static int
+dfl_block(struct dfl *d, struct mg_iobuf *out, int is_last)
+{
+	unsigned char lens[DFL_LIT_C + DFL_DIST_C];
+	unsigned char lens_lit[DFL_LIT_C], lens_dist[DFL_DIST_C];
+	uint16_t      codes_lit[DFL_LIT_C], codes_dist[DFL_DIST_C];
+
+	d->freq_lit[256]++;
+	dfl_build(d->freq_lit, DFL_LIT_C, 15, lens_lit, codes_lit);
+	dfl_build(d->freq_dist, DFL_DIST_C, 15, lens_dist, codes_dist);
+
+	unsigned int lit_c = DFL_LIT_C, dist_c = DFL_DIST_C;
+	while (lit_c > 257 && !lens_lit[lit_c - 1])
+		lit_c--;
+	while (dist_c > 1 && !lens_dist[dist_c - 1])
+		dist_c--;
+	memcpy(lens, lens_lit, lit_c);
+	memcpy(lens + lit_c, lens_dist, dist_c);
+
+	/* Run length encode the code lengths. */
+	unsigned char rle[DFL_LIT_C + DFL_DIST_C], rle_extra[DFL_LIT_C + DFL_DIST_C];
+	unsigned int  rle_c = 0, lens_c = lit_c + dist_c;
+	uint32_t      freq_cl[DFL_CL_C] = { 0 };
+	for (unsigned int i = 0; i < lens_c;) {
+		unsigned int v = lens[i], run = 1;
+		while (i + run < lens_c && lens[i + run] == v)
+			run++;
+		if (v == 0 && run >= 3) {
+			run = run < 138 ? run : 138;
+			rle[rle_c]         = run >= 11 ? 18 : 17;
+			rle_extra[rle_c++] = run - (run >= 11 ? 11 : 3);
+			i += run;
+		} else if (v != 0 && run >= 4) {
+			run                = run - 1 < 6 ? run - 1 : 6;
+			rle[rle_c++]       = v;
+			rle[rle_c]         = 16;
+			rle_extra[rle_c++] = run - 3;
+			i += 1 + run;
+		} else {
+			rle[rle_c++] = v;
+			i++;
+		}
+	}
+	for (unsigned int i = 0; i < rle_c; i++)
+		freq_cl[rle[i]]++;
+
+	unsigned char lens_cl[DFL_CL_C];
+	uint16_t      codes_cl[DFL_CL_C];
+	dfl_build(freq_cl, DFL_CL_C, 7, lens_cl, codes_cl);
+	unsigned int cl_c = DFL_CL_C;
+	while (cl_c > 4 && !lens_cl[dfl_cl_order[cl_c - 1]])
+		cl_c--;
+
+	/* = Header = */
+	/* Small blocks do better with the fixed codes than with sending their
+	 * own. The extra bits cost the same either way. */
+	uint64_t bits_dyn = 17 + 3 * cl_c, bits_fixed = 3;
+	for (int i = 0; i < DFL_CL_C; i++)
+		bits_dyn += freq_cl[i] * (lens_cl[i] + (i == 16 ? 2
+		                                        : i == 17 ? 3
+		                                        : i == 18 ? 7
+		                                                  : 0));
+	for (int i = 0; i < DFL_LIT_C; i++) {
+		bits_dyn += (uint64_t)d->freq_lit[i] * lens_lit[i];
+		bits_fixed += (uint64_t)d->freq_lit[i] *
+		              (i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8);
+	}
+	for (int i = 0; i < DFL_DIST_C; i++) {
+		bits_dyn += (uint64_t)d->freq_dist[i] * lens_dist[i];
+		bits_fixed += (uint64_t)d->freq_dist[i] * 5;
+	}
+	int is_fixed = bits_fixed <= bits_dyn;
+
+	int ok = dfl_put_bits(d, out, is_last, 1) &&
+	         dfl_put_bits(d, out, is_fixed ? 1 : 2, 2);
+	if (is_fixed) {
+		dfl_fixed(lens_lit, codes_lit, lens_dist, codes_dist);
+		rle_c = cl_c = 0;
+	} else {
+		ok = ok && dfl_put_bits(d, out, lit_c - 257, 5) &&
+		     dfl_put_bits(d, out, dist_c - 1, 5) &&
+		     dfl_put_bits(d, out, cl_c - 4, 4);
+	}
+	for (unsigned int i = 0; ok && i < cl_c; i++)
+		ok = dfl_put_bits(d, out, lens_cl[dfl_cl_order[i]], 3);
+	for (unsigned int i = 0; ok && i < rle_c; i++) {
+		ok = dfl_put_bits(d, out, codes_cl[rle[i]], lens_cl[rle[i]]);
+		if (ok && rle[i] >= 16)
+			ok = dfl_put_bits(d, out, rle_extra[i],
+			                  rle[i] == 16 ? 2 : rle[i] == 17 ? 3 : 7);
+	}
+
+	/* = Data = */
+	for (unsigned int i = 0; ok && i < d->syms_c; i++) {
+		unsigned int lit = d->syms_lit[i], dist = d->syms_dist[i];
+		if (!dist) {
+			ok = dfl_put_bits(d, out, codes_lit[lit], lens_lit[lit]);
+			continue;
+		}
+
+		unsigned int lc = dfl_len_code(lit), dc = dfl_dist_code(dist);
+		unsigned int lc_extra = lc < 8 || lc == 28 ? 0 : lc / 4 - 1;
+		unsigned int dc_extra = dc < 4 ? 0 : dc / 2 - 1;
+		ok = dfl_put_bits(d, out, codes_lit[257 + lc],
+		                  lens_lit[257 + lc]) &&
+		     dfl_put_bits(d, out, lit - dfl_len_base[lc], lc_extra) &&
+		     dfl_put_bits(d, out, codes_dist[dc], lens_dist[dc]) &&
+		     dfl_put_bits(d, out, dist - dfl_dist_base[dc], dc_extra);
+	}
+	ok = ok && dfl_put_bits(d, out, codes_lit[256], lens_lit[256]);
+
+	memset(d->freq_lit, 0, sizeof(d->freq_lit));
+	memset(d->freq_dist, 0, sizeof(d->freq_dist));
+	d->syms_c = 0;
+
+	return ok;
+}
+
+static int
+dfl_sym(struct dfl *d, struct mg_iobuf *out, unsigned int lit,
+        unsigned int dist)
+{
+	/* `lit` is the match length when `dist` is set. */
+	d->syms_lit[d->syms_c]    = lit;
+	d->syms_dist[d->syms_c++] = dist;
+	if (dist) {
+		d->freq_lit[257 + dfl_len_code(lit)]++;
+		d->freq_dist[dfl_dist_code(dist)]++;
+	} else {
+		d->freq_lit[lit]++;
+	}
+
+	return d->syms_c < DFL_SYMS_MAX || dfl_block(d, out, 0);
+}
+
+/* = Matching = */
+static void
+dfl_insert(struct dfl *d, size_t p)
+{
+	if (p + DFL_MIN_MATCH > d->win_len)
+		return;
+
+	const unsigned char *s = d->win + p;
+	uint32_t h = ((s[0] << 10) ^ (s[1] << 5) ^ s[2]) & DFL_HMASK;
+	d->prev[p & DFL_WMASK] = d->head[h];
+	d->head[h]             = p + 1;
+}
+
+static unsigned int
+dfl_find(struct dfl *d, size_t p, unsigned int *dist)
+{
+	/* Insert `p` and return the longest match before it. */
+	size_t avail = d->win_len - p;
+	if (avail < DFL_MIN_MATCH)
+		return 0;
+
+	const unsigned char *s = d->win + p;
+	uint32_t h    = ((s[0] << 10) ^ (s[1] << 5) ^ s[2]) & DFL_HMASK;
+	uint32_t cand = d->head[h];
+	d->prev[p & DFL_WMASK] = cand;
+	d->head[h]             = p + 1;
+
+	unsigned int len_max = avail < DFL_MAX_MATCH ? avail : DFL_MAX_MATCH;
+	unsigned int best    = 0;
+	for (unsigned int chain = d->chain_max; cand && chain; chain--) {
+		size_t c = cand - 1;
+		if (c >= p || p - c >= DFL_WSIZE)
+			break;
+
+		const unsigned char *m = d->win + c;
+		if (m[best] == s[best] && m[0] == s[0] && m[1] == s[1]) {
+			unsigned int len = 2;
+			while (len < len_max && m[len] == s[len])
+				len++;
+			if (len > best) {
+				best  = len;
+				*dist = p - c;
+				if (best >= d->nice_len || best == len_max)
+					break;
+			}
+		}
+
+		uint32_t next = d->prev[c & DFL_WMASK];
+		if (next >= cand)
+			break; /* overwritten by a newer position */
+		cand = next;
+	}
+
+	return best >= DFL_MIN_MATCH ? best : 0;
+}
+
+static int
+dfl_match(struct dfl *d, struct mg_iobuf *out, size_t p, unsigned int len,
+          unsigned int dist)
+{
+	/* Emit the match at `p` and hash the rest of its positions. */
+	for (size_t q = p + 1; q < p + len; q++)
+		if (q >= d->pos)
+			dfl_insert(d, q);
+
+	return dfl_sym(d, out, len, dist);
+}
+
+static int
+dfl_deflate(struct dfl *d, struct mg_iobuf *out, int is_flush)
+{
+	size_t end = is_flush ? d->win_len
+	             : d->win_len > DFL_LOOKAHEAD ? d->win_len - DFL_LOOKAHEAD
+	                                          : 0;
+
+	while (d->pos < end) {
+		size_t       p    = d->pos;
+		unsigned int dist = 0, len;
+
+		if (!d->is_lazy) {
+			len = dfl_find(d, p, &dist);
+			d->pos++;
+			if (!(len ? dfl_match(d, out, p, len, dist)
+			          : dfl_sym(d, out, d->win[p], 0)))
+				return 0;
+			d->pos = p + (len ? len : 1);
+			continue;
+		}
+
+		/* Take the match at `p - 1` unless the one at `p` is longer. */
+		if (d->has_prev && d->prev_len >= d->nice_len) {
+			dfl_insert(d, p);
+			len = 0;
+		} else {
+			len = dfl_find(d, p, &dist);
+		}
+		if (d->has_prev && d->prev_len && len <= d->prev_len) {
+			d->pos = p + 1;
+			if (!dfl_match(d, out, p - 1, d->prev_len, d->prev_dist))
+				return 0;
+			d->pos      = p - 1 + d->prev_len;
+			d->has_prev = 0;
+			continue;
+		}
+		if (d->has_prev && !dfl_sym(d, out, d->win[p - 1], 0))
+			return 0;
+		d->has_prev  = 1;
+		d->prev_len  = len;
+		d->prev_dist = dist;
+		d->pos       = p + 1;
+	}
+
+	if (is_flush && d->has_prev) {
+		/* Only a literal can be left as the window ends here. */
+		d->has_prev = 0;
+		return dfl_sym(d, out, d->win[d->pos - 1], 0);
+	}
+
+	return 1;
+}
+
+static void
+dfl_slide(struct dfl *d)
+{
+	memmove(d->win, d->win + DFL_WSIZE, d->win_len - DFL_WSIZE);
+	d->win_len -= DFL_WSIZE;
+	d->pos -= DFL_WSIZE;
+	for (size_t i = 0; i < sizeof(d->head) / sizeof(d->head[0]); i++)
+		d->head[i] = d->head[i] > DFL_WSIZE ? d->head[i] - DFL_WSIZE : 0;
+	for (size_t i = 0; i < DFL_WSIZE; i++)
+		d->prev[i] = d->prev[i] > DFL_WSIZE ? d->prev[i] - DFL_WSIZE : 0;
+}
+
+/* = Framing = */
+static uint32_t
+dfl_adler32(uint32_t adler, const unsigned char *buf, size_t len)
+{
+	uint32_t a = adler & 0xffff, b = adler >> 16;
+	while (len) {
+		/* 5552 is the most bytes before `b` can overflow. */
+		size_t n = len < 5552 ? len : 5552;
+		len -= n;
+		while (n--) {
+			a += *buf++;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+
+	return (b << 16) | a;
+}
+
+static int
+dfl_header(struct dfl *d, struct mg_iobuf *out)
+{
+	static const unsigned char gzip[10] = { 0x1f, 0x8b, 8, 0, 0,
+		                                0,    0,    0, 0, 3 };
+	static const unsigned char zlib[2]  = { 0x78, 0x9c };
+
+	d->is_started = 1;
+	d->check      = d->format == DFL_ZLIB ? 1 : 0;
+	switch (d->format) {
+	case DFL_GZIP:
+		return dfl_put_bytes(out, gzip, sizeof(gzip));
+	case DFL_ZLIB:
+		return dfl_put_bytes(out, zlib, sizeof(zlib));
+	default:
+		return 1;
+	}
+}
+
+static int
+dfl_trailer(struct dfl *d, struct mg_iobuf *out)
+{
+	unsigned char t[8];
+	switch (d->format) {
+	case DFL_GZIP:
+		for (int i = 0; i < 4; i++) {
+			t[i]     = (unsigned char)(d->check >> (8 * i));
+			t[4 + i] = (unsigned char)(d->in_len >> (8 * i));
+		}
+		return dfl_put_bytes(out, t, 8);
+	case DFL_ZLIB:
+		for (int i = 0; i < 4; i++)
+			t[i] = (unsigned char)(d->check >> (24 - 8 * i));
+		return dfl_put_bytes(out, t, 4);
+	default:
+		return 1;
+	}
+}
+
+struct dfl *
+dfl_new(int level, enum dfl_format_t format)
+{
+	struct dfl *d = calloc(1, sizeof(struct dfl));
+	if (!d)
+		return NULL;
+
+	level        = level < 1 ? 1 : level > DFL_LEVEL_MAX ? DFL_LEVEL_MAX : level;
+	d->format    = format;
+	d->chain_max = dfl_levels[level][0];
+	d->nice_len  = dfl_levels[level][1];
+	d->is_lazy   = dfl_levels[level][2];
+
+	return d;
+}
+
+int
+dfl_write(struct dfl *d, struct mg_iobuf *out, const void *buf, size_t len,
+          enum dfl_flush_t flush)
+{
+	const unsigned char *in = buf;
+
+	if (d->is_finished)
+		return 0;
+	if (!d->is_started && !dfl_header(d, out))
+		return 0;
+
+	d->in_len += len;
+	d->check = d->format == DFL_GZIP ? mg_crc32(d->check, buf, len)
+	           : d->format == DFL_ZLIB ? dfl_adler32(d->check, in, len)
+	                                   : 0;
+
+	while (len) {
+		if (d->win_len == sizeof(d->win))
+			dfl_slide(d);
+		size_t n = sizeof(d->win) - d->win_len;
+		n        = n < len ? n : len;
+		memcpy(d->win + d->win_len, in, n);
+		d->win_len += n;
+		in += n;
+		len -= n;
+		if (!dfl_deflate(d, out, 0))
+			return 0;
+	}
+
+	if (flush == DFL_NO_FLUSH)
+		return 1;
+	if (!dfl_deflate(d, out, 1))
+		return 0;
+
+	if (flush == DFL_FINISH) {
+		d->is_finished = 1;
+		return dfl_block(d, out, 1) && dfl_align(d, out) &&
+		       dfl_trailer(d, out);
+	}
+
+	/* An empty stored block after the data to get to a byte boundary. */
+	static const unsigned char sync[4] = { 0, 0, 0xff, 0xff };
+	return (!d->syms_c || dfl_block(d, out, 0)) &&
+	       dfl_put_bits(d, out, 0, 3) && dfl_align(d, out) &&
+	       dfl_put_bytes(out, sync, sizeof(sync));
+}
+
+int
+dfl_compress(struct mg_iobuf *out, const void *buf, size_t len, int level,
+             enum dfl_format_t format)
+{
+	struct dfl *d = dfl_new(level, format);
+	if (!d)
+		return 0;
+
+	int ok = dfl_write(d, out, buf, len, DFL_FINISH);
+	dfl_free(d);
+
+	return ok;
+}
+
+void
+dfl_free(struct dfl *d)
+{
+	free(d);
+}
+
+#endif /* MRSPS_DEFLATE_IMPLEMENTATION */
@@ -0,0 +1,610 @@
+/*
+ ===============================================================================
+ |                                Dependencies                                 |
+ ===============================================================================
+ *
+ * -> mongoose
+ */
+
+/*
+ ===============================================================================
+ |                                    Usage                                    |
+ ===============================================================================
+ *
+ * Do this:
+ *
+ *         #define MRSPS_JSONW_IMPLEMENTATION
+ *
+ * before you include this file in *one* C or C++ file to create the
+ * implementation.
+ *
+ * A compact JSON writer appending straight to a 'struct mg_iobuf' or a fixed
+ * buffer, with no allocation per value and no printf. The separators are
+ * tracked by the writer, so values are written in order:
+ *
+ *         jw_object_begin(&w);
+ *         jw_key(&w, "n");
+ *         jw_int(&w, 1);
+ *         jw_key(&w, "x");
+ *         jw_float(&w, 0.1f);
+ *         jw_object_end(&w);
+ *
+ * gives '{"n":1,"x":0.1}'.
+ *
+ * Floats are written with the fewest digits that read back as the same float
+ * (Ryu, see https://github.com/ulfjack/ryu), so the solvers' rounded values
+ * come out as rounded: 1.20312 rather than 1.203119993209839.
+ */
+
+/*
+ ===============================================================================
+ |                              HEADER-FILE MODE                               |
+ ===============================================================================
+ */
+
+#ifndef MRSPS_JSONW_H
+#define MRSPS_JSONW_H
+
+#include "../dep/mongoose.h"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* = Options = */
+#define JW_DEPTH_MAX 32 /* Nesting of objects and arrays. */
+#define JW_NUM_MAX   32 /* Longest number written, in bytes. */
+
+struct jw {
+	struct mg_iobuf *io; /* Appended to, or NULL to write to `buf`. */
+	char            *buf;
+	size_t           size, len; /* Of `buf`. */
+
+	unsigned int depth;
+	uint32_t     has_items; /* Bit per depth, set once it has a value. */
+	int          is_after_key;
+	int          is_truncated; /* Set if something didn't fit. */
+};
+
+/*
+ ===============================================================================
+ |                            Function Declarations                            |
+ ===============================================================================
+ */
+void
+jw_init(struct jw *w, struct mg_iobuf *io);
+/*
+ * Write to the end of `io`, growing it as needed.
+ *
+ * `io->len` can be reset between the values, e.g. once sent, without
+ * disturbing the writer.
+ */
+
+void
+jw_init_buf(struct jw *w, char *buf, size_t size);
+/*
+ * Write to the fixed `buf` of `size` bytes, `w->len` of them are used so far.
+ * The output isn't NUL terminated.
+ *
+ * What doesn't fit is dropped and `w->is_truncated` is set.
+ */
+
+void
+jw_object_begin(struct jw *w);
+
+void
+jw_object_end(struct jw *w);
+
+void
+jw_array_begin(struct jw *w);
+
+void
+jw_array_end(struct jw *w);
+
+void
+jw_key(struct jw *w, const char *key);
+/* Write the key of the next member of the current object. */
+
+void
+jw_str(struct jw *w, const char *str, size_t len);
+/* Write the string, escaped as needed. */
+
+void
+jw_raw(struct jw *w, const char *json, size_t len);
+/* Write the value already encoded as `json`, as it is. */
+
+void
+jw_int(struct jw *w, long num);
+
+void
+jw_float(struct jw *w, float num);
+/* Write the shortest number reading back as `num`, or null if not finite. */
+
+size_t
+jw_float_fmt(char *buf, float num);
+/*
+ * Same as 'jw_float' but into `buf` of at least JW_NUM_MAX bytes, returning the
+ * length. Not NUL terminated.
+ */
+
+#endif /* MRSPS_JSONW_H */
+
+/*
+ ===============================================================================
+ |                             IMPLEMENTATION MODE                             |
+ ===============================================================================
+ */
+
+#ifdef MRSPS_JSONW_IMPLEMENTATION
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+/* = Output = */
+static char *
+jw_reserve(struct jw *w, size_t n)
+{
+	if (w->io) {
+		struct mg_iobuf *io = w->io;
+		if (io->len + n > io->size) {
+			size_t size = io->size * 2;
+			if (size < io->len + n)
+				size = io->len + n + MG_IO_SIZE;
+			if (!mg_iobuf_resize(io, size)) {
+				w->is_truncated = 1;
+				return NULL;
+			}
+		}
+		return (char *)io->buf + io->len;
+	}
+
+	if (w->len + n > w->size) {
+		w->is_truncated = 1;
+		return NULL;
+	}
+	return w->buf + w->len;
+}
+
+static void
+jw_commit(struct jw *w, size_t n)
+{
+	if (w->io)
+		w->io->len += n;
+	else
+		w->len += n;
+}
+
+static void
+jw_write(struct jw *w, const char *s, size_t n)
+{
+	char *p = jw_reserve(w, n);
+	if (!p)
+		return;
+	memcpy(p, s, n);
+	jw_commit(w, n);
+}
+
+static void
+jw_write_str(struct jw *w, const char *str, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	size_t esc_len = len + 2;
+	for (size_t i = 0; i < len; i++) {
+		unsigned char ch = str[i];
+		if (ch == '"' || ch == '\\')
+			esc_len += 1;
+		else if (ch < 0x20)
+			esc_len += 5; /* \u00XX */
+	}
+	char *p = jw_reserve(w, esc_len);
+	if (!p)
+		return;
+
+	size_t n = 0;
+	p[n++]   = '"';
+	for (size_t i = 0; i < len; i++) {
+		unsigned char ch = str[i];
+		if (ch == '"' || ch == '\\') {
+			p[n++] = '\\';
+			p[n++] = ch;
+		} else if (ch < 0x20) {
+			p[n++] = '\\';
+			p[n++] = 'u';
+			p[n++] = '0';
+			p[n++] = '0';
+			p[n++] = hex[ch >> 4];
+			p[n++] = hex[ch & 0xf];
+		} else {
+			p[n++] = ch;
+		}
+	}
+	p[n++] = '"';
+	jw_commit(w, n);
+}
+
+static void
+jw_value(struct jw *w)
+{
+	/* Comma unless first in its parent or following a key. */
+	uint32_t bit = 1u << (w->depth % JW_DEPTH_MAX);
+	if (w->is_after_key)
+		w->is_after_key = 0;
+	else if (w->has_items & bit)
+		jw_write(w, ",", 1);
+	w->has_items |= bit;
+}
+
+static void
+jw_begin(struct jw *w, char ch)
+{
+	jw_value(w);
+	jw_write(w, &ch, 1);
+	w->depth++;
+	w->has_items &= ~(1u << (w->depth % JW_DEPTH_MAX));
+}
+
+static void
+jw_end(struct jw *w, char ch)
+{
+	w->depth--;
+	jw_write(w, &ch, 1);
+}
+
+/* = Ryu for floats = */
+#define JW_POW5_INV_BITCOUNT 59
+#define JW_POW5_BITCOUNT     61
+
+static const uint64_t jw_pow5_inv_split[31] = {
+	576460752303423489ULL, 461168601842738791ULL, 368934881474191033ULL,
+	295147905179352826ULL, 472236648286964522ULL, 377789318629571618ULL,
+	302231454903657294ULL, 483570327845851670ULL, 386856262276681336ULL,
+	309485009821345069ULL, 495176015714152110ULL, 396140812571321688ULL,
+	316912650057057351ULL, 507060240091291761ULL, 405648192073033409ULL,
+	324518553658426727ULL, 519229685853482763ULL, 415383748682786211ULL,
+	332306998946228969ULL, 531691198313966350ULL, 425352958651173080ULL,
+	340282366920938464ULL, 544451787073501542ULL, 435561429658801234ULL,
+	348449143727040987ULL, 557518629963265579ULL, 446014903970612463ULL,
+	356811923176489971ULL, 570899077082383953ULL, 456719261665907162ULL,
+	365375409332725730ULL,
+};
+
+static const uint64_t jw_pow5_split[47] = {
+	1152921504606846976ULL, 1441151880758558720ULL, 1801439850948198400ULL,
+	2251799813685248000ULL, 1407374883553280000ULL, 1759218604441600000ULL,
+	2199023255552000000ULL, 1374389534720000000ULL, 1717986918400000000ULL,
+	2147483648000000000ULL, 1342177280000000000ULL, 1677721600000000000ULL,
+	2097152000000000000ULL, 1310720000000000000ULL, 1638400000000000000ULL,
+	2048000000000000000ULL, 1280000000000000000ULL, 1600000000000000000ULL,
+	2000000000000000000ULL, 1250000000000000000ULL, 1562500000000000000ULL,
+	1953125000000000000ULL, 1220703125000000000ULL, 1525878906250000000ULL,
+	1907348632812500000ULL, 1192092895507812500ULL, 1490116119384765625ULL,
+	1862645149230957031ULL, 1164153218269348144ULL, 1455191522836685180ULL,
+	1818989403545856475ULL, 2273736754432320594ULL, 1421085471520200371ULL,
+	1776356839400250464ULL, 2220446049250313080ULL, 1387778780781445675ULL,
+	1734723475976807094ULL, 2168404344971008868ULL, 1355252715606880542ULL,
+	1694065894508600678ULL, 2117582368135750847ULL, 1323488980084844279ULL,
+	1654361225106055349ULL, 2067951531382569187ULL, 1292469707114105741ULL,
+	1615587133892632177ULL, 2019483917365790221ULL,
+};
+
+static int32_t
+jw_pow5_bits(int32_t e)
+{
+	/* ceil(log2(5^e)), 1 for e = 0 */
+	return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+static uint32_t
+jw_log10_pow2(int32_t e)
+{
+	return ((uint32_t)e * 78913) >> 18;
+}
+
+static uint32_t
+jw_log10_pow5(int32_t e)
+{
+	return ((uint32_t)e * 732923) >> 20;
+}
+
+static int
+jw_is_multiple_pow5(uint32_t value, uint32_t p)
+{
+	uint32_t count = 0;
+	for (; value % 5 == 0; value /= 5)
+		count++;
+
+	return count >= p;
+}
+
+static uint32_t
+jw_mul_shift(uint32_t m, uint64_t factor, int32_t shift)
+{
+	uint64_t lo = (uint64_t)m * (uint32_t)factor;
+	uint64_t hi = (uint64_t)m * (uint32_t)(factor >> 32);
+
+	return (uint32_t)(((lo >> 32) + hi) >> (shift - 32));
+}
+
+static uint32_t
+jw_shortest(uint32_t ieee_mantissa, uint32_t ieee_exponent, int32_t *e10_out)
+{
+	/* The float is m2 * 2^e2, with 2 more bits for the halfway points. */
+	int32_t  e2;
+	uint32_t m2;
+	if (ieee_exponent == 0) {
+		e2 = 1 - 127 - 23 - 2;
+		m2 = ieee_mantissa;
+	} else {
+		e2 = (int32_t)ieee_exponent - 127 - 23 - 2;
+		m2 = (1u << 23) | ieee_mantissa;
+	}
+	int accept_bounds = (m2 & 1) == 0;
+
+	/* The value and its neighbours' halfway points. */
+	uint32_t mv       = 4 * m2;
+	uint32_t mp       = 4 * m2 + 2;
+	uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+	uint32_t mm       = 4 * m2 - 1 - mm_shift;
+
+	/* Convert to decimal: vr * 10^e10, and the same for vp and vm. */
+	uint32_t vr, vp, vm;
+	int32_t  e10;
+	int      vm_is_trailing_zeros = 0, vr_is_trailing_zeros = 0;
+	uint8_t  last_removed_digit   = 0;
+	if (e2 >= 0) {
+		uint32_t q = jw_log10_pow2(e2);
+		int32_t  k = JW_POW5_INV_BITCOUNT + jw_pow5_bits(q) - 1;
+		int32_t  i = -e2 + (int32_t)q + k;
+		e10        = q;
+		vr         = jw_mul_shift(mv, jw_pow5_inv_split[q], i);
+		vp         = jw_mul_shift(mp, jw_pow5_inv_split[q], i);
+		vm         = jw_mul_shift(mm, jw_pow5_inv_split[q], i);
+		if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+			/* The loop below won't run, the digit is needed still. */
+			int32_t l = JW_POW5_INV_BITCOUNT + jw_pow5_bits(q - 1) - 1;
+			last_removed_digit =
+				jw_mul_shift(mv, jw_pow5_inv_split[q - 1],
+			                     -e2 + (int32_t)q - 1 + l) % 10;
+		}
+		if (q <= 9) {
+			/* Only one of mp, mv and mm can be a multiple of 5. */
+			if (mv % 5 == 0)
+				vr_is_trailing_zeros = jw_is_multiple_pow5(mv, q);
+			else if (accept_bounds)
+				vm_is_trailing_zeros = jw_is_multiple_pow5(mm, q);
+			else
+				vp -= jw_is_multiple_pow5(mp, q);
+		}
+	} else {
+		uint32_t q = jw_log10_pow5(-e2);
+		int32_t  i = -e2 - (int32_t)q;
+		int32_t  k = jw_pow5_bits(i) - JW_POW5_BITCOUNT;
+		int32_t  j = (int32_t)q - k;
+		e10        = (int32_t)q + e2;
+		vr         = jw_mul_shift(mv, jw_pow5_split[i], j);
+		vp         = jw_mul_shift(mp, jw_pow5_split[i], j);
+		vm         = jw_mul_shift(mm, jw_pow5_split[i], j);
+		if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+			j = (int32_t)q - 1 -
+			    (jw_pow5_bits(i + 1) - JW_POW5_BITCOUNT);
+			last_removed_digit =
+				jw_mul_shift(mv, jw_pow5_split[i + 1], j) % 10;
+		}
+		if (q <= 1) {
+			/* mv = 4 * m2 has at least 2 trailing 0 bits. */
+			vr_is_trailing_zeros = 1;
+			if (accept_bounds)
+				vm_is_trailing_zeros = mm_shift == 1;
+			else
+				vp--;
+		} else if (q < 31) {
+			vr_is_trailing_zeros = (mv & ((1u << (q - 1)) - 1)) == 0;
+		}
+	}
+
+	/* Drop the digits while vp and vm differ, then round vr. */
+	int32_t  removed = 0;
+	uint32_t output;
+	if (vm_is_trailing_zeros || vr_is_trailing_zeros) {
+		for (; vp / 10 > vm / 10; removed++) {
+			vm_is_trailing_zeros &= vm % 10 == 0;
+			vr_is_trailing_zeros &= last_removed_digit == 0;
+			last_removed_digit = vr % 10;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+		}
+		if (vm_is_trailing_zeros) {
+			for (; vm % 10 == 0; removed++) {
+				vr_is_trailing_zeros &= last_removed_digit == 0;
+				last_removed_digit = vr % 10;
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+			}
+		}
+		if (vr_is_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0)
+			last_removed_digit = 4; /* round half to even */
+		output = vr + ((vr == vm && (!accept_bounds ||
+		                             !vm_is_trailing_zeros)) ||
+		               last_removed_digit >= 5);
+	} else {
+		for (; vp / 10 > vm / 10; removed++) {
+			last_removed_digit = vr % 10;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+		}
+		output = vr + (vr == vm || last_removed_digit >= 5);
+	}
+
+	*e10_out = e10 + removed;
+	return output;
+}
+
+size_t
+jw_float_fmt(char *buf, float num)
+{
+	uint32_t bits;
+	memcpy(&bits, &num, sizeof(bits));
+	uint32_t ieee_mantissa = bits & ((1u << 23) - 1);
+	uint32_t ieee_exponent = (bits >> 23) & 0xff;
+	size_t   len           = 0;
+
+	if (ieee_exponent == 0xff) {
+		memcpy(buf, "null", 4);
+		return 4;
+	}
+	if (bits >> 31)
+		buf[len++] = '-';
+	if (ieee_exponent == 0 && ieee_mantissa == 0) {
+		buf[len++] = '0';
+		return len;
+	}
+
+	int32_t  exp;
+	uint32_t output = jw_shortest(ieee_mantissa, ieee_exponent, &exp);
+
+	char     digits[10];
+	int32_t  digits_c = 0;
+	for (; output; output /= 10)
+		digits[9 - digits_c++] = '0' + output % 10;
+	char *d = digits + 10 - digits_c;
+
+	/* Laid out as JavaScript does: plain between 1e-7 and 1e21. */
+	int32_t point = digits_c + exp; /* Digits before the decimal point. */
+	if (point > -6 && point <= 21) {
+		if (point <= 0) {
+			buf[len++] = '0';
+			buf[len++] = '.';
+			for (int32_t i = point; i < 0; i++)
+				buf[len++] = '0';
+			memcpy(buf + len, d, digits_c);
+			len += digits_c;
+		} else if (point >= digits_c) {
+			memcpy(buf + len, d, digits_c);
+			len += digits_c;
+			for (int32_t i = digits_c; i < point; i++)
+				buf[len++] = '0';
+		} else {
+			memcpy(buf + len, d, point);
+			len += point;
+			buf[len++] = '.';
+			memcpy(buf + len, d + point, digits_c - point);
+			len += digits_c - point;
+		}
+		return len;
+	}
+
+	buf[len++] = d[0];
+	if (digits_c > 1) {
+		buf[len++] = '.';
+		memcpy(buf + len, d + 1, digits_c - 1);
+		len += digits_c - 1;
+	}
+	int32_t e = point - 1;
+	buf[len++] = 'e';
+	buf[len++] = e < 0 ? '-' : '+';
+	if (e < 0)
+		e = -e;
+	if (e >= 10)
+		buf[len++] = '0' + e / 10;
+	buf[len++] = '0' + e % 10;
+
+	return len;
+}
+
+/* = Writer = */
+void
+jw_init(struct jw *w, struct mg_iobuf *io)
+{
+	memset(w, 0, sizeof(*w));
+	w->io = io;
+}
+
+void
+jw_init_buf(struct jw *w, char *buf, size_t size)
+{
+	memset(w, 0, sizeof(*w));
+	w->buf  = buf;
+	w->size = size;
+}
+
+void
+jw_object_begin(struct jw *w)
+{
+	jw_begin(w, '{');
+}
+
+void
+jw_object_end(struct jw *w)
+{
+	jw_end(w, '}');
+}
+
+void
+jw_array_begin(struct jw *w)
+{
+	jw_begin(w, '[');
+}
+
+void
+jw_array_end(struct jw *w)
+{
+	jw_end(w, ']');
+}
+
+void
+jw_key(struct jw *w, const char *key)
+{
+	jw_value(w);
+	jw_write_str(w, key, strlen(key));
+	jw_write(w, ":", 1);
+	w->is_after_key = 1;
+}
+
+void
+jw_str(struct jw *w, const char *str, size_t len)
+{
+	jw_value(w);
+	jw_write_str(w, str, len);
+}
+
+void
+jw_raw(struct jw *w, const char *json, size_t len)
+{
+	jw_value(w);
+	jw_write(w, json, len);
+}
+
+void
+jw_int(struct jw *w, long num)
+{
+	char          tmp[24];
+	size_t        n = sizeof(tmp);
+	unsigned long u = num < 0 ? 0UL - (unsigned long)num : (unsigned long)num;
+
+	jw_value(w);
+	do {
+		tmp[--n] = '0' + u % 10;
+		u /= 10;
+	} while (u);
+	if (num < 0)
+		tmp[--n] = '-';
+	jw_write(w, tmp + n, sizeof(tmp) - n);
+}
+
+void
+jw_float(struct jw *w, float num)
+{
+	char tmp[JW_NUM_MAX];
+
+	jw_value(w);
+	jw_write(w, tmp, jw_float_fmt(tmp, num));
+}
+
+#endif /* MRSPS_JSONW_IMPLEMENTATION */
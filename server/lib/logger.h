@@ -0,0 +1,398 @@
+/*
+ ===============================================================================
+ |                                Dependencies                                 |
+ ===============================================================================
+ *
+ * -> mongoose
+ * -> pthreads
+ * -> GCC/Clang builtins ('__thread', '__atomic_*')
+ */
+
+/*
+ ===============================================================================
+ |                                    Usage                                    |
+ ===============================================================================
+ *
+ * Do this:
+ *
+ *         #define MRSPS_LOGGER_IMPLEMENTATION
+ *
+ * before you include this file in *one* C or C++ file to create the
+ * implementation.
+ *
+ * A log written from the serving threads without a system call per line. Each
+ * thread formats its records into a ring buffer of its own, which a background
+ * thread writes out every LGR_FLUSH_MS, or sooner once half full, in one write
+ * per ring.
+ *
+ * A record never waits for room: if the ring of its thread is full it is
+ * dropped and counted, and the count is logged on the next flush. Records
+ * from different threads are whole lines but not in time order.
+ *
+ * Mongoose's log, which goes out a character at a time, is collected into
+ * lines per thread and logged as records after 'lgr_mg_redirect'.
+ */
+
+/*
+ ===============================================================================
+ |                              HEADER-FILE MODE                               |
+ ===============================================================================
+ */
+
+#ifndef MRSPS_LOGGER_H
+#define MRSPS_LOGGER_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "../dep/mongoose.h"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* = Options = */
+#define LGR_RING_SIZE (64 * 1024) /* Per thread, a power of 2 */
+#define LGR_LINE_MAX  512         /* Longer records are cut */
+#define LGR_FLUSH_MS  100
+
+struct lgr_ring {
+	size_t           head; /* Written up to, by the owning thread only. */
+	struct lgr      *owner;
+	struct lgr_ring *next;
+	char             line[LGR_LINE_MAX]; /* Mongoose's line being collected */
+	size_t           line_len;
+	char             buf[LGR_RING_SIZE];
+	size_t           tail; /* Flushed up to, by the flushing thread only. */
+};
+
+struct lgr {
+	int              fd;
+	struct lgr_ring *rings; /* One per thread that logged. */
+	uint64_t         dropped, dropped_logged;
+
+	pthread_t       thread;
+	pthread_mutex_t lock;
+	pthread_cond_t  cond; /* Signaled to flush early or stop. */
+	int             is_stopping;
+};
+
+/*
+ ===============================================================================
+ |                            Function Declarations                            |
+ ===============================================================================
+ */
+int
+lgr_init(struct lgr *l, int fd);
+/*
+ * Start the thread writing the log to `fd`.
+ *
+ * Returns 0 on failure.
+ */
+
+void
+lgr_write(struct lgr *l, const char *buf, size_t len);
+/* Log the record of `len` bytes, which should end with a newline. */
+
+void
+lgr_printf(struct lgr *l, const char *fmt, ...);
+/* Log the formatted record, LGR_LINE_MAX long at most. A newline is added. */
+
+void
+lgr_access(struct lgr *l, struct mg_str method, struct mg_str uri, int status,
+           uint64_t duration_ns, size_t bytes_in, size_t bytes_out);
+/* Log the access record of a request. */
+
+void
+lgr_mg_redirect(struct lgr *l);
+/* Have the log of mongoose written through the logger. */
+
+uint64_t
+lgr_dropped(struct lgr *l);
+/* Number of records dropped for lack of room so far. */
+
+void
+lgr_free(struct lgr *l);
+/*
+ * Write out what's left and stop the thread. No thread should log anymore,
+ * mongoose's log goes back to the standard output.
+ */
+
+#endif /* MRSPS_LOGGER_H */
+
+/*
+ ===============================================================================
+ |                             IMPLEMENTATION MODE                             |
+ ===============================================================================
+ */
+
+#ifdef MRSPS_LOGGER_IMPLEMENTATION
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* Ring of the calling thread. */
+static __thread struct lgr_ring *lgr_self;
+
+/* Where mongoose's log goes, NULL for the standard output. */
+static struct lgr *lgr_mg;
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+static struct lgr_ring *
+lgr_ring(struct lgr *l)
+{
+	struct lgr_ring *ring = lgr_self;
+	if (ring && ring->owner == l)
+		return ring;
+
+	/* First record of the thread. */
+	if (!(ring = calloc(1, sizeof(struct lgr_ring))))
+		return NULL;
+	ring->owner = l;
+	ring->next  = __atomic_load_n(&l->rings, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&l->rings, &ring->next, ring, 1,
+	                                    __ATOMIC_RELEASE,
+	                                    __ATOMIC_RELAXED))
+		;
+
+	return lgr_self = ring;
+}
+
+static void
+lgr_drop(struct lgr *l)
+{
+	__atomic_fetch_add(&l->dropped, 1, __ATOMIC_RELAXED);
+}
+
+static int
+lgr_write_all(int fd, struct iovec *iov, int iov_c)
+{
+	/* Whatever can't be written is given up on rather than retried. */
+	while (iov_c) {
+		ssize_t n = writev(fd, iov, iov_c);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return 0;
+		for (; iov_c && (size_t)n >= iov->iov_len; iov++, iov_c--)
+			n -= iov->iov_len;
+		if (iov_c) {
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+
+	return 1;
+}
+
+static void
+lgr_flush(struct lgr *l)
+{
+	struct lgr_ring *ring = __atomic_load_n(&l->rings, __ATOMIC_ACQUIRE);
+	for (; ring; ring = ring->next) {
+		size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		size_t len  = head - ring->tail;
+		if (!len)
+			continue;
+
+		/* Two parts if it wraps around. */
+		size_t       ofs   = ring->tail & (LGR_RING_SIZE - 1);
+		size_t       first = LGR_RING_SIZE - ofs < len ? LGR_RING_SIZE - ofs
+		                                               : len;
+		struct iovec iov[2];
+		iov[0].iov_base = ring->buf + ofs;
+		iov[0].iov_len  = first;
+		iov[1].iov_base = ring->buf;
+		iov[1].iov_len  = len - first;
+		lgr_write_all(l->fd, iov, iov[1].iov_len ? 2 : 1);
+
+		__atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+	}
+
+	uint64_t dropped = __atomic_load_n(&l->dropped, __ATOMIC_RELAXED);
+	if (dropped != l->dropped_logged) {
+		char         line[96];
+		struct iovec iov;
+		iov.iov_base = line;
+		iov.iov_len  = mg_snprintf(line, sizeof(line),
+		                           "%llx lgr: %llu record(s) dropped\n",
+		                           (unsigned long long)mg_millis(),
+		                           (unsigned long long)(dropped -
+		                                                l->dropped_logged));
+		lgr_write_all(l->fd, &iov, 1);
+		l->dropped_logged = dropped;
+	}
+}
+
+static void *
+lgr_run(void *arg)
+{
+	struct lgr *l = arg;
+
+	pthread_mutex_lock(&l->lock);
+	while (!l->is_stopping) {
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += LGR_FLUSH_MS * 1000000L;
+		ts.tv_sec += ts.tv_nsec / 1000000000L;
+		ts.tv_nsec %= 1000000000L;
+		pthread_cond_timedwait(&l->cond, &l->lock, &ts);
+
+		pthread_mutex_unlock(&l->lock);
+		lgr_flush(l);
+		pthread_mutex_lock(&l->lock);
+	}
+	pthread_mutex_unlock(&l->lock);
+	lgr_flush(l);
+
+	return NULL;
+}
+
+int
+lgr_init(struct lgr *l, int fd)
+{
+	memset(l, 0, sizeof(*l));
+	l->fd = fd;
+	pthread_mutex_init(&l->lock, NULL);
+	pthread_cond_init(&l->cond, NULL);
+	if (pthread_create(&l->thread, NULL, lgr_run, l) != 0) {
+		pthread_mutex_destroy(&l->lock);
+		pthread_cond_destroy(&l->cond);
+		return 0;
+	}
+
+	return 1;
+}
+
+void
+lgr_write(struct lgr *l, const char *buf, size_t len)
+{
+	struct lgr_ring *ring = lgr_ring(l);
+	if (!ring) {
+		lgr_drop(l);
+		return;
+	}
+
+	size_t head = ring->head;
+	size_t used = head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (len > LGR_RING_SIZE - used) {
+		lgr_drop(l);
+		return;
+	}
+
+	size_t ofs   = head & (LGR_RING_SIZE - 1);
+	size_t first = LGR_RING_SIZE - ofs < len ? LGR_RING_SIZE - ofs : len;
+	memcpy(ring->buf + ofs, buf, first);
+	memcpy(ring->buf, buf + first, len - first);
+	__atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+
+	/* Woken up early once past half full, without taking the lock. */
+	if (used < LGR_RING_SIZE / 2 && used + len >= LGR_RING_SIZE / 2)
+		pthread_cond_signal(&l->cond);
+}
+
+void
+lgr_printf(struct lgr *l, const char *fmt, ...)
+{
+	char    line[LGR_LINE_MAX];
+	va_list ap;
+	va_start(ap, fmt);
+	size_t len = mg_vsnprintf(line, sizeof(line) - 1, fmt, &ap);
+	va_end(ap);
+
+	if (len > sizeof(line) - 2)
+		len = sizeof(line) - 2;
+	line[len++] = '\n';
+	lgr_write(l, line, len);
+}
+
+void
+lgr_access(struct lgr *l, struct mg_str method, struct mg_str uri, int status,
+           uint64_t duration_ns, size_t bytes_in, size_t bytes_out)
+{
+	lgr_printf(l,
+	           "%llx access method=%.*s uri=%.*s status=%d "
+	           "duration_us=%llu.%03llu bytes_in=%lu bytes_out=%lu",
+	           (unsigned long long)mg_millis(), (int)method.len, method.ptr,
+	           (int)uri.len, uri.ptr, status,
+	           (unsigned long long)(duration_ns / 1000),
+	           (unsigned long long)(duration_ns % 1000),
+	           (unsigned long)bytes_in, (unsigned long)bytes_out);
+}
+
+static void
+lgr_mg_putc(unsigned char ch)
+{
+	struct lgr *l = __atomic_load_n(&lgr_mg, __ATOMIC_ACQUIRE);
+	if (!l) {
+		putchar(ch);
+		return;
+	}
+
+	struct lgr_ring *ring = lgr_ring(l);
+	if (!ring) {
+		if (ch == '\n')
+			lgr_drop(l);
+		return;
+	}
+
+	/* A line too long is cut, what's past it starts another. */
+	ring->line[ring->line_len++] = (char)ch;
+	if (ch == '\n' || ring->line_len == LGR_LINE_MAX) {
+		ring->line[ring->line_len - 1] = '\n';
+		lgr_write(l, ring->line, ring->line_len);
+		ring->line_len = 0;
+	}
+}
+
+void
+lgr_mg_redirect(struct lgr *l)
+{
+	__atomic_store_n(&lgr_mg, l, __ATOMIC_RELEASE);
+	mg_log_set_fn(lgr_mg_putc);
+}
+
+uint64_t
+lgr_dropped(struct lgr *l)
+{
+	return __atomic_load_n(&l->dropped, __ATOMIC_RELAXED);
+}
+
+void
+lgr_free(struct lgr *l)
+{
+	if (__atomic_load_n(&lgr_mg, __ATOMIC_RELAXED) == l)
+		__atomic_store_n(&lgr_mg, NULL, __ATOMIC_RELEASE);
+
+	pthread_mutex_lock(&l->lock);
+	l->is_stopping = 1;
+	pthread_cond_signal(&l->cond);
+	pthread_mutex_unlock(&l->lock);
+	pthread_join(l->thread, NULL);
+
+	struct lgr_ring *ring = l->rings;
+	while (ring) {
+		struct lgr_ring *next = ring->next;
+		free(ring);
+		ring = next;
+	}
+	l->rings = NULL;
+	pthread_mutex_destroy(&l->lock);
+	pthread_cond_destroy(&l->cond);
+}
+
+#endif /* MRSPS_LOGGER_IMPLEMENTATION */
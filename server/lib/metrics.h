@@ -0,0 +1,463 @@
+/*
+ ===============================================================================
+ |                                Dependencies                                 |
+ ===============================================================================
+ *
+ * -> mongoose
+ * -> GCC/Clang builtins ('__thread', '__atomic_*', '__builtin_clzll')
+ */
+
+/*
+ ===============================================================================
+ |                                    Usage                                    |
+ ===============================================================================
+ *
+ * Do this:
+ *
+ *         #define MRSPS_METRICS_IMPLEMENTATION
+ *
+ * before you include this file in *one* C or C++ file to create the
+ * implementation.
+ *
+ * Counters of the requests handled per route, by status class and latency,
+ * the time spent in each phase of handling them, the work done by the solvers,
+ * the bytes moved and the open connections, printed in the Prometheus text
+ * exposition format.
+ *
+ * Every thread records into its own shard, so recording takes no lock and no
+ * atomic read-modify-write, only a plain add. Printing sums the shards.
+ */
+
+/*
+ ===============================================================================
+ |                              HEADER-FILE MODE                               |
+ ===============================================================================
+ */
+
+#ifndef MRSPS_METRICS_H
+#define MRSPS_METRICS_H
+
+#include "../dep/mongoose.h"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* = Options = */
+#define MTR_PREFIX      "mrsps_"
+#define MTR_ROUTES_MAX  32
+#define MTR_PHASES_MAX  8
+#define MTR_STATUS_C    6  /* Unknown, then the 1xx to 5xx classes. */
+#define MTR_BUCKET_MIN  10 /* Smallest bucket of 2^10 ns, about 1 us. */
+#define MTR_BUCKETS     25 /* Doubling up to 2^34 ns, about 17 s. */
+
+struct mtr_counts {
+	uint64_t requests[MTR_STATUS_C];
+	uint64_t buckets[MTR_BUCKETS + 1]; /* Not cumulative, last is +Inf. */
+	uint64_t duration_ns;
+	uint64_t phases_ns[MTR_PHASES_MAX];
+	uint64_t iterations, evaluations;
+};
+
+struct mtr_shard {
+	struct mtr_counts routes[MTR_ROUTES_MAX];
+	uint64_t          bytes_in, bytes_out;
+	uint64_t          conns; /* Opened minus closed, wraps below zero. */
+
+	const struct mtr *owner;
+	struct mtr_shard *next; /* Linkage in the list of shards. */
+};
+
+struct mtr {
+	const char       *routes[MTR_ROUTES_MAX]; /* Label of every route. */
+	int               routes_c;
+	const char       *phases[MTR_PHASES_MAX]; /* And of every phase. */
+	int               phases_c;
+	struct mtr_shard *shards; /* One per thread that recorded. */
+};
+
+/*
+ ===============================================================================
+ |                            Function Declarations                            |
+ ===============================================================================
+ */
+void
+mtr_init(struct mtr *m);
+/* Initialize the metrics with no routes. */
+
+int
+mtr_route(struct mtr *m, const char *name);
+/*
+ * Add a route labeled `name`, which should outlive the metrics, and return
+ * its index for recording. Routes should all be added before any recording.
+ *
+ * Returns -1 if there are MTR_ROUTES_MAX routes already.
+ */
+
+int
+mtr_phase(struct mtr *m, const char *name);
+/* Same as 'mtr_route' but for a phase of the requests. */
+
+uint64_t
+mtr_now_ns(void);
+/* Monotonic time in nanoseconds, to measure the durations with. */
+
+void
+mtr_request(struct mtr *m, int route, int status, uint64_t duration_ns);
+/* Count a request to the route that got the `status` after `duration_ns`. */
+
+void
+mtr_phase_time(struct mtr *m, int route, int phase, uint64_t duration_ns);
+/* Count `duration_ns` spent in the phase of a request to the route. */
+
+void
+mtr_solver(struct mtr *m, int route, unsigned long iterations,
+           unsigned long evaluations);
+/* Count the iterations and function evaluations done for the route. */
+
+void
+mtr_bytes(struct mtr *m, size_t in, size_t out);
+/* Count the bytes received and sent. */
+
+void
+mtr_conns(struct mtr *m, int delta);
+/* Count connections opened, or closed if `delta` is negative. */
+
+void
+mtr_print(struct mtr *m, struct mg_iobuf *io);
+/* Append the metrics in the text exposition format to `io`. */
+
+void
+mtr_free(struct mtr *m);
+/* Free the shards once every thread is done recording. */
+
+#endif /* MRSPS_METRICS_H */
+
+/*
+ ===============================================================================
+ |                             IMPLEMENTATION MODE                             |
+ ===============================================================================
+ */
+
+#ifdef MRSPS_METRICS_IMPLEMENTATION
+
+#include <time.h>
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* Shard of the calling thread. */
+static __thread struct mtr_shard *mtr_self;
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+static struct mtr_shard *
+mtr_shard(struct mtr *m)
+{
+	struct mtr_shard *shard = mtr_self;
+	if (shard && shard->owner == m)
+		return shard;
+
+	/* First record of the thread. */
+	if (!(shard = calloc(1, sizeof(struct mtr_shard))))
+		return NULL;
+	shard->owner = m;
+	shard->next  = __atomic_load_n(&m->shards, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&m->shards, &shard->next, shard, 1,
+	                                    __ATOMIC_RELEASE,
+	                                    __ATOMIC_RELAXED))
+		;
+
+	return mtr_self = shard;
+}
+
+static void
+mtr_add(uint64_t *counter, uint64_t n)
+{
+	/* Only the owning thread writes, the atomic store keeps the reads of
+	 * 'mtr_print' whole. */
+	__atomic_store_n(counter, *counter + n, __ATOMIC_RELAXED);
+}
+
+static uint64_t
+mtr_get(const uint64_t *counter)
+{
+	return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+void
+mtr_init(struct mtr *m)
+{
+	memset(m, 0, sizeof(*m));
+}
+
+int
+mtr_route(struct mtr *m, const char *name)
+{
+	if (m->routes_c == MTR_ROUTES_MAX)
+		return -1;
+	m->routes[m->routes_c] = name;
+
+	return m->routes_c++;
+}
+
+int
+mtr_phase(struct mtr *m, const char *name)
+{
+	if (m->phases_c == MTR_PHASES_MAX)
+		return -1;
+	m->phases[m->phases_c] = name;
+
+	return m->phases_c++;
+}
+
+uint64_t
+mtr_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+void
+mtr_request(struct mtr *m, int route, int status, uint64_t duration_ns)
+{
+	struct mtr_shard *shard = mtr_shard(m);
+	if (!shard || route < 0 || route >= m->routes_c)
+		return;
+	struct mtr_counts *counts = &shard->routes[route];
+
+	int class = status / 100;
+	mtr_add(&counts->requests[class > 0 && class < MTR_STATUS_C ? class : 0],
+	        1);
+
+	/* Smallest bucket whose bound of 2^(MTR_BUCKET_MIN + i) ns holds the
+	 * duration. */
+	int bucket = 0;
+	if (duration_ns > (1ULL << MTR_BUCKET_MIN)) {
+		bucket = 64 - __builtin_clzll(duration_ns - 1) - MTR_BUCKET_MIN;
+		if (bucket > MTR_BUCKETS)
+			bucket = MTR_BUCKETS;
+	}
+	mtr_add(&counts->buckets[bucket], 1);
+	mtr_add(&counts->duration_ns, duration_ns);
+}
+
+void
+mtr_phase_time(struct mtr *m, int route, int phase, uint64_t duration_ns)
+{
+	struct mtr_shard *shard = mtr_shard(m);
+	if (!shard || route < 0 || route >= m->routes_c || phase < 0 ||
+	    phase >= m->phases_c)
+		return;
+
+	mtr_add(&shard->routes[route].phases_ns[phase], duration_ns);
+}
+
+void
+mtr_solver(struct mtr *m, int route, unsigned long iterations,
+           unsigned long evaluations)
+{
+	struct mtr_shard *shard = mtr_shard(m);
+	if (!shard || route < 0 || route >= m->routes_c)
+		return;
+
+	mtr_add(&shard->routes[route].iterations, iterations);
+	mtr_add(&shard->routes[route].evaluations, evaluations);
+}
+
+void
+mtr_bytes(struct mtr *m, size_t in, size_t out)
+{
+	struct mtr_shard *shard = mtr_shard(m);
+	if (!shard)
+		return;
+
+	if (in)
+		mtr_add(&shard->bytes_in, in);
+	if (out)
+		mtr_add(&shard->bytes_out, out);
+}
+
+void
+mtr_conns(struct mtr *m, int delta)
+{
+	struct mtr_shard *shard = mtr_shard(m);
+	if (shard)
+		mtr_add(&shard->conns, (uint64_t)(int64_t)delta);
+}
+
+static void
+mtr_printf(struct mg_iobuf *io, const char *fmt, ...)
+{
+	char    mem[256], *buf = mem;
+	va_list ap;
+	va_start(ap, fmt);
+	size_t len = mg_vasprintf(&buf, sizeof(mem), fmt, ap);
+	va_end(ap);
+
+	mg_iobuf_add(io, io->len, buf, len, MG_IO_SIZE);
+	if (buf != mem)
+		free(buf);
+}
+
+static void
+mtr_sum(struct mtr *m, struct mtr_shard *sum)
+{
+	/* Sums each counter across the shards into `sum`. */
+	memset(sum, 0, sizeof(*sum));
+
+	struct mtr_shard *shard = __atomic_load_n(&m->shards, __ATOMIC_ACQUIRE);
+	for (; shard; shard = shard->next) {
+		/* The route counts are all uint64_t, summed as one array. */
+		const uint64_t *from = (const uint64_t *)shard->routes;
+		uint64_t       *to   = (uint64_t *)sum->routes;
+		size_t          n    = MTR_ROUTES_MAX * sizeof(struct mtr_counts) /
+		                 sizeof(uint64_t);
+		for (size_t i = 0; i < n; i++)
+			to[i] += mtr_get(&from[i]);
+		sum->bytes_in += mtr_get(&shard->bytes_in);
+		sum->bytes_out += mtr_get(&shard->bytes_out);
+		sum->conns += mtr_get(&shard->conns);
+	}
+}
+
+void
+mtr_print(struct mtr *m, struct mg_iobuf *io)
+{
+	static const char *classes[MTR_STATUS_C] = { "unknown", "1xx", "2xx",
+		                                     "3xx",     "4xx", "5xx" };
+
+	struct mtr_shard *sum = malloc(sizeof(struct mtr_shard));
+	if (!sum)
+		return;
+	mtr_sum(m, sum);
+
+	/* = Requests = */
+	mtr_printf(io, "# HELP " MTR_PREFIX "requests_total Requests handled, "
+	               "by route and status class.\n"
+	               "# TYPE " MTR_PREFIX "requests_total counter\n");
+	for (int r = 0; r < m->routes_c; r++)
+		for (int i = 0; i < MTR_STATUS_C; i++)
+			if (sum->routes[r].requests[i])
+				mtr_printf(io,
+				           MTR_PREFIX "requests_total"
+				           "{route=\"%s\",code=\"%s\"} %llu\n",
+				           m->routes[r], classes[i],
+				           (unsigned long long)sum->routes[r]
+				                   .requests[i]);
+
+	mtr_printf(io, "# HELP " MTR_PREFIX "request_duration_seconds Time "
+	               "taken to handle the requests, by route.\n"
+	               "# TYPE " MTR_PREFIX "request_duration_seconds "
+	               "histogram\n");
+	for (int r = 0; r < m->routes_c; r++) {
+		const struct mtr_counts *counts = &sum->routes[r];
+		uint64_t                 count  = 0;
+		for (int i = 0; i < MTR_STATUS_C; i++)
+			count += counts->requests[i];
+		if (!count)
+			continue;
+
+		count = 0;
+		for (int i = 0; i < MTR_BUCKETS; i++) {
+			/* The bound in seconds, exactly. */
+			uint64_t le = 1ULL << (MTR_BUCKET_MIN + i);
+			count += counts->buckets[i];
+			mtr_printf(io,
+			           MTR_PREFIX "request_duration_seconds_bucket"
+			           "{route=\"%s\",le=\"%llu.%09llu\"} %llu\n",
+			           m->routes[r], (unsigned long long)(le / 1000000000),
+			           (unsigned long long)(le % 1000000000),
+			           (unsigned long long)count);
+		}
+		count += counts->buckets[MTR_BUCKETS];
+		mtr_printf(io,
+		           MTR_PREFIX "request_duration_seconds_bucket"
+		           "{route=\"%s\",le=\"+Inf\"} %llu\n" MTR_PREFIX
+		           "request_duration_seconds_sum{route=\"%s\"} "
+		           "%llu.%09llu\n"
+		           MTR_PREFIX "request_duration_seconds_count"
+		           "{route=\"%s\"} %llu\n",
+		           m->routes[r], (unsigned long long)count, m->routes[r],
+		           (unsigned long long)(counts->duration_ns / 1000000000),
+		           (unsigned long long)(counts->duration_ns % 1000000000),
+		           m->routes[r],
+		           (unsigned long long)count);
+	}
+
+	mtr_printf(io, "# HELP " MTR_PREFIX "phase_seconds_total Time spent in "
+	               "each phase of the requests, by route.\n"
+	               "# TYPE " MTR_PREFIX "phase_seconds_total counter\n");
+	for (int r = 0; r < m->routes_c; r++)
+		for (int i = 0; i < m->phases_c; i++) {
+			uint64_t ns = sum->routes[r].phases_ns[i];
+			if (ns)
+				mtr_printf(io,
+				           MTR_PREFIX "phase_seconds_total"
+				           "{route=\"%s\",phase=\"%s\"} "
+				           "%llu.%09llu\n",
+				           m->routes[r], m->phases[i],
+				           (unsigned long long)(ns / 1000000000),
+				           (unsigned long long)(ns % 1000000000));
+		}
+
+	/* = Solvers = */
+	mtr_printf(io, "# HELP " MTR_PREFIX "solver_iterations_total "
+	               "Iterations done by the solvers, by route.\n"
+	               "# TYPE " MTR_PREFIX "solver_iterations_total counter\n");
+	for (int r = 0; r < m->routes_c; r++)
+		if (sum->routes[r].iterations)
+			mtr_printf(io,
+			           MTR_PREFIX "solver_iterations_total"
+			           "{route=\"%s\"} %llu\n",
+			           m->routes[r],
+			           (unsigned long long)sum->routes[r].iterations);
+	mtr_printf(io, "# HELP " MTR_PREFIX "solver_evaluations_total "
+	               "Function evaluations done by the solvers, by route.\n"
+	               "# TYPE " MTR_PREFIX "solver_evaluations_total "
+	               "counter\n");
+	for (int r = 0; r < m->routes_c; r++)
+		if (sum->routes[r].evaluations)
+			mtr_printf(io,
+			           MTR_PREFIX "solver_evaluations_total"
+			           "{route=\"%s\"} %llu\n",
+			           m->routes[r],
+			           (unsigned long long)sum->routes[r].evaluations);
+
+	/* = Connections = */
+	mtr_printf(io,
+	           "# HELP " MTR_PREFIX "received_bytes_total Bytes received.\n"
+	           "# TYPE " MTR_PREFIX "received_bytes_total counter\n"
+	           MTR_PREFIX "received_bytes_total %llu\n"
+	           "# HELP " MTR_PREFIX "sent_bytes_total Bytes sent.\n"
+	           "# TYPE " MTR_PREFIX "sent_bytes_total counter\n"
+	           MTR_PREFIX "sent_bytes_total %llu\n"
+	           "# HELP " MTR_PREFIX "open_connections Connections open.\n"
+	           "# TYPE " MTR_PREFIX "open_connections gauge\n"
+	           MTR_PREFIX "open_connections %lld\n",
+	           (unsigned long long)sum->bytes_in,
+	           (unsigned long long)sum->bytes_out, (long long)sum->conns);
+
+	free(sum);
+}
+
+void
+mtr_free(struct mtr *m)
+{
+	struct mtr_shard *shard = m->shards, *next;
+	for (; shard; shard = next) {
+		next = shard->next;
+		free(shard);
+	}
+	memset(m, 0, sizeof(*m));
+}
+
+#endif /* MRSPS_METRICS_IMPLEMENTATION */
@@ -0,0 +1,239 @@
+/*
+ ===============================================================================
+ |                                Dependencies                                 |
+ ===============================================================================
+ *
+ * -> mongoose
+ */
+
+/*
+ ===============================================================================
+ |                                    Usage                                    |
+ ===============================================================================
+ *
+ * Do this:
+ *
+ *         #define MRSPS_ROUTER_IMPLEMENTATION
+ *
+ * before you include this file in *one* C or C++ file to create the
+ * implementation.
+ *
+ * A registry of (method, path) routes matched on the exact path through an
+ * open addressed hash table, so a lookup costs the same however many routes
+ * there are. Each route carries caller defined data, usually its handler.
+ *
+ * Routes are added once at startup. Lookups don't modify the router and can
+ * be done from any number of threads after that.
+ */
+
+/*
+ ===============================================================================
+ |                              HEADER-FILE MODE                               |
+ ===============================================================================
+ */
+
+#ifndef MRSPS_ROUTER_H
+#define MRSPS_ROUTER_H
+
+#include "../dep/mongoose.h"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* = Options = */
+#define RTR_ALLOW_MAX 64 /* Size of the 'Allow' header value buffer. */
+
+struct rtr_method {
+	const char        *method;
+	const void        *data;
+	struct rtr_method *next;
+};
+
+struct rtr_path {
+	const char        *path; /* NULL if the slot is free. */
+	size_t             path_len;
+	uint64_t           hash;
+	struct rtr_method *methods;
+};
+
+struct rtr_router {
+	struct rtr_path *slots;
+	size_t           slots_c; /* Power of two, at least twice the paths. */
+	size_t           paths_c;
+};
+
+enum rtr_result_t {
+	RTR_FOUND = 0,
+	RTR_NO_PATH,   /* No route has the path. */
+	RTR_NO_METHOD, /* The path exists but not for the method. */
+};
+
+/*
+ ===============================================================================
+ |                            Function Declarations                            |
+ ===============================================================================
+ */
+void
+rtr_init(struct rtr_router *router);
+
+int
+rtr_add(struct rtr_router *router, const char *method, const char *path,
+        const void *data);
+/*
+ * Register `data` for the method and path. The strings aren't copied and
+ * should outlive the router.
+ *
+ * Returns 0 if the route already exists.
+ */
+
+enum rtr_result_t
+rtr_find(const struct rtr_router *router, struct mg_str method,
+         struct mg_str path, const void **data, char *allow);
+/*
+ * Look up the route for the request, setting `data` if found.
+ *
+ * On RTR_NO_METHOD, `allow` (of RTR_ALLOW_MAX bytes, may be NULL) is set to
+ * the comma separated methods the path supports.
+ */
+
+void
+rtr_free(struct rtr_router *router);
+
+#endif /* MRSPS_ROUTER_H */
+
+/*
+ ===============================================================================
+ |                             IMPLEMENTATION MODE                             |
+ ===============================================================================
+ */
+
+#ifdef MRSPS_ROUTER_IMPLEMENTATION
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+static uint64_t
+rtr_hash(const char *s, size_t len)
+{
+	/* FNV-1a */
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (unsigned char)s[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+static struct rtr_path *
+rtr_slot(const struct rtr_router *router, const char *path, size_t path_len,
+         uint64_t hash)
+{
+	/* Linear probing, the table is never more than half full. */
+	size_t mask = router->slots_c - 1;
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		struct rtr_path *slot = &router->slots[i];
+		if (!slot->path || (slot->hash == hash &&
+		                    slot->path_len == path_len &&
+		                    memcmp(slot->path, path, path_len) == 0))
+			return slot;
+	}
+}
+
+static void
+rtr_grow(struct rtr_router *router)
+{
+	struct rtr_path *old   = router->slots;
+	size_t           old_c = router->slots_c;
+
+	router->slots_c = old_c ? old_c * 2 : 16;
+	router->slots   = calloc(router->slots_c, sizeof(struct rtr_path));
+	for (size_t i = 0; i < old_c; i++)
+		if (old[i].path)
+			*rtr_slot(router, old[i].path, old[i].path_len,
+			          old[i].hash) = old[i];
+	free(old);
+}
+
+void
+rtr_init(struct rtr_router *router)
+{
+	memset(router, 0, sizeof(*router));
+	rtr_grow(router);
+}
+
+int
+rtr_add(struct rtr_router *router, const char *method, const char *path,
+        const void *data)
+{
+	if ((router->paths_c + 1) * 2 > router->slots_c)
+		rtr_grow(router);
+
+	size_t           path_len = strlen(path);
+	uint64_t         hash     = rtr_hash(path, path_len);
+	struct rtr_path *slot     = rtr_slot(router, path, path_len, hash);
+	if (!slot->path) {
+		slot->path     = path;
+		slot->path_len = path_len;
+		slot->hash     = hash;
+		router->paths_c++;
+	}
+
+	for (struct rtr_method *m = slot->methods; m; m = m->next)
+		if (strcmp(m->method, method) == 0)
+			return 0;
+
+	struct rtr_method *m = calloc(1, sizeof(struct rtr_method));
+	m->method            = method;
+	m->data              = data;
+	LIST_ADD_HEAD(struct rtr_method, &slot->methods, m);
+
+	return 1;
+}
+
+enum rtr_result_t
+rtr_find(const struct rtr_router *router, struct mg_str method,
+         struct mg_str path, const void **data, char *allow)
+{
+	struct rtr_path *slot = rtr_slot(router, path.ptr, path.len,
+	                                 rtr_hash(path.ptr, path.len));
+	if (!slot->path)
+		return RTR_NO_PATH;
+
+	for (struct rtr_method *m = slot->methods; m; m = m->next) {
+		if (mg_vcmp(&method, m->method) == 0) {
+			*data = m->data;
+			return RTR_FOUND;
+		}
+	}
+
+	if (allow) {
+		size_t len = 0;
+		allow[0]   = '\0';
+		for (struct rtr_method *m = slot->methods;
+		     m && len < RTR_ALLOW_MAX; m = m->next)
+			len += mg_snprintf(allow + len, RTR_ALLOW_MAX - len,
+			                   "%s%s", len ? ", " : "", m->method);
+	}
+	return RTR_NO_METHOD;
+}
+
+void
+rtr_free(struct rtr_router *router)
+{
+	for (size_t i = 0; i < router->slots_c; i++) {
+		struct rtr_method *m = router->slots[i].methods, *next;
+		for (; m; m = next) {
+			next = m->next;
+			free(m);
+		}
+	}
+	free(router->slots);
+	memset(router, 0, sizeof(*router));
+}
+
+#endif /* MRSPS_ROUTER_IMPLEMENTATION */
@@ -0,0 +1,261 @@
+/*
+ ===============================================================================
+ |                                Dependencies                                 |
+ ===============================================================================
+ *
+ * -> mongoose
+ */
+
+/*
+ ===============================================================================
+ |                                    Usage                                    |
+ ===============================================================================
+ *
+ * Do this:
+ *
+ *         #define MRSPS_SESSIONS_IMPLEMENTATION
+ *
+ * before you include this file in *one* C or C++ file to create the
+ * implementation.
+ *
+ * A session store keeps arbitrary caller data under a random id for a limited
+ * time. Entries not used within the TTL are free'ed by 'sess_expire' and the
+ * least recently used entries are free'ed once the total size reaches the cap.
+ *
+ * The store does no locking of its own. Entries handed out by 'sess_find' are
+ * referenced till 'sess_release' and are never expired or evicted meanwhile,
+ * so their data can be used without holding the caller's lock.
+ */
+
+/*
+ ===============================================================================
+ |                              HEADER-FILE MODE                               |
+ ===============================================================================
+ */
+
+#ifndef MRSPS_SESSIONS_H
+#define MRSPS_SESSIONS_H
+
+#include "../dep/mongoose.h"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* = Options = */
+#define SESS_ID_LEN  16 /* Hex characters in a session id. */
+#define SESS_BUCKETS 256
+
+struct sess_entry {
+	char     id[SESS_ID_LEN + 1];
+	int      type; /* Caller defined, to tell apart the kinds of `data`. */
+	void    *data;
+	size_t   size; /* Bytes accounted against the store's cap. */
+	void     (*data_free)(void *data);
+	uint64_t last_used; /* mg_millis() of the last lookup. */
+	unsigned refs;      /* Lookups not yet released. */
+
+	struct sess_entry *next; /* Linkage in the bucket. */
+};
+
+struct sess_store {
+	struct sess_entry *buckets[SESS_BUCKETS];
+	unsigned int       count;
+	size_t             size, size_max;
+	uint64_t           ttl_ms;
+};
+
+/*
+ ===============================================================================
+ |                            Function Declarations                            |
+ ===============================================================================
+ */
+void
+sess_store_init(struct sess_store *store, uint64_t ttl_ms, size_t size_max);
+/* Initialize an empty store with the given TTL and total size cap. */
+
+struct sess_entry *
+sess_create(struct sess_store *store, int type, void *data, size_t size,
+            void (*data_free)(void *data));
+/*
+ * Store `data` under a new random id and return the entry.
+ *
+ * Least recently used entries are evicted till `size` fits in the cap.
+ *
+ * The entry is referenced, like with 'sess_find', so that it can be filled in
+ * before anyone else continues it.
+ *
+ * Returns NULL if `size` can't be made to fit in the cap; `data` is left to
+ * the caller in that case.
+ */
+
+struct sess_entry *
+sess_find(struct sess_store *store, struct mg_str id);
+/*
+ * Return the entry with the given id and mark it as used, or NULL if there is
+ * no such entry or it has expired.
+ *
+ * The entry is referenced and should be given back with 'sess_release'.
+ */
+
+void
+sess_release(struct sess_store *store, struct sess_entry *entry);
+/* Drop the reference taken by 'sess_find' or 'sess_create'. */
+
+void
+sess_delete(struct sess_store *store, struct sess_entry *entry);
+/* Remove the entry from the store and free its data. */
+
+void
+sess_expire(struct sess_store *store);
+/* Delete every unreferenced entry that wasn't used within the TTL. */
+
+void
+sess_store_free(struct sess_store *store);
+/* Delete every entry in the store. */
+
+#endif /* MRSPS_SESSIONS_H */
+
+/*
+ ===============================================================================
+ |                             IMPLEMENTATION MODE                             |
+ ===============================================================================
+ */
+
+#ifdef MRSPS_SESSIONS_IMPLEMENTATION
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+static unsigned int
+sess_bucket(struct mg_str id)
+{
+	return mg_crc32(0, id.ptr, id.len) % SESS_BUCKETS;
+}
+
+void
+sess_store_init(struct sess_store *store, uint64_t ttl_ms, size_t size_max)
+{
+	memset(store, 0, sizeof(*store));
+	store->ttl_ms   = ttl_ms;
+	store->size_max = size_max;
+}
+
+static struct sess_entry *
+sess_lru(struct sess_store *store)
+{
+	struct sess_entry *lru = NULL;
+	for (unsigned int i = 0; i < SESS_BUCKETS; i++)
+		for (struct sess_entry *e = store->buckets[i]; e; e = e->next)
+			if (!e->refs && (!lru || e->last_used < lru->last_used))
+				lru = e;
+
+	return lru;
+}
+
+struct sess_entry *
+sess_create(struct sess_store *store, int type, void *data, size_t size,
+            void (*data_free)(void *data))
+{
+	size += sizeof(struct sess_entry);
+	if (size > store->size_max)
+		return NULL;
+
+	while (store->size + size > store->size_max) {
+		struct sess_entry *lru = sess_lru(store);
+		if (!lru)
+			return NULL;
+		sess_delete(store, lru);
+	}
+
+	struct sess_entry *entry = calloc(1, sizeof(struct sess_entry));
+	unsigned char      rnd[SESS_ID_LEN / 2];
+	mg_random(rnd, sizeof(rnd));
+	mg_hex(rnd, sizeof(rnd), entry->id);
+	entry->type      = type;
+	entry->data      = data;
+	entry->size      = size;
+	entry->data_free = data_free;
+	entry->last_used = mg_millis();
+	entry->refs      = 1;
+
+	unsigned int b = sess_bucket(mg_str_n(entry->id, SESS_ID_LEN));
+	LIST_ADD_HEAD(struct sess_entry, &store->buckets[b], entry);
+	store->count++;
+	store->size += size;
+
+	return entry;
+}
+
+struct sess_entry *
+sess_find(struct sess_store *store, struct mg_str id)
+{
+	if (id.len != SESS_ID_LEN)
+		return NULL;
+
+	uint64_t now = mg_millis();
+	for (struct sess_entry *e = store->buckets[sess_bucket(id)]; e;
+	     e = e->next) {
+		if (memcmp(e->id, id.ptr, SESS_ID_LEN) != 0)
+			continue;
+
+		if (!e->refs && now - e->last_used > store->ttl_ms) {
+			sess_delete(store, e);
+			return NULL;
+		}
+		e->last_used = now;
+		e->refs++;
+		return e;
+	}
+
+	return NULL;
+}
+
+void
+sess_release(struct sess_store *store, struct sess_entry *entry)
+{
+	(void)store;
+
+	entry->refs--;
+	entry->last_used = mg_millis();
+}
+
+void
+sess_delete(struct sess_store *store, struct sess_entry *entry)
+{
+	unsigned int b = sess_bucket(mg_str_n(entry->id, SESS_ID_LEN));
+	LIST_DELETE(struct sess_entry, &store->buckets[b], entry);
+	store->count--;
+	store->size -= entry->size;
+
+	if (entry->data_free)
+		entry->data_free(entry->data);
+	free(entry);
+}
+
+void
+sess_expire(struct sess_store *store)
+{
+	uint64_t now = mg_millis();
+	for (unsigned int i = 0; i < SESS_BUCKETS; i++) {
+		struct sess_entry *e = store->buckets[i], *next;
+		for (; e; e = next) {
+			next = e->next;
+			if (!e->refs && now - e->last_used > store->ttl_ms)
+				sess_delete(store, e);
+		}
+	}
+}
+
+void
+sess_store_free(struct sess_store *store)
+{
+	for (unsigned int i = 0; i < SESS_BUCKETS; i++)
+		while (store->buckets[i])
+			sess_delete(store, store->buckets[i]);
+}
+
+#endif /* MRSPS_SESSIONS_IMPLEMENTATION */
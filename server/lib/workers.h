@@ -0,0 +1,533 @@
+/*
+ ===============================================================================
+ |                                Dependencies                                 |
+ ===============================================================================
+ *
+ * -> mongoose
+ * -> pthreads
+ * -> GCC/Clang builtins ('__atomic_*')
+ */
+
+/*
+ ===============================================================================
+ |                                    Usage                                    |
+ ===============================================================================
+ *
+ * Do this:
+ *
+ *         #define MRSPS_WORKERS_IMPLEMENTATION
+ *
+ * before you include this file in *one* C or C++ file to create the
+ * implementation.
+ *
+ * A fixed pool of threads running jobs off the mongoose event loops. A job's
+ * `run` is called on a worker thread, then its `done` is called back on the
+ * thread of the event loop it was submitted from, woken up through a pipe made
+ * with 'mg_mkpipe'. Only `done` should touch the mongoose connections.
+ *
+ * A job can also hand over partial results while it runs: 'wrk_progress' from
+ * `run` gets its `progress` called on the event loop thread soon after.
+ *
+ * A job can be handed to another event loop with 'wrk_post', which has its
+ * `done` called there without running it.
+ *
+ * The jobs wait in lanes, lane 0 unless set in their `lane`. When several
+ * lanes have jobs waiting, the free workers take them in proportion to the
+ * weights of the lanes, given with 'wrk_lane_set', which can also keep a lane
+ * from taking every worker. An event loop calls back at most `done_max` jobs
+ * per wakeup, taken from the lanes in the same proportion, so that its other
+ * connections get their turn in between.
+ *
+ * Every event loop submitting jobs registers itself with 'wrk_loop_init'.
+ */
+
+/*
+ ===============================================================================
+ |                              HEADER-FILE MODE                               |
+ ===============================================================================
+ */
+
+#ifndef MRSPS_WORKERS_H
+#define MRSPS_WORKERS_H
+
+#include <pthread.h>
+
+#include "../dep/mongoose.h"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* = Options = */
+#define WRK_LANES_MAX 4
+
+struct wrk_job {
+	void (*run)(void *arg);  /* Called on a worker thread. */
+	void (*done)(void *arg); /* Called on the event loop thread. */
+	void (*progress)(void *arg); /* Same, after 'wrk_progress'. May be NULL. */
+	void *arg;
+	int   is_cancelled; /* Set if `run` wasn't called due to shutdown. */
+
+	unsigned int     lane; /* Waited in, below WRK_LANES_MAX. */
+	struct wrk_loop *loop; /* Where `done` is called, set on submit. */
+	struct wrk_job  *next; /* Linkage in the queues. */
+	struct wrk_job  *progress_next; /* Linkage in the loop's progress queue. */
+	struct wrk_job  *taken_next; /* Linkage once popped from the queue. */
+	int              is_progress_queued;
+};
+
+/* The jobs of a lane, in the order they came. */
+struct wrk_queue {
+	struct wrk_job *head, *tail;
+	unsigned int    count;
+	long            credit; /* Of the weighted round robin. */
+};
+
+struct wrk_loop {
+	struct wrk_pool *pool;
+	struct wrk_queue done[WRK_LANES_MAX]; /* Waiting for this loop. */
+	struct wrk_job  *progress_head, *progress_tail;
+	unsigned int     pending; /* Jobs submitted or posted, `done` not called. */
+	unsigned int     done_max; /* Called back per wakeup, 0 for all. */
+	int              wake_fd;  /* Written to by the workers. */
+
+	struct wrk_loop *next; /* Linkage in the pool. */
+};
+
+struct wrk_lane {
+	unsigned int weight;
+	unsigned int running_max; /* Workers it can take, 0 for all. */
+	unsigned int running;
+	uint64_t     started;
+};
+
+struct wrk_stats {
+	unsigned int queued;      /* Waiting for a worker. */
+	unsigned int running;
+	unsigned int done_queued; /* Run, waiting for their event loop. */
+	uint64_t     started;     /* So far. */
+};
+
+struct wrk_pool {
+	pthread_t       *threads;
+	unsigned int     threads_c;
+	pthread_mutex_t  lock;
+	pthread_cond_t   cond;
+	struct wrk_queue todo[WRK_LANES_MAX]; /* Waiting for a worker. */
+	struct wrk_lane  lanes[WRK_LANES_MAX];
+	struct wrk_loop *loops;
+	int              is_stopping;
+};
+
+/*
+ ===============================================================================
+ |                            Function Declarations                            |
+ ===============================================================================
+ */
+int
+wrk_pool_init(struct wrk_pool *pool, unsigned int threads_c);
+/*
+ * Start `threads_c` workers. The lanes all have a weight of 1 and no limit.
+ *
+ * Returns 0 on failure.
+ */
+
+void
+wrk_lane_set(struct wrk_pool *pool, unsigned int lane, unsigned int weight,
+             unsigned int running_max);
+/*
+ * Have the free workers take the jobs of the lane `weight` times as often as
+ * those of a lane of weight 1, while both have some waiting, and at most
+ * `running_max` of them at once unless 0. The event loops call them back in
+ * the same proportion. The weight should be at least 1.
+ */
+
+void
+wrk_lane_stats(struct wrk_pool *pool, unsigned int lane,
+               struct wrk_stats *stats);
+/* Count the jobs of the lane, across the event loops. */
+
+int
+wrk_loop_init(struct wrk_loop *loop, struct wrk_pool *pool,
+              struct mg_mgr *mgr);
+/*
+ * Let the event loop of `mgr` submit jobs to the pool. Should be called before
+ * the loop is shared with other threads, its `done_max` can be set after.
+ *
+ * Returns 0 on failure.
+ */
+
+void
+wrk_submit(struct wrk_loop *loop, struct wrk_job *job);
+/*
+ * Queue the job in its lane for a free worker. Must be called from the thread
+ * of the event loop. The job is owned by the caller and must stay valid till
+ * its `done` is called.
+ */
+
+void
+wrk_progress(struct wrk_job *job);
+/*
+ * Have the job's `progress` called on the thread of its event loop. Must be
+ * called from `run`.
+ *
+ * Calls made before the loop got to it are merged into one, and the last one
+ * is always followed by a call to `progress` before `done`.
+ */
+
+void
+wrk_post(struct wrk_loop *loop, struct wrk_job *job);
+/*
+ * Have the job's `done` called on the thread of the event loop, without
+ * running it. Can be called from any thread, `is_cancelled` is left as it is.
+ */
+
+void
+wrk_pool_free(struct wrk_pool *pool);
+/*
+ * Stop the workers after their current job and wait for them. The event
+ * loops should be stopped already but not yet free'ed.
+ *
+ * `done` is still called for every pending job, with `is_cancelled` set for the
+ * ones that never ran.
+ */
+
+#endif /* MRSPS_WORKERS_H */
+
+/*
+ ===============================================================================
+ |                             IMPLEMENTATION MODE                             |
+ ===============================================================================
+ */
+
+#ifdef MRSPS_WORKERS_IMPLEMENTATION
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+static void
+wrk_queue_push(struct wrk_queue *queue, struct wrk_job *job)
+{
+	job->next = NULL;
+	if (queue->tail)
+		queue->tail->next = job;
+	else
+		queue->head = job;
+	queue->tail = job;
+	queue->count++;
+}
+
+static struct wrk_job *
+wrk_queue_pop(struct wrk_queue *queue)
+{
+	struct wrk_job *job = queue->head;
+	queue->head         = job->next;
+	if (!queue->head)
+		queue->tail = NULL;
+	queue->count--;
+
+	return job;
+}
+
+static struct wrk_job *
+wrk_queue_pop_all(struct wrk_queue *queue)
+{
+	struct wrk_job *jobs = queue->head;
+	queue->head  = NULL;
+	queue->tail  = NULL;
+	queue->count = 0;
+
+	return jobs;
+}
+
+static struct wrk_queue *
+wrk_queue_next(struct wrk_pool *pool, struct wrk_queue *queues, int is_todo)
+{
+	/* Smooth weighted round robin: the lanes with a job to give gain their
+	 * weight, the one with the most credit gives it and pays back the
+	 * weights gained. A lane running all it can gives none to the
+	 * workers. */
+	struct wrk_queue *next  = NULL;
+	long              total = 0;
+	for (int i = 0; i < WRK_LANES_MAX; i++) {
+		struct wrk_lane *lane = &pool->lanes[i];
+		if (!queues[i].head ||
+		    (is_todo && lane->running_max &&
+		     lane->running >= lane->running_max))
+			continue;
+		queues[i].credit += lane->weight;
+		total += lane->weight;
+		if (!next || queues[i].credit > next->credit)
+			next = &queues[i];
+	}
+	if (next)
+		next->credit -= total;
+
+	return next;
+}
+
+static struct wrk_job *
+wrk_progress_pop_all(struct wrk_loop *loop)
+{
+	/* Chained again for the caller, as a worker can queue a job anew, and
+	 * so reset its `progress_next`, once the lock is given back. */
+	struct wrk_job *jobs = NULL, **tail = &jobs;
+	for (struct wrk_job *j = loop->progress_head; j; j = j->progress_next) {
+		j->is_progress_queued = 0;
+		*tail                 = j;
+		tail                  = &j->taken_next;
+	}
+	*tail               = NULL;
+	loop->progress_head = loop->progress_tail = NULL;
+
+	return jobs;
+}
+
+static void
+wrk_call_progress(struct wrk_job *jobs)
+{
+	for (struct wrk_job *next; jobs; jobs = next) {
+		next = jobs->taken_next;
+		jobs->progress(jobs->arg);
+	}
+}
+
+static void
+wrk_call_done(struct wrk_job *jobs)
+{
+	for (struct wrk_job *next; jobs; jobs = next) {
+		next = jobs->next;
+		__atomic_fetch_sub(&jobs->loop->pending, 1, __ATOMIC_RELAXED);
+		jobs->done(jobs->arg);
+	}
+}
+
+static void *
+wrk_thread_fn(void *arg)
+{
+	struct wrk_pool *pool = arg;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		struct wrk_queue *todo = NULL;
+		while (!pool->is_stopping &&
+		       !(todo = wrk_queue_next(pool, pool->todo, 1)))
+			pthread_cond_wait(&pool->cond, &pool->lock);
+		if (pool->is_stopping)
+			break;
+
+		struct wrk_job  *job  = wrk_queue_pop(todo);
+		struct wrk_lane *lane = &pool->lanes[job->lane];
+		lane->running++;
+		lane->started++;
+		pthread_mutex_unlock(&pool->lock);
+
+		job->run(job->arg);
+
+		pthread_mutex_lock(&pool->lock);
+		/* The slot freed is taken by this worker on the next round. */
+		lane->running--;
+		struct wrk_loop *loop = job->loop;
+		wrk_queue_push(&loop->done[job->lane], job);
+		/* A lost byte only delays the wakeup, the queues are drained
+		 * whole, a wakeup leaving some sends another. */
+		(void)send(loop->wake_fd, "", 1, MSG_DONTWAIT);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+static void
+wrk_pipe_fn(struct mg_connection *c, int ev, void *ev_data, void *fn_data)
+{
+	struct wrk_loop *loop = fn_data;
+
+	(void)ev_data;
+
+	if (ev != MG_EV_READ)
+		return;
+
+	c->recv.len = 0;
+	pthread_mutex_lock(&loop->pool->lock);
+	struct wrk_job  *progress = wrk_progress_pop_all(loop);
+	struct wrk_queue jobs     = { 0 };
+	for (struct wrk_queue *done;
+	     (!loop->done_max || jobs.count < loop->done_max) &&
+	     (done = wrk_queue_next(loop->pool, loop->done, 0));)
+		wrk_queue_push(&jobs, wrk_queue_pop(done));
+	/* The rest on the next wakeup, after the other connections. */
+	for (int i = 0; i < WRK_LANES_MAX; i++)
+		if (loop->done[i].head) {
+			(void)send(loop->wake_fd, "", 1, MSG_DONTWAIT);
+			break;
+		}
+	pthread_mutex_unlock(&loop->pool->lock);
+
+	/* A job is only done after its last progress, so both are taken at once
+	 * and in this order. */
+	wrk_call_progress(progress);
+	wrk_call_done(jobs.head);
+}
+
+int
+wrk_pool_init(struct wrk_pool *pool, unsigned int threads_c)
+{
+	memset(pool, 0, sizeof(*pool));
+	if (threads_c == 0)
+		return 0;
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+	for (int i = 0; i < WRK_LANES_MAX; i++)
+		pool->lanes[i].weight = 1;
+
+	pool->threads = calloc(threads_c, sizeof(pthread_t));
+	for (; pool->threads_c < threads_c; pool->threads_c++)
+		if (pthread_create(&pool->threads[pool->threads_c], NULL,
+		                   wrk_thread_fn, pool) != 0)
+			break;
+
+	return pool->threads_c > 0;
+}
+
+void
+wrk_lane_set(struct wrk_pool *pool, unsigned int lane, unsigned int weight,
+             unsigned int running_max)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->lanes[lane].weight      = weight;
+	pool->lanes[lane].running_max = running_max;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void
+wrk_lane_stats(struct wrk_pool *pool, unsigned int lane,
+               struct wrk_stats *stats)
+{
+	pthread_mutex_lock(&pool->lock);
+	stats->queued      = pool->todo[lane].count;
+	stats->running     = pool->lanes[lane].running;
+	stats->done_queued = 0;
+	stats->started     = pool->lanes[lane].started;
+	for (struct wrk_loop *loop = pool->loops; loop; loop = loop->next)
+		stats->done_queued += loop->done[lane].count;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+int
+wrk_loop_init(struct wrk_loop *loop, struct wrk_pool *pool,
+              struct mg_mgr *mgr)
+{
+	memset(loop, 0, sizeof(*loop));
+	loop->pool    = pool;
+	loop->wake_fd = mg_mkpipe(mgr, wrk_pipe_fn, loop, false);
+	if (loop->wake_fd < 0)
+		return 0;
+
+	pthread_mutex_lock(&pool->lock);
+	LIST_ADD_HEAD(struct wrk_loop, &pool->loops, loop);
+	pthread_mutex_unlock(&pool->lock);
+
+	return 1;
+}
+
+void
+wrk_submit(struct wrk_loop *loop, struct wrk_job *job)
+{
+	struct wrk_pool *pool = loop->pool;
+
+	job->is_cancelled       = 0;
+	job->is_progress_queued = 0;
+	job->loop               = loop;
+	__atomic_fetch_add(&loop->pending, 1, __ATOMIC_RELAXED);
+
+	pthread_mutex_lock(&pool->lock);
+	wrk_queue_push(&pool->todo[job->lane], job);
+	pthread_cond_signal(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void
+wrk_progress(struct wrk_job *job)
+{
+	struct wrk_loop *loop = job->loop;
+
+	pthread_mutex_lock(&loop->pool->lock);
+	if (!job->is_progress_queued) {
+		job->is_progress_queued = 1;
+		job->progress_next      = NULL;
+		if (loop->progress_tail)
+			loop->progress_tail->progress_next = job;
+		else
+			loop->progress_head = job;
+		loop->progress_tail = job;
+		(void)send(loop->wake_fd, "", 1, MSG_DONTWAIT);
+	}
+	pthread_mutex_unlock(&loop->pool->lock);
+}
+
+void
+wrk_post(struct wrk_loop *loop, struct wrk_job *job)
+{
+	job->loop = loop;
+	__atomic_fetch_add(&loop->pending, 1, __ATOMIC_RELAXED);
+
+	pthread_mutex_lock(&loop->pool->lock);
+	wrk_queue_push(&loop->done[job->lane], job);
+	(void)send(loop->wake_fd, "", 1, MSG_DONTWAIT);
+	pthread_mutex_unlock(&loop->pool->lock);
+}
+
+void
+wrk_pool_free(struct wrk_pool *pool)
+{
+	if (!pool->threads)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->is_stopping = 1;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+	for (unsigned int i = 0; i < pool->threads_c; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	/* Till nothing's left, as a `done` can submit or post more jobs. */
+	for (int is_idle = 0; !is_idle;) {
+		is_idle = 1;
+		for (int i = 0; i < WRK_LANES_MAX; i++) {
+			struct wrk_job *jobs =
+				wrk_queue_pop_all(&pool->todo[i]);
+			is_idle = is_idle && !jobs;
+			for (struct wrk_job *j = jobs; j; j = j->next)
+				j->is_cancelled = 1;
+			wrk_call_done(jobs);
+		}
+
+		struct wrk_loop *loop = pool->loops;
+		for (; loop; loop = loop->next) {
+			struct wrk_job *progress = wrk_progress_pop_all(loop);
+			is_idle                  = is_idle && !progress;
+			wrk_call_progress(progress);
+			for (int i = 0; i < WRK_LANES_MAX; i++) {
+				struct wrk_job *jobs =
+					wrk_queue_pop_all(&loop->done[i]);
+				is_idle = is_idle && !jobs;
+				wrk_call_done(jobs);
+			}
+		}
+	}
+	for (struct wrk_loop *loop = pool->loops; loop; loop = loop->next)
+		close(loop->wake_fd);
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->cond);
+	free(pool->threads);
+	pool->threads = NULL;
+}
+
+#endif /* MRSPS_WORKERS_IMPLEMENTATION */
@@ -1,12 +1,11 @@
+#include <float.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
 /* mongoose - https://github.com/cesanta/mongoose */
 #include "dep/mongoose.h"
 
-/* json - http://ccodearchive.net/info/json.html */
-#include "dep/json.h"
-
 /* spl - https://github.com/mrsafalpiya/spl */
 #define SPLU_IMPLEMENTATION
 #include "dep/spl_utils.h"
@@ -18,6 +17,32 @@
 #include "../components/study-tools/nm/1-non-linear-eqn/1-bisection.h"
 #define MRSPC_SECANT_IMPLEMENTATION
 #include "../components/study-tools/nm/1-non-linear-eqn/2-secant.h"
+#define MRSPC_HORNER_IMPLEMENTATION
+#include "../components/study-tools/nm/1-non-linear-eqn/4-horner.h"
+#define MRSPC_CONTINUATION_IMPLEMENTATION
+#include "../components/study-tools/nm/1-non-linear-eqn/6-continuation.h"
+
+/* server libs */
+#define MRSPS_SESSIONS_IMPLEMENTATION
+#include "lib/sessions.h"
+#define MRSPS_CACHE_IMPLEMENTATION
+#include "lib/cache.h"
+#define MRSPS_WORKERS_IMPLEMENTATION
+#include "lib/workers.h"
+#define MRSPS_ROUTER_IMPLEMENTATION
+#include "lib/router.h"
+#define MRSPS_JSONW_IMPLEMENTATION
+#include "lib/jsonw.h"
+#define MRSPS_CBORW_IMPLEMENTATION
+#include "lib/cborw.h"
+#define MRSPS_DEFLATE_IMPLEMENTATION
+#include "lib/deflate.h"
+#define MRSPS_ASSETS_IMPLEMENTATION
+#include "lib/assets.h"
+#define MRSPS_METRICS_IMPLEMENTATION
+#include "lib/metrics.h"
+#define MRSPS_LOGGER_IMPLEMENTATION
+#include "lib/logger.h"
 
 /* config file */
 #include "config.h"
@@ -29,43 +54,2249 @@
  */
 /* = Server = */
 char *executable_path;
-#define JSON_STR_MAX 8192
 
-/* = Interrupts = */
-static int s_signo;
+/* = Request parsing = */
+#define S_EXPR_MAX 512 /* Longest input expression, with the NUL */
+
+struct s_field {
+	const char *path; /* JSON path of the field in the request body */
+	const char *info; /* Asked for in the 400 reply if missing */
+	char        type; /* 's' for string, 'f' for float, 'i' for int and 'b'
+	                     for bool */
+	int         is_required;
+	void       *data; /* A 'struct mg_str' for strings */
+};
+
+/* = Sessions = */
+static struct sess_store s_sessions;
+static pthread_mutex_t   s_sessions_lock = PTHREAD_MUTEX_INITIALIZER;
+
+enum {
+	S_SESS_BISECTION = 1,
+	S_SESS_SECANT,
+};
+
+struct s_bs_session {
+	struct bs_t       bs_instance;
+	struct bs_state   bs_state;
+	enum bs_process_t bs_p;
+	int               precision;
+	int               iterations_done;
+};
+
+struct s_sct_session {
+	struct sct_t       sct_instance;
+	struct sct_state   sct_state;
+	enum sct_process_t sct_p;
+	int                precision;
+	int                iterations_done;
+};
+
+/* = Result cache = */
+static struct cache    s_cache;
+static pthread_mutex_t s_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#define S_CACHE_KEY_MAX 1024
+
+struct s_cache_field {
+	const char *path; /* JSON path of the field in the request body */
+	char        type; /* 's' for string, 'f' for float and 'i' for int */
+};
+
+static const struct s_cache_field s_bs_cache_fields[] = {
+	{ "$.input_expr", 's' }, { "$.interval_lower", 'f' },
+	{ "$.interval_upper", 'f' }, { "$.bs_p", 'i' },
+	{ "$.precision", 'i' }, { "$.iterations", 'i' },
+	{ NULL, 0 },
+};
+
+static const struct s_cache_field s_sct_cache_fields[] = {
+	{ "$.input_expr", 's' }, { "$.interval_lower", 'f' },
+	{ "$.interval_upper", 'f' }, { "$.sct_p", 'i' },
+	{ "$.precision", 'i' }, { "$.iterations", 'i' },
+	{ NULL, 0 },
+};
+
+/* = Single flight = */
+/*
+ * A cacheable request being solved. The same requests coming meanwhile wait
+ * for it instead of being solved again, then get its result from the cache.
+ */
+struct s_flight {
+	char             key[S_CACHE_KEY_MAX]; /* Its cache key. */
+	size_t           key_len;
+	struct s_job    *followers; /* Waiting, linked by their `flight_next`. */
+	struct s_flight *next;
+};
+
+static struct s_flight *s_flights; /* Being solved. */
+static pthread_mutex_t  s_flights_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t         s_flights_shared; /* Requests that waited on one. */
+
+/* = Admission = */
+static uint64_t s_admitted; /* Cost of the jobs admitted and not yet freed. */
+
+/* = Compression = */
+/* Suffixes of the ETags of the bodies per encoding, as for the assets. */
+static const char *s_etag_suffixes[AST_ENC_C] = { "", "-gz", "-df" };
+#define S_ETAG_MAX (CACHE_ETAG_LEN + 4) /* Longest ETag, with the NUL */
+
+/* = Static assets = */
+static struct ast_store s_assets;
+static pthread_rwlock_t s_assets_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/* = Routes = */
+typedef void (*s_handler_t)(struct mg_connection *c, struct mg_http_message *hm);
+
+enum s_run {
+	S_RUN_LOOP,   /* On the event loop */
+	S_RUN_WORKER, /* On a worker thread */
+	S_RUN_BATCH,  /* On a worker thread for each problem in the body */
+};
+
+struct s_route {
+	const char                 *method;
+	const char                 *path;
+	s_handler_t                 handler;
+	enum s_run                  run;
+	const char                 *cache_name; /* Result cache, if not NULL */
+	const struct s_cache_field *cache_fields;
+};
+
+static struct rtr_router s_router;
+
+/* = Metrics = */
+/* The routes of 's_routes' are added first, under their index. */
+static struct mtr s_metrics;
+static int        s_metrics_assets, s_metrics_other;
+static int        s_metrics_ws; /* Problems solved over the WebSockets */
+
+/* = Logging = */
+static struct lgr s_log;
+static int        s_log_is_on, s_log_access; /* Access records, with -a */
+
+/* = Timing = */
+/* Phases of a job, timed in its metrics and in the 'Server-Timing' header. */
+enum s_phase {
+	S_PHASE_QUEUE,   /* Waiting for a worker */
+	S_PHASE_PARSE,   /* Reading the inputs */
+	S_PHASE_COMPILE, /* Compiling the expression and checking the inputs */
+	S_PHASE_SOLVE,   /* Running the solver */
+	S_PHASE_WRITE,   /* Writing the reply */
+	S_PHASE_C,
+};
+
+static const char *s_phase_names[S_PHASE_C] = {
+	"queue", "parse", "compile", "solve", "write",
+};
+
+#define S_TIMING_MAX 256 /* Longest 'Server-Timing' header, all phases in */
+
+/* = Lanes = */
+/* Of the workers, see LANE_COST_INTERACTIVE. */
+enum s_lane {
+	S_LANE_INTERACTIVE,
+	S_LANE_BULK,
+	S_LANE_C,
+};
+
+static const char *s_lane_names[S_LANE_C] = { "interactive", "bulk" };
+
+/* = Event loops = */
+struct s_reactor {
+	struct mg_mgr   mgr; /* `userdata` points back to the reactor */
+	struct wrk_loop workers;
+	pthread_t       thread;
+};
+
+static struct s_reactor *s_reactors;
+
+/* = Workers = */
+static struct wrk_pool s_workers;
+
+struct s_job {
+	struct wrk_job         job;
+	struct mg_mgr         *mgr;
+	unsigned long          conn_id;
+	s_handler_t            handler;
+	struct mg_str          message; /* Copy of the request. */
+	struct mg_http_message hm;      /* Parsed from `message`. */
+	struct mg_connection   out;     /* Detached, collects the reply. */
+
+	/* = Metrics = */
+	int           route; /* Index in the metrics. */
+	uint64_t      start_ns;
+	int           status;                  /* Of the reply, once sent. */
+	size_t        bytes_out;               /* Of the reply, so far. */
+	unsigned long iterations, evaluations; /* Done by the solver. */
+
+	/* = Timing = */
+	uint64_t     mark_ns;              /* End of the last phase timed. */
+	uint64_t     phases_ns[S_PHASE_C]; /* Time spent in each phase. */
+	unsigned int timed, reported;      /* Bits of the phases timed, sent. */
+
+	/* = Problems = */
+	/* Of a batch or sent over a WebSocket, see 's_problem_job'. */
+	const struct s_route *problem_route; /* Solving the problem. */
+	struct s_batch       *batch;         /* NULL if not of a batch. */
+	size_t                batch_i;
+	int                   is_ws; /* Replied to with WebSocket frames. */
+
+	/* = Single flight = */
+	struct s_flight      *flight;       /* Led by the job, NULL if none. */
+	const struct s_route *flight_route; /* Of a follower, cached. */
+	struct s_job         *flight_next;  /* Linkage in the followers. */
+
+	/* = Admission = */
+	uint64_t cost;        /* Admitted, given back once freed. */
+	uint64_t deadline_ns; /* Of the solve, see 's_job_budget'. */
+
+	pthread_mutex_t lock;    /* Guards the fields below. */
+	pthread_cond_t  drained; /* Signalled as the reply gets sent. */
+	struct mg_iobuf stream;  /* Flushed from `out` but not yet sent. */
+	size_t          unsent;  /* In the connection's buffer, as of the last
+	                            write. */
+	int             is_gone; /* Set once the connection is closed or the
+	                            solve cancelled. */
+	int             is_stalled; /* Set once given up on the client. */
+};
+
+/* = Streaming = */
+struct s_stream {
+	struct mg_connection *c;
+	struct jw             w;         /* Writes the array to `chunk`. */
+	struct mg_iobuf       chunk;     /* Written but not yet sent. */
+	struct mg_iobuf       body;      /* Sent so far, for the result cache. */
+	const char           *cache_key; /* NULL if not to be cached. */
+	size_t                cache_key_len;
+	int                   is_gone; /* Set once the client has gone away. */
+	int                   is_cbor; /* Blocks of columns instead of rows. */
+	const char           *session_id; /* NULL if none. */
+	const char           *budget; /* Exceeded, cutting it short, or NULL. */
+
+	/* = Headers = */
+	/* Held back till the first chunk, to know if it's worth compressing. */
+	struct mg_http_message *hm;
+	int                     is_head_sent, is_ending;
+
+	/* = Compression = */
+	enum ast_enc_t  enc;
+	struct dfl     *dfl; /* NULL if sent as it is. */
+	struct mg_iobuf zchunk;
+
+	/* Each row is sent as a WebSocket frame of its own instead. */
+	int is_ws;
+};
+
+/* = Problems = */
+/* Methods of the problems solved on their own, by the route solving them. */
+static const struct s_problem_method {
+	const char *name;
+	const char *path;
+} s_problem_methods[] = {
+	{ "bisection", URI_STUDY_TOOLS "/nm/1-non-linear-eqn/1-bisection" },
+	{ "secant", URI_STUDY_TOOLS "/nm/1-non-linear-eqn/2-secant" },
+	{ "horner-roots", URI_STUDY_TOOLS "/nm/1-non-linear-eqn/4-horner-roots" },
+	{ "continuation", URI_STUDY_TOOLS "/nm/1-non-linear-eqn/6-continuation" },
+};
+
+/* = Batches = */
+struct s_batch {
+	struct mg_mgr   *mgr;
+	unsigned long    conn_id;
+	int              route; /* Index in the metrics. */
+	uint64_t         start_ns;
+	struct mg_str    method, uri; /* Copies, for the access log. */
+	size_t           bytes_in, bytes_out;
+	struct mg_iobuf *results; /* JSON of each problem, empty till solved. */
+	size_t           results_c, sent;
+	struct dfl      *dfl; /* Compressing the reply, NULL if not. */
+	struct mg_iobuf  zchunk;
+	unsigned int     pending; /* Problems still being solved. */
+	int              is_gone; /* Set once the connection is closed. */
+};
+
+/* = Interrupts = */
+static volatile sig_atomic_t s_signo;
+
+/*
+ ===============================================================================
+ |                            Function Declarations                            |
+ ===============================================================================
+ */
+/* = Core = */
+static void
+s_handler_fn(struct mg_connection *c, int ev, void *ev_data, void *fn_data);
+/* Main server handler. */
+
+static void
+s_routes_init(void);
+/* Register the routes of every component into the router. */
+
+static int
+s_hm_get_fields(struct mg_connection *c, struct mg_str body,
+                const struct s_field *fields);
+/*
+ * Read the `fields`, terminated by a NULL path, from the request `body` into
+ * their `data`. Missing optional fields are left as they are.
+ *
+ * Strings are slices of the body, still escaped, see 's_hm_get_expr'.
+ *
+ * If a required field is missing or not of its type, a 400 response will be
+ * given asking to provide the field written as its `info`.
+ */
+
+static int
+s_hm_get_expr(struct mg_connection *c, struct mg_str str, char *expr);
+/*
+ * Unescape the expression read by 's_hm_get_fields' into `expr` of S_EXPR_MAX
+ * bytes, for compiling.
+ *
+ * A 400 response is given if it doesn't fit.
+ */
+
+void
+print_help_exit(FILE *stream, int exit_code);
+/*
+ * Print help to the given `stream` and exit the program with the given
+ * `exit_code`.
+ */
+
+static void
+signal_handler(int signo);
+
+static void *
+s_reactor_run(void *arg);
+/* Poll the reactor's event loop till a signal is caught. */
+
+static void
+s_reply_expr_error(struct mg_connection *c, int expr_err_loc);
+/* Reply with a 400 pointing at the location of error in the expression. */
+
+static void
+s_reply_json(struct mg_connection *c, struct mg_http_message *hm,
+             const char *headers, struct mg_iobuf *io);
+/*
+ * Reply with the JSON written to `io`, which is free'ed, compressed as the
+ * request `hm` prefers. `headers` are added to the ones sent, "" for none.
+ */
+
+static int
+s_reply_status(const struct mg_iobuf *io, size_t ofs);
+/* Status code of the reply starting at `ofs` in `io`, or 0 if there's none. */
+
+/* = Streaming = */
+static void
+s_stream_begin(struct s_stream *st, struct mg_connection *c,
+               struct mg_http_message *hm, const char *session_id,
+               const char *cache_key, size_t cache_key_len);
+/*
+ * Start a chunked reply with a JSON array on `c`, whose elements are written
+ * with `st->w` and sent with 's_stream_flush'. It's compressed as the request
+ * `hm` prefers, see 's_encoding'.
+ *
+ * If the request `hm` prefers CBOR, see 's_wants_cbor', it's a CBOR array of
+ * unknown length instead, whose elements are written to `st->chunk` with a
+ * 'struct cw': a map of columns per block of rows. The stream isn't cached.
+ *
+ * `session_id` is sent as the 'X-Session-Id' header if not NULL.
+ *
+ * If `cache_key` isn't NULL the reply is also stored in the result cache under
+ * it, unless larger than CACHE_ENTRY_MAX or cut short. It's sent without an
+ * ETag, which comes with the replies from the cache: the headers go before
+ * the reply is known to be complete.
+ */
+
+static int
+s_wants_cbor(struct mg_http_message *hm);
+/*
+ * Whether the 'Accept' header of the request rates 'application/cbor' over
+ * 'application/json'.
+ */
+
+static void
+s_stream_head(struct s_stream *st);
+/* Send the headers held back, compressing the rest if worth it. */
+
+static void
+s_stream_row(struct s_stream *st);
+/*
+ * End the element just written. Over a WebSocket it's put in a frame of its own
+ * rather than in the array, see 's_handler_c_st_nm_1_ws'.
+ */
+
+static int
+s_stream_flush(struct s_stream *st);
+/*
+ * Send the elements written so far as a chunk.
+ *
+ * Returns 0 if the client has gone away, so that the rest can be skipped.
+ */
+
+static void
+s_stream_end(struct s_stream *st);
+/* Close the array, end the reply and free the stream. */
+
+/* = Compression = */
+static enum ast_enc_t
+s_encoding(struct mg_http_message *hm, size_t len);
+/*
+ * Encoding the 'Accept-Encoding' header of the request rates the highest for a
+ * reply of `len` bytes, gzip first on ties. AST_IDENTITY if shorter than
+ * COMPRESS_SIZE_MIN.
+ */
+
+static void
+s_etag(const char *etag, enum ast_enc_t enc, char *buf);
+/* Write the `etag` of a body as sent in the `enc` into `buf` of S_ETAG_MAX. */
+
+static void
+s_reply_body(struct mg_connection *c, const char *head, enum ast_enc_t enc,
+             const void *body, size_t len);
+/*
+ * Send the `body` compressed in the `enc` after the `head`, the status line and
+ * headers but for its encoding and length. It's sent as it is if it can't be
+ * compressed.
+ */
+
+/* = Result cache = */
+static size_t
+s_cache_key(struct mg_str body, const char *name,
+            const struct s_cache_field *fields, char *key, size_t key_max);
+/*
+ * Build the canonical cache key for a request into `key` from the `fields` of
+ * the request `body`; `name` tells apart the solvers.
+ *
+ * Returns the length of the key, or 0 if the request can't be served from the
+ * cache (missing fields, numbers out of the range of their type or uses
+ * sessions).
+ */
+
+static void
+s_reply_cached(struct mg_connection *c, struct mg_http_message *hm,
+               const char *etag, const char *body, size_t len);
+/*
+ * Reply with the `body` cached under the `etag`, or 304 if the client already
+ * has it.
+ */
+
+static int
+s_reply_from_cache(struct mg_connection *c, struct mg_http_message *hm,
+                   const char *name, const struct s_cache_field *fields);
+/*
+ * Reply with the cached result of the request if there is one.
+ *
+ * Returns 1 if replied.
+ */
+
+static void
+s_handler_server_cache(struct mg_connection *c, struct mg_http_message *hm);
+/* Reply with the result cache stats. */
+
+static void
+s_handler_metrics(struct mg_connection *c, struct mg_http_message *hm);
+/* Reply with the metrics in the Prometheus text format. */
+
+static void
+s_metrics_lanes(struct mg_iobuf *io);
+/* Append the counts of the solves in each lane to the metrics. */
+
+/* = Static assets = */
+static void
+s_reply_asset(struct mg_connection *c, struct mg_http_message *hm);
+/*
+ * Reply with the asset at the request path in the encoding the client
+ * prefers, or 304 if it already has it. Unknown paths get ASSETS_PAGE_404.
+ * The ones too large to hold are sent from disk, ranges included.
+ */
+
+static void
+s_assets_sync_fn(void *arg);
+/* Timer function to reload the assets changed on disk. */
+
+/* = Workers = */
+static struct s_job *
+s_job_new(struct mg_connection *c, s_handler_t handler, int route,
+          uint64_t start_ns);
+/* Make a job running the handler for a request on `c`, not yet submitted. */
+
+static struct s_job *
+s_job_request(struct mg_connection *c, struct mg_http_message *hm,
+              s_handler_t handler, int route, uint64_t start_ns);
+/*
+ * Make a job running the handler for the request `hm` on `c`, with a copy of
+ * it, not yet submitted. It's counted in the metrics of `route` as taking since
+ * `start_ns`.
+ */
+
+static void
+s_job_submit(struct mg_connection *c, struct s_job *job);
+/*
+ * Run the job on a worker thread and send its reply once done. It waits in the
+ * lane of its cost.
+ *
+ * No more requests are read from the connection meanwhile.
+ */
+
+static enum s_lane
+s_lane(uint64_t cost);
+/* Lane where a solve of `cost` waits for a worker. */
+
+static struct s_job *
+s_job_of(struct mg_connection *c);
+/* Job whose reply is written to `c`, or NULL if `c` isn't a job's. */
+
+static int
+s_job_flush(struct mg_connection *c);
+/*
+ * Have the reply written so far to the job's `c` sent by the event loop while
+ * the handler goes on. Does nothing if `c` isn't a job's.
+ *
+ * Waits while more than STREAM_PENDING_MAX of the reply is left unsent, the
+ * time not counting toward the budget of the solve. A client reading none of
+ * it for STREAM_STALL_MS is given up on, as if gone, and its connection closed
+ * once the job is done.
+ *
+ * Returns 0 if the connection has been closed since.
+ */
+
+static void
+s_job_count(struct mg_connection *c, unsigned long iterations,
+            unsigned long evaluations);
+/*
+ * Count the work of the solver toward the metrics of the job. Does nothing if
+ * `c` isn't a job's.
+ */
+
+static void
+s_timing_mark(struct mg_connection *c, enum s_phase phase);
+/*
+ * Count the time since the last mark toward the `phase` of the job. Does
+ * nothing if `c` isn't a job's.
+ */
+
+static const char *
+s_job_budget(struct mg_connection *c, unsigned long evaluations);
+/*
+ * Budget the job's solve has exceeded after `evaluations` of its function:
+ * "time" past BUDGET_SOLVE_MS, "evaluations" past BUDGET_EVALS. NULL if none
+ * or `c` isn't a job's.
+ */
+
+static size_t
+s_timing_header(struct mg_connection *c, char *buf);
+/*
+ * Write the 'Server-Timing' header line of the phases timed but not yet sent
+ * into `buf` of S_TIMING_MAX, or an empty string if there are none or `c`
+ * isn't a job's.
+ *
+ * Returns the length written.
+ */
+
+static void
+s_job_run(void *arg);
+
+static struct mg_connection *
+s_conn_find(struct mg_mgr *mgr, unsigned long id);
+/* Return the connection of `mgr` with the `id` or NULL if it's been closed. */
+
+static void
+s_job_progress(void *arg);
+
+static void
+s_job_wake(struct mg_connection *c, int is_gone);
+/*
+ * Tell the job replying on `c`, if any, how much of the reply is left unsent
+ * and whether `c` is gone, waking it if waiting in 's_job_flush'.
+ */
+
+static void
+s_job_count_done(struct s_job *job);
+/* Count the work of the finished job in the metrics, its request aside. */
+
+static void
+s_job_free(struct s_job *job);
+
+static void
+s_job_done(void *arg);
+
+/* = Admission = */
+static uint64_t
+s_cost(struct mg_str body);
+/*
+ * Estimate the cost of solving the request `body` as the nodes of its
+ * expression times the iterations asked for, times the parameter steps if any.
+ * The polynomials count as the square of their coefficients, the expressions
+ * unknown, of sessions, as one node.
+ *
+ * Returns 0 if the iterations or the parameter steps aren't numbers, or are
+ * less than 1 and 0 respectively, and ADMIT_COST_MAX + 1 for any cost past
+ * ADMIT_COST_MAX.
+ */
+
+static int
+s_cost_param(struct mg_str body, const char *path, double min, double *num);
+/*
+ * Read the number at `path` of `body` into `num`, if there.
+ *
+ * Returns 0 if it's there but isn't a number of at least `min`.
+ */
+
+static int
+s_admit(struct mg_connection *c, uint64_t cost);
+/*
+ * Admit a request of `cost`, as given by 's_cost', unless it would put the ones
+ * being solved past ADMIT_COST_MAX, in which case a 429 response is given. A
+ * request within ADMIT_COST_MAX is always admitted while none are being
+ * solved, one past it or with invalid parameters never is and is given a 400.
+ *
+ * Returns 1 if admitted, its cost should then be given back with
+ * 's_admit_done'.
+ */
+
+static void
+s_admit_done(uint64_t cost);
+
+static int
+s_job_admit(struct mg_connection *c, struct s_job *job);
+/*
+ * Submit the job with 's_job_submit' if admitted for the cost of its request.
+ *
+ * Returns 0 if not, with the 429 response given on `c`.
+ */
+
+/* = Single flight = */
+static int
+s_flight_submit(struct mg_connection *c, struct s_job *job,
+                const struct s_route *route);
+/*
+ * Submit the job of a request to the cached `route` as 's_job_admit', unless
+ * the same request is being solved already: it then waits for it and is
+ * replied to from the result cache, see 's_flight_done'. No admission is
+ * needed for that.
+ *
+ * Returns 0 if not admitted.
+ */
+
+static void
+s_flight_land(struct s_job *job);
+/*
+ * Hand the requests waiting on the flight led by the finished job over to
+ * their event loops.
+ */
+
+static void
+s_flight_done(void *arg);
+/*
+ * Reply to a request that waited on a flight from the result cache. If the
+ * result didn't make it there, as it failed or was too large, it's solved on
+ * its own.
+ */
+
+/* = Problems = */
+/*
+ * Problems are objects with the fields of the request solving them, plus its
+ * "method" from 's_problem_methods'.
+ */
+static const struct s_route *
+s_problem_route(struct mg_connection *c, struct mg_str problem);
+/*
+ * Route solving the `problem` by its method.
+ *
+ * If it has none of them NULL is returned and a 400 response given.
+ */
+
+static struct s_job *
+s_problem_job(struct mg_connection *c, struct mg_str problem,
+              const struct s_route *problem_route, s_handler_t handler,
+              int route);
+/*
+ * Make a job running the handler for the `problem` on `c` as the body of a
+ * request to its route, not yet submitted. It's counted in the metrics of
+ * `route`.
+ */
+
+static void
+s_problem_solve(struct mg_connection *c, struct mg_http_message *hm);
+/* Solve the problem of a job with the handler of its method. */
+
+static void
+s_problem_result(struct mg_iobuf *io, const struct mg_iobuf *reply);
+/*
+ * Append the result made from the `reply` to a problem to `io`: an object with
+ * the "status" of the reply and its body as the "result" if it's a 200, as the
+ * "error" otherwise. The "session_id" is added if it started one.
+ */
+
+static void
+s_reply_dechunk(struct mg_str body, struct mg_iobuf *io);
+/* Append the data of the chunked `body` to `io`. */
+
+/* = Problems = */
+static const struct s_route *
+s_problem_route(struct mg_connection *c, struct mg_str problem)
+{
+	const struct s_route *route  = NULL;
+	char                 *method = mg_json_get_str(problem, "$.method");
+	for (size_t i = 0; method && i < sizeof(s_problem_methods) /
+	                                     sizeof(s_problem_methods[0]);
+	     i++) {
+		const void *route_data;
+		char        allow[RTR_ALLOW_MAX];
+		if (strcmp(method, s_problem_methods[i].name) == 0 &&
+		    rtr_find(&s_router, mg_str("POST"),
+		             mg_str(s_problem_methods[i].path), &route_data,
+		             allow) == RTR_FOUND)
+			route = route_data;
+	}
+	free(method);
+
+	if (!route)
+		mg_http_reply(c, 400, "",
+		              "Please provide the method, one of bisection, "
+		              "secant, horner-roots or continuation.");
+	return route;
+}
+
+static struct s_job *
+s_problem_job(struct mg_connection *c, struct mg_str problem,
+              const struct s_route *problem_route, s_handler_t handler,
+              int route)
+{
+	struct s_job *job  = s_job_new(c, handler, route, mtr_now_ns());
+	job->problem_route = problem_route;
+	job->message       = mg_strdup(problem);
+	job->hm.method     = mg_str("POST");
+	job->hm.uri        = mg_str(problem_route->path);
+	job->hm.message = job->hm.body = job->message;
+
+	return job;
+}
+
+static void
+s_problem_solve(struct mg_connection *c, struct mg_http_message *hm)
+{
+	struct s_job         *job   = c->fn_data;
+	const struct s_route *route = job->problem_route;
+
+	/* Not worth solving for a client that's gone or has cancelled. */
+	pthread_mutex_lock(&job->lock);
+	int is_gone = job->is_gone;
+	pthread_mutex_unlock(&job->lock);
+	if (is_gone ||
+	    (job->batch && __atomic_load_n(&job->batch->is_gone,
+	                                   __ATOMIC_RELAXED)))
+		return;
+
+	/* Over a WebSocket the rows are streamed as they're computed. */
+	if (!job->is_ws && route->cache_name &&
+	    s_reply_from_cache(c, hm, route->cache_name, route->cache_fields))
+		return;
+	route->handler(c, hm);
+}
+
+static void
+s_problem_result(struct mg_iobuf *io, const struct mg_iobuf *reply)
+{
+	struct mg_http_message hm;
+	struct mg_str          body   = mg_str_n(NULL, 0);
+	int                    status = 0;
+	if (mg_http_parse((char *)reply->buf, reply->len, &hm) > 0) {
+		status = (int)mg_to64(hm.uri);
+		body   = mg_str_n(hm.body.ptr, reply->len - hm.head.len);
+	}
+
+	struct mg_iobuf dechunked = { 0 };
+	struct mg_str  *te        = mg_http_get_header(&hm, "Transfer-Encoding");
+	if (te && mg_vcasecmp(te, "chunked") == 0) {
+		s_reply_dechunk(body, &dechunked);
+		body = mg_str_n((char *)dechunked.buf, dechunked.len);
+	}
+
+	struct jw w;
+	jw_init(&w, io);
+	jw_object_begin(&w);
+	jw_key(&w, "status");
+	jw_int(&w, status);
+	struct mg_str *session_id = mg_http_get_header(&hm, "X-Session-Id");
+	if (session_id) {
+		jw_key(&w, "session_id");
+		jw_str(&w, session_id->ptr, session_id->len);
+	}
+	jw_key(&w, status == 200 ? "result" : "error");
+	struct mg_str *ct = mg_http_get_header(&hm, "Content-Type");
+	if (ct && body.len && mg_strstr(*ct, mg_str("application/json")))
+		jw_raw(&w, body.ptr, body.len);
+	else
+		jw_str(&w, body.ptr, body.len);
+	jw_object_end(&w);
+
+	mg_iobuf_free(&dechunked);
+}
+
+static void
+s_reply_dechunk(struct mg_str body, struct mg_iobuf *io)
+{
+	/* "<hex size>\r\n<data>\r\n" each, till the empty one. */
+	for (;;) {
+		size_t i = 0;
+		while (i < body.len && isxdigit((unsigned char)body.ptr[i]))
+			i++;
+		size_t n    = mg_unhexn(body.ptr, i);
+		size_t skip = i + 2 + n + 2;
+		if (i == 0 || n == 0 || skip > body.len)
+			break;
+
+		mg_iobuf_add(io, io->len, body.ptr + i + 2, n, MG_IO_SIZE);
+		body.ptr += skip;
+		body.len -= skip;
+	}
+}
+
+/* = Batches = */
+static int
+s_batch_submit(struct mg_connection *c, struct mg_http_message *hm,
+               s_handler_t handler, int route, uint64_t start_ns);
+/*
+ * Run the handler on a worker thread for each problem of the JSON array in the
+ * request body, then send their results back in order as they're solved, see
+ * 's_problem_result'.
+ *
+ * The request is counted in the metrics of `route` once done. Returns 0 if a
+ * 400 response was given instead, to be counted by the caller.
+ */
+
+static int
+s_batch_next(struct mg_str *array, struct mg_str *problem);
+/*
+ * Take the next `problem` off the `array`, the JSON past its '['.
+ *
+ * Returns 0 once there are none left.
+ */
+
+static void
+s_batch_result(struct s_batch *batch, size_t i, const struct mg_iobuf *reply);
+/* Keep the result of the `i`th problem made from the `reply` to it. */
+
+static void
+s_batch_write(struct s_batch *batch, struct mg_connection *c, const void *buf,
+              size_t len, int is_last);
+/* Send the part of the reply as a chunk, compressed if the reply is. */
+
+static void
+s_batch_send(struct s_batch *batch);
+/*
+ * Send the results kept so far which are next in order, and end the reply once
+ * all are sent.
+ */
+
+static void
+s_batch_done(void *arg);
+
+/* = WebSockets = */
+static void
+s_handler_c_st_nm_1_ws(struct mg_connection *c, struct mg_http_message *hm);
+/*
+ * Upgrade to a WebSocket solving one problem at a time, sent as a text frame
+ * each. A solve is replied to with a frame per row as soon as it's computed,
+ * then a last one with its "status", as well as its "session_id" if it
+ * started one. The solvers without rows reply with their result in a single
+ * frame, see 's_problem_result'.
+ *
+ * A '{"cancel":true}' frame stops the solve going on, which then ends with
+ * "cancelled" set in its last frame. So does closing the connection.
+ */
+
+static void
+s_ws_message(struct mg_connection *c, struct mg_ws_message *wm);
+/* Solve the problem of the message, or cancel the one going on. */
+
+static void
+s_ws_cancel(struct mg_connection *c);
+/* Cancel the solve going on over `c`, if any. */
+
+static void
+s_ws_reply(struct mg_connection *c, const struct mg_iobuf *reply);
+/* Send the result made from the `reply` to a problem as a frame. */
+
+static void
+s_ws_end(struct mg_connection *c, const char *session_id, int is_cancelled,
+         const char *budget);
+/*
+ * Send the last frame of a solve streamed by rows, with the `budget` it
+ * exceeded if not NULL.
+ */
+
+static void
+s_ws_done(void *arg);
+
+static void
+s_reply_json(struct mg_connection *c, struct mg_http_message *hm,
+             const char *headers, struct mg_iobuf *io)
+{
+	/* The JSON has been written since the last mark. */
+	char timing[S_TIMING_MAX];
+	char head[256 + S_TIMING_MAX];
+	s_timing_mark(c, S_PHASE_WRITE);
+	s_timing_header(c, timing);
+	mg_snprintf(head, sizeof(head),
+	            "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+	            "Vary: Accept-Encoding\r\n%s%s",
+	            headers, timing);
+
+	/* Compressing it is only counted in the metrics. */
+	s_reply_body(c, head, s_encoding(hm, io->len), io->buf, io->len);
+	s_timing_mark(c, S_PHASE_WRITE);
+	mg_iobuf_free(io);
+}
+
+static int
+s_reply_status(const struct mg_iobuf *io, size_t ofs)
+{
+	const char *line = (const char *)io->buf + ofs;
+	if (io->len < ofs + 12 || memcmp(line, "HTTP/1.", 7) != 0)
+		return 0;
+
+	return (int)mg_to64(mg_str_n(line + 9, 3));
+}
+/* = Streaming = */
+static void
+s_stream_begin(struct s_stream *st, struct mg_connection *c,
+               struct mg_http_message *hm, const char *session_id,
+               const char *cache_key, size_t cache_key_len)
+{
+	memset(st, 0, sizeof(*st));
+	st->c = c;
+	jw_init(&st->w, &st->chunk);
+
+	/* No headers nor array, only the rows as they come. */
+	struct s_job *job = s_job_of(c);
+	if (job && job->is_ws) {
+		st->is_ws      = 1;
+		st->session_id = session_id;
+		job->status    = 200;
+		return;
+	}
+
+	/* The result cache holds the JSON. */
+	st->hm            = hm;
+	st->session_id    = session_id;
+	st->is_cbor       = s_wants_cbor(hm);
+	st->cache_key     = st->is_cbor ? NULL : cache_key;
+	st->cache_key_len = cache_key_len;
+
+	if (st->is_cbor) {
+		struct cw w;
+		cw_init(&w, &st->chunk);
+		cw_array_begin(&w);
+	} else {
+		jw_array_begin(&st->w);
+	}
+}
+
+static void
+s_stream_head(struct s_stream *st)
+{
+	/* Unless it's all there and too short. */
+	st->enc = s_encoding(st->hm, st->is_ending ? st->chunk.len
+	                                           : COMPRESS_SIZE_MIN);
+	if (st->enc != AST_IDENTITY &&
+	    !(st->dfl = dfl_new(COMPRESS_LEVEL, st->enc == AST_GZIP
+	                                                ? DFL_GZIP
+	                                                : DFL_ZLIB)))
+		st->enc = AST_IDENTITY;
+
+	/* The phases up to the first chunk are done by now, the rest are sent
+	 * in the trailer. */
+	char timing[S_TIMING_MAX];
+	s_timing_header(st->c, timing);
+
+	const char *session_id = st->session_id;
+	mg_printf(st->c,
+	          "HTTP/1.1 200 OK\r\nContent-Type: application/%s\r\n"
+	          "Vary: Accept, Accept-Encoding\r\n"
+	          "%s%s%s%s%s%s%s%s"
+	          "Transfer-Encoding: chunked\r\n\r\n",
+	          st->is_cbor ? "cbor" : "json",
+	          st->dfl ? "Content-Encoding: " : "",
+	          st->dfl ? ast_enc_name(st->enc) : "", st->dfl ? "\r\n" : "",
+	          session_id ? "X-Session-Id: " : "",
+	          session_id ? session_id : "", session_id ? "\r\n" : "",
+	          timing,
+	          st->c->mgr ? ""
+	                     : "Trailer: Server-Timing, X-Budget-Exceeded\r\n");
+	st->is_head_sent = 1;
+}
+
+static int
+s_wants_cbor(struct mg_http_message *hm)
+{
+	/* JSON on ties and to the clients taking anything. */
+	struct mg_str *accept = mg_http_get_header(hm, "Accept");
+	return accept && ast_accept_q(accept, "application/cbor") >
+	                         ast_accept_q(accept, "application/json");
+}
+
+static void
+s_stream_row(struct s_stream *st)
+{
+	if (!st->is_ws)
+		return;
+
+	mg_ws_send(st->c, (char *)st->chunk.buf, st->chunk.len,
+	           WEBSOCKET_OP_TEXT);
+	st->chunk.len = 0;
+	jw_init(&st->w, &st->chunk);
+}
+
+static int
+s_stream_flush(struct s_stream *st)
+{
+	/* The frames are written to the connection already. */
+	if (st->is_ws && !st->is_gone) {
+		st->is_gone = !s_job_flush(st->c);
+		s_timing_mark(st->c, S_PHASE_WRITE);
+	}
+	if (st->is_gone || !st->chunk.len)
+		return !st->is_gone;
+	if (!st->is_head_sent)
+		s_stream_head(st);
+
+	if (st->cache_key) {
+		if (st->body.len + st->chunk.len <= CACHE_ENTRY_MAX) {
+			mg_iobuf_add(&st->body, st->body.len, st->chunk.buf,
+			             st->chunk.len, MG_IO_SIZE);
+		} else {
+			st->cache_key = NULL;
+			mg_iobuf_free(&st->body);
+		}
+	}
+
+	/* Each chunk ends on a byte boundary to be read as soon as it comes. */
+	if (st->dfl) {
+		st->zchunk.len = 0;
+		dfl_write(st->dfl, &st->zchunk, st->chunk.buf, st->chunk.len,
+		          st->is_ending ? DFL_FINISH : DFL_SYNC);
+		mg_http_write_chunk(st->c, (char *)st->zchunk.buf,
+		                    st->zchunk.len);
+	} else {
+		mg_http_write_chunk(st->c, (char *)st->chunk.buf,
+		                    st->chunk.len);
+	}
+	st->chunk.len = 0;
+	st->is_gone   = !s_job_flush(st->c);
+	s_timing_mark(st->c, S_PHASE_WRITE);
+
+	return !st->is_gone;
+}
+
+static void
+s_stream_end(struct s_stream *st)
+{
+	/* Sent along with the rows left once the job is done. */
+	if (st->is_ws) {
+		s_ws_end(st->c, st->session_id, st->is_gone, st->budget);
+		s_timing_mark(st->c, S_PHASE_WRITE);
+		mg_iobuf_free(&st->chunk);
+		return;
+	}
+
+	if (st->is_cbor) {
+		struct cw w;
+		cw_init(&w, &st->chunk);
+		cw_end(&w);
+	} else {
+		jw_array_end(&st->w);
+	}
+	st->is_ending = 1;
+	s_stream_flush(st);
+
+	/* The last chunk, with the trailer. */
+	char timing[S_TIMING_MAX];
+	s_timing_mark(st->c, S_PHASE_WRITE);
+	s_timing_header(st->c, timing);
+	mg_printf(st->c, "0\r\n%s%s%s%s\r\n", timing,
+	          st->budget ? "X-Budget-Exceeded: " : "",
+	          st->budget ? st->budget : "", st->budget ? "\r\n" : "");
+
+	/* Cut short, it isn't the reply to the request. */
+	if (st->cache_key && !st->is_gone && !st->budget) {
+		pthread_mutex_lock(&s_cache_lock);
+		cache_put(&s_cache, st->cache_key, st->cache_key_len,
+		          (char *)st->body.buf, st->body.len);
+		pthread_mutex_unlock(&s_cache_lock);
+	}
+
+	dfl_free(st->dfl);
+	mg_iobuf_free(&st->zchunk);
+	mg_iobuf_free(&st->chunk);
+	mg_iobuf_free(&st->body);
+}
+
+/* = Compression = */
+static enum ast_enc_t
+s_encoding(struct mg_http_message *hm, size_t len)
+{
+	struct mg_str *accept = mg_http_get_header(hm, "Accept-Encoding");
+	if (!accept || len < COMPRESS_SIZE_MIN)
+		return AST_IDENTITY;
+
+	double q_gzip    = ast_accept_q(accept, "gzip");
+	double q_deflate = ast_accept_q(accept, "deflate");
+	if (q_gzip > 0 && q_gzip >= q_deflate)
+		return AST_GZIP;
+	return q_deflate > 0 ? AST_DEFLATE : AST_IDENTITY;
+}
+
+static void
+s_etag(const char *etag, enum ast_enc_t enc, char *buf)
+{
+	/* Suffixed inside the quotes. */
+	size_t len = strlen(etag);
+	mg_snprintf(buf, S_ETAG_MAX, "%.*s%s\"", (int)(len - 1), etag,
+	            s_etag_suffixes[enc]);
+}
+
+static void
+s_reply_body(struct mg_connection *c, const char *head, enum ast_enc_t enc,
+             const void *body, size_t len)
+{
+	struct mg_iobuf z = { 0 };
+	if (enc != AST_IDENTITY &&
+	    dfl_compress(&z, body, len, COMPRESS_LEVEL,
+	                 enc == AST_GZIP ? DFL_GZIP : DFL_ZLIB)) {
+		body = z.buf;
+		len  = z.len;
+	} else {
+		enc = AST_IDENTITY;
+	}
+
+	mg_printf(c, "%s%s%s%sContent-Length: %lu\r\n\r\n", head,
+	          enc ? "Content-Encoding: " : "", enc ? ast_enc_name(enc) : "",
+	          enc ? "\r\n" : "", (unsigned long)len);
+	mg_send(c, body, len);
+	mg_iobuf_free(&z);
+}
+
+/* = Result cache = */
+static size_t
+s_cache_key(struct mg_str body, const char *name,
+            const struct s_cache_field *fields, char *key, size_t key_max)
+{
+	int toklen;
+
+	if (mg_json_get(body.ptr, (int)body.len, "$.session", &toklen) >= 0 ||
+	    mg_json_get(body.ptr, (int)body.len, "$.session_id", &toklen) >= 0)
+		return 0;
+
+	size_t key_len = strlen(name);
+	if (key_len >= key_max)
+		return 0;
+	memcpy(key, name, key_len);
+	key[key_len++] = '\0';
+
+	for (; fields->path; fields++) {
+		if (fields->type == 's') {
+			/* Raw JSON string with the whitespace runs collapsed. */
+			int ofs = mg_json_get(body.ptr, (int)body.len,
+			                      fields->path, &toklen);
+			if (ofs < 0 || body.ptr[ofs] != '"')
+				return 0;
+			for (int i = 0; i < toklen; i++) {
+				char ch = body.ptr[ofs + i];
+				if (isspace((unsigned char)ch)) {
+					if (isspace((unsigned char)body.ptr[ofs + i + 1]) ||
+					    key[key_len - 1] == '"' ||
+					    body.ptr[ofs + i + 1] == '"')
+						continue;
+					ch = ' ';
+				}
+				if (key_len == key_max)
+					return 0;
+				key[key_len++] = ch;
+			}
+			continue;
+		}
+
+		/* Numbers as the handlers would read them. Out of the range
+		 * of their type, they aren't cached. */
+		double num;
+		if (!mg_json_get_num(body, fields->path, &num))
+			return 0;
+		if (fields->type == 'f') {
+			if (!(num >= -FLT_MAX && num <= FLT_MAX) ||
+			    key_len + sizeof(float) > key_max)
+				return 0;
+			float num_f = num;
+			memcpy(key + key_len, &num_f, sizeof(float));
+			key_len += sizeof(float);
+		} else {
+			if (!(num > INT_MIN - 1.0 && num < INT_MAX + 1.0) ||
+			    key_len + sizeof(int) > key_max)
+				return 0;
+			int num_i = num;
+			memcpy(key + key_len, &num_i, sizeof(int));
+			key_len += sizeof(int);
+		}
+	}
+
+	return key_len;
+}
+
+static void
+s_reply_cached(struct mg_connection *c, struct mg_http_message *hm,
+               const char *etag, const char *body, size_t len)
+{
+	enum ast_enc_t enc = s_encoding(hm, len);
+	char           etag_enc[S_ETAG_MAX];
+	s_etag(etag, enc, etag_enc);
+
+	struct mg_str *inm = mg_http_get_header(hm, "If-None-Match");
+	if (inm && mg_vcmp(inm, etag_enc) == 0) {
+		mg_printf(c, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\n"
+		             "Vary: Accept, Accept-Encoding\r\n"
+		             "Content-Length: 0\r\n\r\n",
+		          etag_enc);
+		return;
+	}
+
+	char head[128 + S_ETAG_MAX];
+	mg_snprintf(head, sizeof(head),
+	            "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+	            "Vary: Accept, Accept-Encoding\r\nETag: %s\r\n",
+	            etag_enc);
+	s_reply_body(c, head, enc, body, len);
+}
+
+static int
+s_reply_from_cache(struct mg_connection *c, struct mg_http_message *hm,
+                   const char *name, const struct s_cache_field *fields)
+{
+	char   cache_key[S_CACHE_KEY_MAX];
+	size_t cache_key_len =
+		s_cache_key(hm->body, name, fields, cache_key, sizeof(cache_key));
+	if (!cache_key_len || s_wants_cbor(hm))
+		return 0;
+
+	/* Copied out so that it's compressed without holding the lock. */
+	char   etag[CACHE_ETAG_LEN + 1];
+	char  *body = NULL;
+	size_t len  = 0;
+	pthread_mutex_lock(&s_cache_lock);
+	struct cache_entry *entry = cache_get(&s_cache, cache_key, cache_key_len);
+	int                 is_hit = entry && (body = malloc(entry->body_len + 1));
+	if (is_hit) {
+		memcpy(etag, entry->etag, sizeof(etag));
+		memcpy(body, entry->body, entry->body_len);
+		len = entry->body_len;
+	}
+	pthread_mutex_unlock(&s_cache_lock);
+
+	if (is_hit)
+		s_reply_cached(c, hm, etag, body, len);
+	free(body);
+
+	return is_hit;
+}
+
+static void
+s_handler_server_cache(struct mg_connection *c, struct mg_http_message *hm)
+{
+	(void)hm;
+
+	/* Requests that waited on the same one being solved are counted apart,
+	 * as "shared". */
+	unsigned int in_flight = 0;
+	pthread_mutex_lock(&s_flights_lock);
+	for (struct s_flight *f = s_flights; f; f = f->next)
+		in_flight++;
+	uint64_t shared = s_flights_shared;
+	pthread_mutex_unlock(&s_flights_lock);
+
+	pthread_mutex_lock(&s_cache_lock);
+	uint64_t lookups = s_cache.hits + s_cache.misses;
+	mg_http_reply(c, 200, "Content-Type: application/json\r\n",
+	              "{\"entries\":%u,\"size\":%lu,\"size_max\":%lu,"
+	              "\"hits\":%llu,\"misses\":%llu,\"hit_ratio\":%g,"
+	              "\"in_flight\":%u,\"shared\":%llu}\n",
+	              s_cache.count, (unsigned long)s_cache.size,
+	              (unsigned long)s_cache.size_max,
+	              (unsigned long long)s_cache.hits,
+	              (unsigned long long)s_cache.misses,
+	              lookups ? (double)s_cache.hits / lookups : 0.0,
+	              in_flight, (unsigned long long)shared);
+	pthread_mutex_unlock(&s_cache_lock);
+}
+
+static void
+s_handler_metrics(struct mg_connection *c, struct mg_http_message *hm)
+{
+	(void)hm;
+
+	struct mg_iobuf io = { 0 };
+	mtr_print(&s_metrics, &io);
+	if (s_log_is_on) {
+		char   buf[256];
+		size_t len = mg_snprintf(
+			buf, sizeof(buf),
+			"# HELP " MTR_PREFIX "log_dropped_total Log records "
+			"dropped for lack of room.\n"
+			"# TYPE " MTR_PREFIX "log_dropped_total counter\n"
+			MTR_PREFIX "log_dropped_total %llu\n",
+			(unsigned long long)lgr_dropped(&s_log));
+		mg_iobuf_add(&io, io.len, buf, len, MG_IO_SIZE);
+	}
+	s_metrics_lanes(&io);
+	mg_printf(c,
+	          "HTTP/1.1 200 OK\r\n"
+	          "Content-Type: text/plain; version=0.0.4\r\n"
+	          "Content-Length: %lu\r\n\r\n",
+	          (unsigned long)io.len);
+	mg_send(c, io.buf, io.len);
+	mg_iobuf_free(&io);
+}
+
+static void
+s_metrics_lanes(struct mg_iobuf *io)
+{
+	/* The static assets, cache hits and metrics are replied to right away
+	 * by the event loops, only the solves wait in the lanes. */
+	static const char *help[4][3] = {
+		{ "lane_queued", "gauge", "Solves waiting for a worker." },
+		{ "lane_running", "gauge", "Solves being run." },
+		{ "lane_done_queued", "gauge",
+		  "Solves run, waiting for their event loop to reply." },
+		{ "lane_started_total", "counter", "Solves started." },
+	};
+
+	struct wrk_stats stats[S_LANE_C];
+	for (int i = 0; i < S_LANE_C; i++)
+		wrk_lane_stats(&s_workers, i, &stats[i]);
+
+	for (int m = 0; m < 4; m++) {
+		char   buf[256];
+		size_t len = mg_snprintf(buf, sizeof(buf),
+		                         "# HELP " MTR_PREFIX "%s %s\n"
+		                         "# TYPE " MTR_PREFIX "%s %s\n",
+		                         help[m][0], help[m][2], help[m][0],
+		                         help[m][1]);
+		mg_iobuf_add(io, io->len, buf, len, MG_IO_SIZE);
+		for (int i = 0; i < S_LANE_C; i++) {
+			uint64_t values[4] = { stats[i].queued,
+			                       stats[i].running,
+			                       stats[i].done_queued,
+			                       stats[i].started };
+			len = mg_snprintf(buf, sizeof(buf),
+			                  MTR_PREFIX "%s{lane=\"%s\"} %llu\n",
+			                  help[m][0], s_lane_names[i],
+			                  (unsigned long long)values[m]);
+			mg_iobuf_add(io, io->len, buf, len, MG_IO_SIZE);
+		}
+	}
+}
+
+/* = Static assets = */
+static void
+s_reply_asset(struct mg_connection *c, struct mg_http_message *hm)
+{
+	pthread_rwlock_rdlock(&s_assets_lock);
+
+	int                     status = 200;
+	const struct ast_asset *asset  = ast_find(&s_assets, hm->uri);
+	if (!asset) {
+		status = 404;
+		asset  = ast_find(&s_assets, mg_str(ASSETS_PAGE_404));
+	}
+	if (!asset) {
+		pthread_rwlock_unlock(&s_assets_lock);
+		mg_http_reply(c, 404, "", "Not found\n");
+		return;
+	}
+	if (status == 200 && ast_is_on_disk(asset)) {
+		/* sendfile(2) where it can, handles the ranges too */
+		char                      path[MG_PATH_MAX];
+		struct mg_http_serve_opts opts = { 0 };
+		opts.fs                        = s_assets.fs;
+		mg_snprintf(path, sizeof(path), "%s%s", s_assets.root,
+		            asset->path);
+		pthread_rwlock_unlock(&s_assets_lock);
+		mg_http_serve_file(c, hm, path, &opts);
+		return;
+	}
+
+	enum ast_enc_t enc =
+		ast_negotiate(asset, mg_http_get_header(hm, "Accept-Encoding"));
+	char headers[64] = "";
+	if (enc != AST_IDENTITY)
+		mg_snprintf(headers, sizeof(headers),
+		            "Content-Encoding: %s\r\n", ast_enc_name(enc));
+	const char *vary = asset->bodies[AST_GZIP].len ||
+	                           asset->bodies[AST_DEFLATE].len
+	                   ? "Vary: Accept-Encoding\r\n"
+	                   : "";
+
+	struct mg_str *inm = mg_http_get_header(hm, "If-None-Match");
+	if (status == 200 && inm && mg_vcmp(inm, asset->etags[enc]) == 0) {
+		mg_printf(c,
+		          "HTTP/1.1 304 Not Modified\r\n"
+		          "Etag: %s\r\n"
+		          "%s"
+		          "Content-Length: 0\r\n\r\n",
+		          asset->etags[enc], vary);
+	} else {
+		const struct mg_str *body = &asset->bodies[enc];
+		mg_printf(c,
+		          "HTTP/1.1 %d %s\r\n"
+		          "Content-Type: %.*s\r\n"
+		          "Etag: %s\r\n"
+		          "%s%s"
+		          "Content-Length: %lu\r\n\r\n",
+		          status, mg_http_status_code_str(status),
+		          (int)asset->mime.len, asset->mime.ptr,
+		          asset->etags[enc], headers, vary,
+		          (unsigned long)body->len);
+		if (mg_vcasecmp(&hm->method, "HEAD") != 0)
+			mg_send(c, body->ptr, body->len);
+	}
+
+	pthread_rwlock_unlock(&s_assets_lock);
+}
+
+static void
+s_assets_sync_fn(void *arg)
+{
+	unsigned int changed = ast_sync(arg, &s_assets_lock);
+	if (changed)
+		MG_INFO(("Reloaded %u static asset(s)", changed));
+}
+
+/* = Workers = */
+static struct s_job *
+s_job_new(struct mg_connection *c, s_handler_t handler, int route,
+          uint64_t start_ns)
+{
+	struct s_job *job = calloc(1, sizeof(struct s_job));
+	job->job.run      = s_job_run;
+	job->job.done     = s_job_done;
+	job->job.progress = s_job_progress;
+	job->job.arg      = job;
+	job->mgr          = c->mgr;
+	job->conn_id      = c->id;
+	job->handler      = handler;
+	job->route        = route;
+	job->start_ns     = start_ns;
+	job->out.id       = c->id;
+	job->out.fn_data  = job;
+	pthread_mutex_init(&job->lock, NULL);
+
+	/* Waited on against the clock of 'mtr_now_ns'. */
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&job->drained, &attr);
+	pthread_condattr_destroy(&attr);
+
+	return job;
+}
+
+static struct s_job *
+s_job_request(struct mg_connection *c, struct mg_http_message *hm,
+              s_handler_t handler, int route, uint64_t start_ns)
+{
+	struct s_job *job = s_job_new(c, handler, route, start_ns);
+
+	/* The request lives in the connection's buffer which is reused once we
+	 * return, so the worker gets its own (NUL terminated) copy. */
+	job->message = mg_strdup(hm->message);
+	mg_http_parse((char *)job->message.ptr, job->message.len, &job->hm);
+
+	return job;
+}
+
+static void
+s_job_submit(struct mg_connection *c, struct s_job *job)
+{
+	job->job.lane = s_lane(job->cost);
+
+	/* Hold back the next requests, even the ones read already, so the
+	 * replies keep their order. Let go with 'mg_resume' once done. */
+	c->is_full = 1;
+	c->fn_data = job;
+	wrk_submit(&((struct s_reactor *)c->mgr->userdata)->workers, &job->job);
+}
+
+static enum s_lane
+s_lane(uint64_t cost)
+{
+	return cost > LANE_COST_INTERACTIVE ? S_LANE_BULK : S_LANE_INTERACTIVE;
+}
+
+static struct s_job *
+s_job_of(struct mg_connection *c)
+{
+	/* Only the detached connections of the jobs have no manager. */
+	return c->mgr ? NULL : c->fn_data;
+}
+
+static int
+s_job_flush(struct mg_connection *c)
+{
+	struct s_job *job = s_job_of(c);
+	if (!job)
+		return 1;
+
+	/* The problems of a batch are sent back whole, once solved. */
+	if (job->batch)
+		return !__atomic_load_n(&job->batch->is_gone, __ATOMIC_RELAXED);
+
+	if (!job->status)
+		job->status = s_reply_status(&c->send, 0);
+	pthread_mutex_lock(&job->lock);
+	mg_iobuf_add(&job->stream, job->stream.len, c->send.buf, c->send.len,
+	             MG_IO_SIZE);
+	pthread_mutex_unlock(&job->lock);
+	job->bytes_out += c->send.len;
+	c->send.len = 0;
+	wrk_progress(&job->job);
+
+	/* = Wait for the client = */
+	/* Woken on every write to it, and a while after to see if the server
+	 * is stopping. */
+	uint64_t wait_ns  = mtr_now_ns();
+	uint64_t stall_ns = wait_ns + STREAM_STALL_MS * 1000000ull;
+	pthread_mutex_lock(&job->lock);
+	while (!job->is_gone && !s_signo &&
+	       job->stream.len + job->unsent > STREAM_PENDING_MAX) {
+		size_t   pending = job->stream.len + job->unsent;
+		uint64_t wake_ns = mtr_now_ns() + 100 * 1000000ull;
+		if (wake_ns > stall_ns)
+			wake_ns = stall_ns;
+		struct timespec wake = { wake_ns / 1000000000,
+			                 wake_ns % 1000000000 };
+		pthread_cond_timedwait(&job->drained, &job->lock, &wake);
+
+		uint64_t now = mtr_now_ns();
+		if (job->stream.len + job->unsent < pending)
+			stall_ns = now + STREAM_STALL_MS * 1000000ull;
+		else if (now >= stall_ns)
+			job->is_gone = job->is_stalled = 1;
+	}
+	int is_gone = job->is_gone;
+	pthread_mutex_unlock(&job->lock);
+	job->deadline_ns += mtr_now_ns() - wait_ns;
+
+	return !is_gone;
+}
+
+static void
+s_job_count(struct mg_connection *c, unsigned long iterations,
+            unsigned long evaluations)
+{
+	if (c->mgr)
+		return;
+
+	struct s_job *job = c->fn_data;
+	job->iterations += iterations;
+	job->evaluations += evaluations;
+}
+
+static void
+s_timing_mark(struct mg_connection *c, enum s_phase phase)
+{
+	if (c->mgr)
+		return;
+
+	struct s_job *job = c->fn_data;
+	uint64_t      now = mtr_now_ns();
+	job->phases_ns[phase] += now - job->mark_ns;
+	job->mark_ns = now;
+	job->timed |= 1u << phase;
+}
+
+static const char *
+s_job_budget(struct mg_connection *c, unsigned long evaluations)
+{
+	if (c->mgr)
+		return NULL;
+
+	struct s_job *job = c->fn_data;
+	if (evaluations > BUDGET_EVALS)
+		return "evaluations";
+	return mtr_now_ns() > job->deadline_ns ? "time" : NULL;
+}
+
+static size_t
+s_timing_header(struct mg_connection *c, char *buf)
+{
+	size_t len = 0;
+	*buf       = '\0';
+	if (c->mgr)
+		return 0;
+
+	/* Durations are in milliseconds, down to the nanosecond. */
+	struct s_job *job = c->fn_data;
+	for (int i = 0; i < S_PHASE_C; i++) {
+		if (!(job->timed & ~job->reported & (1u << i)))
+			continue;
+		len += mg_snprintf(buf + len, S_TIMING_MAX - len,
+		                   "%s%s;dur=%llu.%06llu",
+		                   len ? ", " : "Server-Timing: ",
+		                   s_phase_names[i],
+		                   (unsigned long long)(job->phases_ns[i] /
+		                                        1000000),
+		                   (unsigned long long)(job->phases_ns[i] %
+		                                        1000000));
+		job->reported |= 1u << i;
+	}
+	if (len)
+		len += mg_snprintf(buf + len, S_TIMING_MAX - len, "\r\n");
+
+	return len;
+}
+
+static void
+s_job_run(void *arg)
+{
+	struct s_job *job = arg;
+
+	job->mark_ns = job->start_ns;
+	s_timing_mark(&job->out, S_PHASE_QUEUE);
+	job->deadline_ns = job->mark_ns + BUDGET_SOLVE_MS * 1000000ull;
+	job->handler(&job->out, &job->hm);
+}
+
+static struct mg_connection *
+s_conn_find(struct mg_mgr *mgr, unsigned long id)
+{
+	struct mg_connection *c = mgr->conns;
+	while (c && c->id != id)
+		c = c->next;
+
+	return c;
+}
+
+static void
+s_job_progress(void *arg)
+{
+	struct s_job *job = arg;
+
+	struct mg_connection *c = s_conn_find(job->mgr, job->conn_id);
+	pthread_mutex_lock(&job->lock);
+	if (c)
+		mg_send(c, job->stream.buf, job->stream.len);
+	else
+		job->is_gone = 1;
+	job->stream.len = 0;
+	job->unsent     = c ? c->send.len : 0;
+	pthread_cond_signal(&job->drained);
+	pthread_mutex_unlock(&job->lock);
+}
+
+static void
+s_job_wake(struct mg_connection *c, int is_gone)
+{
+	struct s_job *job = c->fn_data;
+	if (!job)
+		return;
+
+	pthread_mutex_lock(&job->lock);
+	job->unsent = c->send.len;
+	job->is_gone |= is_gone;
+	pthread_cond_signal(&job->drained);
+	pthread_mutex_unlock(&job->lock);
+}
+
+static void
+s_job_count_done(struct s_job *job)
+{
+	mtr_solver(&s_metrics, job->route, job->iterations, job->evaluations);
+	for (int i = 0; i < S_PHASE_C; i++)
+		if (job->timed & (1u << i))
+			mtr_phase_time(&s_metrics, job->route, i,
+			               job->phases_ns[i]);
+}
+
+static void
+s_job_free(struct s_job *job)
+{
+	s_admit_done(job->cost);
+	mg_iobuf_free(&job->out.send);
+	mg_iobuf_free(&job->stream);
+	pthread_cond_destroy(&job->drained);
+	pthread_mutex_destroy(&job->lock);
+	free((void *)job->message.ptr);
+	free(job);
+}
+
+static void
+s_job_done(void *arg)
+{
+	struct s_job *job = arg;
+
+	/* The rows no progress call got to go first. A client given up on is
+	 * left with its reply cut short. */
+	struct mg_connection *c = s_conn_find(job->mgr, job->conn_id);
+	if (c)
+		c->fn_data = NULL;
+	if (c && job->is_stalled) {
+		mg_error(c, "stalled reading the reply");
+	} else if (c && !job->job.is_cancelled) {
+		mg_send(c, job->stream.buf, job->stream.len);
+		mg_send(c, job->out.send.buf, job->out.send.len);
+		mg_resume(c);
+	}
+
+	if (!job->status)
+		job->status = s_reply_status(&job->out.send, 0);
+	uint64_t duration_ns = mtr_now_ns() - job->start_ns;
+	mtr_request(&s_metrics, job->route, job->status, duration_ns);
+	s_job_count_done(job);
+	if (s_log_access)
+		lgr_access(&s_log, job->hm.method, job->hm.uri, job->status,
+		           duration_ns, job->message.len,
+		           job->bytes_out + job->out.send.len);
+
+	if (job->flight)
+		s_flight_land(job);
+	s_job_free(job);
+}
+
+/* = Admission = */
+static uint64_t
+s_cost(struct mg_str body)
+{
+	/* Priced as asked for, so checked before the handlers would. */
+	double iterations = 1, steps = 0, nodes = 1;
+	if (!s_cost_param(body, "$.iterations", 1, &iterations) ||
+	    !s_cost_param(body, "$.param_steps", 0, &steps))
+		return 0;
+
+	/* Every name, number and operator is a node of tinyexpr's. */
+	int toklen;
+	int ofs = mg_json_get(body.ptr, (int)body.len, "$.input_expr", &toklen);
+	if (ofs >= 0 && body.ptr[ofs] == '"') {
+		nodes = 0;
+		for (int i = ofs + 1, is_name = 0; i < ofs + toklen - 1; i++) {
+			char ch = body.ptr[i];
+			if (isalnum((unsigned char)ch) || ch == '.' ||
+			    ch == '_') {
+				nodes += !is_name;
+				is_name = 1;
+				continue;
+			}
+			nodes += !strchr(" (),", ch);
+			is_name = 0;
+		}
+	}
+	ofs = mg_json_get(body.ptr, (int)body.len, "$.poly_body", &toklen);
+	if (ofs >= 0 && body.ptr[ofs] == '[') {
+		nodes = 1;
+		for (int i = ofs; i < ofs + toklen; i++)
+			nodes += body.ptr[i] == ',';
+		nodes *= nodes;
+	}
+
+	double cost = (nodes > 1 ? nodes : 1) * iterations * (steps + 1);
+	return cost <= ADMIT_COST_MAX ? (uint64_t)cost : ADMIT_COST_MAX + 1;
+}
+
+static int
+s_cost_param(struct mg_str body, const char *path, double min, double *num)
+{
+	int toklen;
+	if (mg_json_get(body.ptr, (int)body.len, path, &toklen) < 0)
+		return 1;
+
+	return mg_json_get_num(body, path, num) && *num >= min;
+}
+
+static int
+s_admit(struct mg_connection *c, uint64_t cost)
+{
+	if (!cost || cost > ADMIT_COST_MAX) {
+		mg_http_reply(c, 400, "",
+		              cost ? "The problem is too large to be solved, "
+		                     "please ask for fewer iterations or steps."
+		                   : "The iterations should be positive and "
+		                     "the parameter steps not negative.");
+		return 0;
+	}
+
+	uint64_t admitted = __atomic_load_n(&s_admitted, __ATOMIC_RELAXED);
+	do {
+		if (admitted && admitted + cost > ADMIT_COST_MAX) {
+			char headers[32];
+			mg_snprintf(headers, sizeof(headers),
+			            "Retry-After: %d\r\n", ADMIT_RETRY_AFTER_S);
+			mg_http_reply(c, 429, headers,
+			              "The server is busy, please retry in a "
+			              "moment.");
+			return 0;
+		}
+	} while (!__atomic_compare_exchange_n(&s_admitted, &admitted,
+	                                      admitted + cost, 1,
+	                                      __ATOMIC_RELAXED,
+	                                      __ATOMIC_RELAXED));
+
+	return 1;
+}
+
+static void
+s_admit_done(uint64_t cost)
+{
+	__atomic_fetch_sub(&s_admitted, cost, __ATOMIC_RELAXED);
+}
+
+static int
+s_job_admit(struct mg_connection *c, struct s_job *job)
+{
+	uint64_t cost = s_cost(job->hm.body);
+	if (!s_admit(c, cost))
+		return 0;
+
+	job->cost = cost;
+	s_job_submit(c, job);
+	return 1;
+}
+
+/* = Single flight = */
+static int
+s_flight_submit(struct mg_connection *c, struct s_job *job,
+                const struct s_route *route)
+{
+	/* Shared through the result cache, so only what it would hold. */
+	char   key[S_CACHE_KEY_MAX];
+	size_t key_len = s_cache_key(job->hm.body, route->cache_name,
+	                             route->cache_fields, key, sizeof(key));
+	if (!key_len || s_wants_cbor(&job->hm))
+		return s_job_admit(c, job);
+
+	pthread_mutex_lock(&s_flights_lock);
+	struct s_flight *flight = s_flights;
+	while (flight && (flight->key_len != key_len ||
+	                  memcmp(flight->key, key, key_len) != 0))
+		flight = flight->next;
+	if (flight) {
+		job->flight_route = route;
+		job->flight_next  = flight->followers;
+		flight->followers = job;
+		s_flights_shared++;
+		/* Handed back to this loop once landed. */
+		c->is_full = 1;
+	} else {
+		/* Submitted before unlocking, so that no one joins a flight
+		 * that isn't admitted. */
+		flight = calloc(1, sizeof(struct s_flight));
+		memcpy(flight->key, key, key_len);
+		flight->key_len = key_len;
+		job->flight     = flight;
+		if (s_job_admit(c, job)) {
+			LIST_ADD_HEAD(struct s_flight, &s_flights, flight);
+		} else {
+			job->flight = NULL;
+			free(flight);
+			flight = NULL;
+		}
+	}
+	pthread_mutex_unlock(&s_flights_lock);
+
+	return flight != NULL;
+}
+
+static void
+s_flight_land(struct s_job *job)
+{
+	/* Nothing joins it once out of the list. */
+	struct s_flight *flight = job->flight;
+	pthread_mutex_lock(&s_flights_lock);
+	LIST_DELETE(struct s_flight, &s_flights, flight);
+	pthread_mutex_unlock(&s_flights_lock);
+
+	for (struct s_job *next, *f = flight->followers; f; f = next) {
+		next                = f->flight_next;
+		f->job.done         = s_flight_done;
+		f->job.is_cancelled = job->job.is_cancelled;
+		wrk_post(&((struct s_reactor *)f->mgr->userdata)->workers,
+		         &f->job);
+	}
+	free(flight);
+}
+
+static void
+s_flight_done(void *arg)
+{
+	struct s_job         *job   = arg;
+	const struct s_route *route = job->flight_route;
+
+	struct mg_connection *c = s_conn_find(job->mgr, job->conn_id);
+	if (!c || job->job.is_cancelled) {
+		s_job_free(job);
+		return;
+	}
+
+	size_t reply_ofs = c->send.len;
+	if (!s_reply_from_cache(c, &job->hm, route->cache_name,
+	                        route->cache_fields)) {
+		job->job.done = s_job_done;
+		if (s_job_admit(c, job))
+			return;
+	}
+	mg_resume(c);
+
+	int      status      = s_reply_status(&c->send, reply_ofs);
+	uint64_t duration_ns = mtr_now_ns() - job->start_ns;
+	mtr_request(&s_metrics, job->route, status, duration_ns);
+	if (s_log_access)
+		lgr_access(&s_log, job->hm.method, job->hm.uri, status,
+		           duration_ns, job->message.len,
+		           c->send.len - reply_ofs);
+	s_job_free(job);
+}
+
+/* = Batches = */
+static int
+s_batch_submit(struct mg_connection *c, struct mg_http_message *hm,
+               s_handler_t handler, int route, uint64_t start_ns)
+{
+	/* = Read the problems = */
+	int toklen;
+	int ofs = mg_json_get(hm->body.ptr, (int)hm->body.len, "$", &toklen);
+	if (ofs < 0 || hm->body.ptr[ofs] != '[') {
+		mg_http_reply(c, 400, "", "Please provide an array of problems.");
+		return 0;
+	}
+	struct mg_str array = mg_str_n(hm->body.ptr + ofs + 1, toklen - 1);
+	struct mg_str problems[BATCH_PROBLEMS_MAX];
+	size_t        problems_c = 0;
+	struct mg_str problem;
+	while (s_batch_next(&array, &problem) &&
+	       problems_c++ < BATCH_PROBLEMS_MAX)
+		problems[problems_c - 1] = problem;
+	if (problems_c > BATCH_PROBLEMS_MAX) {
+		mg_http_reply(c, 400, "",
+		              "At most %d problems are supported per batch.",
+		              BATCH_PROBLEMS_MAX);
+		return 0;
+	}
+
+	struct s_batch *batch = calloc(1, sizeof(struct s_batch));
+	batch->mgr            = c->mgr;
+	batch->conn_id        = c->id;
+	batch->route          = route;
+	batch->start_ns       = start_ns;
+	batch->method         = mg_strdup(hm->method);
+	batch->uri            = mg_strdup(hm->uri);
+	batch->bytes_in       = hm->message.len;
+	batch->results        = calloc(problems_c, sizeof(struct mg_iobuf));
+	batch->results_c      = problems_c;
+
+	/* Compressed unless asked not to, as the size of the reply isn't known
+	 * yet. */
+	enum ast_enc_t enc = s_encoding(hm, COMPRESS_SIZE_MIN);
+	if (enc != AST_IDENTITY &&
+	    !(batch->dfl = dfl_new(COMPRESS_LEVEL,
+	                           enc == AST_GZIP ? DFL_GZIP : DFL_ZLIB)))
+		enc = AST_IDENTITY;
+
+	size_t ofs_sent = c->send.len;
+	mg_printf(c, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+	             "Vary: Accept-Encoding\r\n%s%s%s"
+	             "Transfer-Encoding: chunked\r\n\r\n",
+	          enc ? "Content-Encoding: " : "", enc ? ast_enc_name(enc) : "",
+	          enc ? "\r\n" : "");
+	s_batch_write(batch, c, "[", 1, 0);
+	batch->bytes_out = c->send.len - ofs_sent;
+
+	/* = Solve each = */
+	/* The ones that can't be solved get their error right away, as if
+	 * replied to by a handler. */
+	for (size_t i = 0; i < problems_c; i++) {
+		struct mg_connection  error = { 0 };
+		const struct s_route *problem_route =
+			s_problem_route(&error, problems[i]);
+		uint64_t cost = s_cost(problems[i]);
+		if (!problem_route || !s_admit(&error, cost)) {
+			s_batch_result(batch, i, &error.send);
+			mg_iobuf_free(&error.send);
+			continue;
+		}
+
+		struct s_job *job =
+			s_problem_job(c, problems[i], problem_route, handler,
+		                      route);
+		/* Throughput over latency, however cheap. */
+		job->cost         = cost;
+		job->job.lane     = S_LANE_BULK;
+		job->job.done     = s_batch_done;
+		job->job.progress = NULL;
+		job->batch        = batch;
+		job->batch_i      = i;
+		batch->pending++;
+		wrk_submit(&((struct s_reactor *)c->mgr->userdata)->workers,
+		           &job->job);
+	}
+
+	/* Hold back the next request so the replies keep their order. */
+	c->is_full = 1;
+	s_batch_send(batch);
+
+	return 1;
+}
+
+static int
+s_batch_next(struct mg_str *array, struct mg_str *problem)
+{
+	/* Read as a value of its own, since 'mg_json_get' loses count of the
+	 * elements past an empty object. */
+	int toklen;
+	int ofs = mg_json_get(array->ptr, (int)array->len, "$", &toklen);
+	if (ofs < 0)
+		return 0;
+	*problem = mg_str_n(array->ptr + ofs, toklen);
+
+	size_t i = ofs + toklen;
+	while (i < array->len && isspace((unsigned char)array->ptr[i]))
+		i++;
+	if (i < array->len && array->ptr[i] == ',')
+		i++;
+	array->ptr += i;
+	array->len -= i;
+
+	return 1;
+}
+
+static void
+s_batch_result(struct s_batch *batch, size_t i, const struct mg_iobuf *reply)
+{
+	/* Separated from the previous one already. */
+	if (i)
+		mg_iobuf_add(&batch->results[i], 0, ",", 1, MG_IO_SIZE);
+	s_problem_result(&batch->results[i], reply);
+}
+
+static void
+s_batch_write(struct s_batch *batch, struct mg_connection *c, const void *buf,
+              size_t len, int is_last)
+{
+	if (!batch->dfl) {
+		mg_http_write_chunk(c, buf, len);
+		return;
+	}
+
+	/* Flushed so that each part can be read as soon as it arrives. */
+	dfl_write(batch->dfl, &batch->zchunk, buf, len,
+	          is_last ? DFL_FINISH : DFL_SYNC);
+	mg_http_write_chunk(c, (char *)batch->zchunk.buf, batch->zchunk.len);
+	batch->zchunk.len = 0;
+}
+
+static void
+s_batch_send(struct s_batch *batch)
+{
+	struct mg_connection *c = s_conn_find(batch->mgr, batch->conn_id);
+	if (!c)
+		__atomic_store_n(&batch->is_gone, 1, __ATOMIC_RELAXED);
+	size_t ofs_sent = c ? c->send.len : 0;
+
+	/* The results solved in order so far go in a chunk together. */
+	struct mg_iobuf chunk = { 0 };
+	for (; batch->sent < batch->results_c &&
+	       batch->results[batch->sent].len;
+	     batch->sent++) {
+		struct mg_iobuf *result = &batch->results[batch->sent];
+		if (c)
+			mg_iobuf_add(&chunk, chunk.len, result->buf,
+			             result->len, MG_IO_SIZE);
+		mg_iobuf_free(result);
+	}
+	int is_all = !batch->pending && batch->sent == batch->results_c;
+	if (is_all)
+		mg_iobuf_add(&chunk, chunk.len, "]", 1, MG_IO_SIZE);
+	if (c && chunk.len)
+		s_batch_write(batch, c, chunk.buf, chunk.len, is_all);
+	mg_iobuf_free(&chunk);
+	if (!is_all) {
+		batch->bytes_out += c ? c->send.len - ofs_sent : 0;
+		return;
+	}
+
+	/* = All sent = */
+	if (c) {
+		mg_http_write_chunk(c, "", 0);
+		mg_resume(c);
+		batch->bytes_out += c->send.len - ofs_sent;
+	}
+
+	uint64_t duration_ns = mtr_now_ns() - batch->start_ns;
+	mtr_request(&s_metrics, batch->route, 200, duration_ns);
+	if (s_log_access)
+		lgr_access(&s_log, batch->method, batch->uri, 200, duration_ns,
+		           batch->bytes_in, batch->bytes_out);
+
+	dfl_free(batch->dfl);
+	mg_iobuf_free(&batch->zchunk);
+	free((void *)batch->method.ptr);
+	free((void *)batch->uri.ptr);
+	free(batch->results);
+	free(batch);
+}
+
+static void
+s_batch_done(void *arg)
+{
+	struct s_job   *job   = arg;
+	struct s_batch *batch = job->batch;
+
+	if (job->job.is_cancelled)
+		mg_http_reply(&job->out, 503, "", "The server is shutting down.");
+	s_batch_result(batch, job->batch_i, &job->out.send);
+	batch->pending--;
+	s_job_count_done(job);
+	s_job_free(job);
+
+	s_batch_send(batch);
+}
+
+/* = WebSockets = */
+static void
+s_handler_c_st_nm_1_ws(struct mg_connection *c, struct mg_http_message *hm)
+{
+	mg_ws_upgrade(c, hm, NULL);
+}
+
+static void
+s_ws_message(struct mg_connection *c, struct mg_ws_message *wm)
+{
+	if ((wm->flags & 15) != WEBSOCKET_OP_TEXT)
+		return;
+
+	bool is_cancel = false;
+	if (mg_json_get_bool(wm->data, "$.cancel", &is_cancel) && is_cancel) {
+		s_ws_cancel(c);
+		return;
+	}
+
+	/* Replied to in order, one at a time. */
+	struct mg_connection error = { 0 };
+	if (c->fn_data)
+		mg_http_reply(&error, 409, "",
+		              "Please wait for the problem being solved, or "
+		              "cancel it.");
+	const struct s_route *problem_route =
+		error.send.len ? NULL : s_problem_route(&error, wm->data);
+	uint64_t cost = s_cost(wm->data);
+	if (!problem_route || !s_admit(&error, cost)) {
+		s_ws_reply(c, &error.send);
+		mg_iobuf_free(&error.send);
+		return;
+	}
+
+	struct s_job *job =
+		s_problem_job(c, wm->data, problem_route, s_problem_solve,
+	                      s_metrics_ws);
+	job->cost     = cost;
+	job->job.lane = s_lane(cost);
+	job->job.done = s_ws_done;
+	job->is_ws    = 1;
+	c->fn_data    = job;
+	wrk_submit(&((struct s_reactor *)c->mgr->userdata)->workers,
+	           &job->job);
+}
+
+static void
+s_ws_cancel(struct mg_connection *c)
+{
+	/* Stops at the next rows sent, see 's_stream_flush'. */
+	s_job_wake(c, 1);
+}
+
+static void
+s_ws_reply(struct mg_connection *c, const struct mg_iobuf *reply)
+{
+	struct mg_iobuf result = { 0 };
+	s_problem_result(&result, reply);
+	mg_ws_send(c, (char *)result.buf, result.len, WEBSOCKET_OP_TEXT);
+	mg_iobuf_free(&result);
+}
+
+static void
+s_ws_end(struct mg_connection *c, const char *session_id, int is_cancelled,
+         const char *budget)
+{
+	struct mg_iobuf io = { 0 };
+	struct jw       w;
+	jw_init(&w, &io);
+	jw_object_begin(&w);
+	jw_key(&w, "status");
+	jw_int(&w, 200);
+	if (session_id) {
+		jw_key(&w, "session_id");
+		jw_str(&w, session_id, strlen(session_id));
+	}
+	if (is_cancelled) {
+		jw_key(&w, "cancelled");
+		jw_raw(&w, "true", 4);
+	}
+	if (budget) {
+		jw_key(&w, "budget_exceeded");
+		jw_str(&w, budget, strlen(budget));
+	}
+	jw_object_end(&w);
+
+	mg_ws_send(c, (char *)io.buf, io.len, WEBSOCKET_OP_TEXT);
+	mg_iobuf_free(&io);
+}
+
+static void
+s_ws_done(void *arg)
+{
+	struct s_job *job = arg;
+
+	if (job->job.is_cancelled)
+		mg_http_reply(&job->out, 503, "", "The server is shutting down.");
+	if (!job->status)
+		job->status = s_reply_status(&job->out.send, 0);
+
+	/* Either a reply to turn into a frame, the frames left of the rows, or
+	 * nothing if cancelled before it started. */
+	struct mg_connection *c = s_conn_find(job->mgr, job->conn_id);
+	if (c && job->is_stalled) {
+		mg_error(c, "stalled reading the replies");
+		c->fn_data = NULL;
+	} else if (c) {
+		/* The frames of the rows no progress call got to. */
+		mg_send(c, job->stream.buf, job->stream.len);
+		if (s_reply_status(&job->out.send, 0))
+			s_ws_reply(c, &job->out.send);
+		else if (job->out.send.len)
+			mg_send(c, job->out.send.buf, job->out.send.len);
+		else
+			s_ws_end(c, NULL, 1, NULL);
+		c->fn_data = NULL;
+	}
+
+	mtr_request(&s_metrics, job->route, job->status,
+	            mtr_now_ns() - job->start_ns);
+	s_job_count_done(job);
+	s_job_free(job);
+}
 
+/* = Sessions = */
+static size_t
+s_session_size(size_t data_size, char *input_expr);
 /*
- ===============================================================================
- |                            Function Declarations                            |
- ===============================================================================
+ * Estimate the memory held by a session of `data_size` bytes including the
+ * compiled `input_expr`.
  */
-/* = Core = */
-static void
-s_handler_fn(struct mg_connection *c, int ev, void *ev_data, void *fn_data);
-/* Main server handler. */
 
-static int
-s_hm_get_data(struct mg_connection *c, JsonNode *hm_body, char *key, char *info,
-              unsigned int type, unsigned int is_required, void *data);
-/*
- * Search and get the `key` from the `hm_body` into `data`.
- *
- * `type` includes: 0 for string, 1 for float, 2 for double, 3 for int, 4 for
- * bool.
- *
- * If the key is required but isn't found, a 400 response will be given asking
- * to provide the key written as the `info`.
- */
+static void
+s_session_expire_fn(void *arg);
+/* Timer function to expire the idle sessions. */
 
-void
-print_help_exit(FILE *stream, int exit_code);
-/*
- * Print help to the given `stream` and exit the program with the given
- * `exit_code`.
- */
+static void
+s_bs_session_free(void *data);
 
 static void
-signal_handler(int signo);
+s_sct_session_free(void *data);
 
 /* = Server components = */
 /*
@@ -76,14 +2307,84 @@ static void
 s_handler_c_st_nm_1_bisection(struct mg_connection   *c,
                               struct mg_http_message *hm);
 
+static void
+s_bs_stream(struct s_stream *st, struct s_bs_session *bs_sess, int iterations);
+/*
+ * Do at most `iterations` more iterations of the bisection in `bs_sess`,
+ * writing each to the stream as they're done.
+ */
+
+static void
+s_bs_columns(struct s_stream *st, const struct bs_output *bs_o, int bs_o_c,
+             int n);
+/*
+ * Write the `bs_o_c` rows of `bs_o`, the first being the `n`th iteration, to
+ * the CBOR stream as a map of columns: the "n" of each, a typed array per float
+ * and a string of '+' and '-' per sign.
+ */
+
+static void
+s_handler_c_st_nm_1_bisection_continue(struct mg_connection   *c,
+                                       struct mg_http_message *hm,
+                                       struct mg_str           session_id);
+/* Continue the bisection kept under the given session. */
+
 static void
 s_handler_c_st_nm_1_secant(struct mg_connection *c, struct mg_http_message *hm);
 
+static void
+s_sct_stream(struct s_stream *st, struct s_sct_session *sct_sess,
+             int iterations);
+/* Same as 's_bs_stream' but for the secant. */
+
+static void
+s_sct_columns(struct s_stream *st, const struct sct_output *sct_o,
+              int sct_o_c, int n);
+/* Same as 's_bs_columns' but for the secant. */
+
+static void
+s_handler_c_st_nm_1_secant_continue(struct mg_connection   *c,
+                                    struct mg_http_message *hm,
+                                    struct mg_str           session_id);
+/* Continue the secant kept under the given session. */
+
+static void
+s_handler_c_st_nm_1_horner_roots(struct mg_connection   *c,
+                                 struct mg_http_message *hm);
+
+static void
+s_handler_c_st_nm_1_continuation(struct mg_connection   *c,
+                                 struct mg_http_message *hm);
+
 /*
  ===============================================================================
  |                          Function Implementations                           |
  ===============================================================================
  */
+/* = Routes = */
+static const struct s_route s_routes[] = {
+	/* = Study Tools = */
+	{ "POST", URI_STUDY_TOOLS "/nm/1-non-linear-eqn/1-bisection",
+	  s_handler_c_st_nm_1_bisection, S_RUN_WORKER, "bisection",
+	  s_bs_cache_fields },
+	{ "POST", URI_STUDY_TOOLS "/nm/1-non-linear-eqn/2-secant",
+	  s_handler_c_st_nm_1_secant, S_RUN_WORKER, "secant",
+	  s_sct_cache_fields },
+	{ "POST", URI_STUDY_TOOLS "/nm/1-non-linear-eqn/4-horner-roots",
+	  s_handler_c_st_nm_1_horner_roots, S_RUN_WORKER, NULL, NULL },
+	{ "POST", URI_STUDY_TOOLS "/nm/1-non-linear-eqn/6-continuation",
+	  s_handler_c_st_nm_1_continuation, S_RUN_WORKER, NULL, NULL },
+	{ "POST", URI_STUDY_TOOLS "/nm/1-non-linear-eqn/batch", s_problem_solve,
+	  S_RUN_BATCH, NULL, NULL },
+	{ "GET", URI_STUDY_TOOLS "/nm/1-non-linear-eqn/ws", s_handler_c_st_nm_1_ws,
+	  S_RUN_LOOP, NULL, NULL },
+
+	/* = Server = */
+	{ "GET", URI_SERVER "/cache", s_handler_server_cache, S_RUN_LOOP, NULL,
+	  NULL },
+	{ "GET", URI_METRICS, s_handler_metrics, S_RUN_LOOP, NULL, NULL },
+};
+
 /* = Core = */
 static void
 s_handler_fn(struct mg_connection *c, int ev, void *ev_data, void *fn_data)
@@ -92,66 +2393,180 @@ s_handler_fn(struct mg_connection *c, int ev, void *ev_data, void *fn_data)
 
 	(void)fn_data;
 
-	if (ev != MG_EV_HTTP_MSG)
+	switch (ev) {
+	case MG_EV_ACCEPT:
+		mtr_conns(&s_metrics, 1);
+		return;
+	case MG_EV_CLOSE:
+		if (c->is_accepted)
+			mtr_conns(&s_metrics, -1);
+		/* Stops the job replying, if any, even while it waits. */
+		s_job_wake(c, 1);
 		return;
+	case MG_EV_READ:
+		mtr_bytes(&s_metrics, ((struct mg_str *)ev_data)->len, 0);
+		return;
+	case MG_EV_WRITE:
+		mtr_bytes(&s_metrics, 0, *(long *)ev_data);
+		s_job_wake(c, 0);
+		return;
+	case MG_EV_WS_MSG:
+		s_ws_message(c, ev_data);
+		return;
+	case MG_EV_HTTP_MSG:
+		break;
+	default:
+		return;
+	}
 
 	hm = (struct mg_http_message *)ev_data;
-	/* = Study Tools = */
-	if (mg_http_match_uri(hm, URI_STUDY_TOOLS
-	                      "/nm/1-non-linear-eqn/1-bisection")) {
-		if (strncmp(hm->method.ptr, "POST", 4) == 0)
-			s_handler_c_st_nm_1_bisection(c, hm);
 
-		mg_http_reply(c, 400, "",
-		              "This uri supports only POST method.");
+	/* Timed till the reply is written, the jobs count theirs once done. */
+	uint64_t start_ns      = mtr_now_ns();
+	size_t   reply_ofs     = c->send.len;
+	int      metrics_route = s_metrics_other;
 
-		return;
+	const void *route_data;
+	char        allow[RTR_ALLOW_MAX];
+	switch (rtr_find(&s_router, hm->method, hm->uri, &route_data, allow)) {
+	case RTR_FOUND: {
+		const struct s_route *route = route_data;
+		metrics_route               = (int)(route - s_routes);
+		if (route->cache_name &&
+		    s_reply_from_cache(c, hm, route->cache_name,
+		                       route->cache_fields))
+			break;
+		switch (route->run) {
+		case S_RUN_LOOP:
+			route->handler(c, hm);
+			break;
+		case S_RUN_WORKER: {
+			struct s_job *job = s_job_request(c, hm, route->handler,
+			                                  metrics_route,
+			                                  start_ns);
+			if (route->cache_name ? s_flight_submit(c, job, route)
+			                      : s_job_admit(c, job))
+				return;
+			s_job_free(job);
+			break;
+		}
+		case S_RUN_BATCH:
+			if (s_batch_submit(c, hm, route->handler, metrics_route,
+			                   start_ns))
+				return;
+			break;
+		}
+		break;
+	}
+	case RTR_NO_METHOD: {
+		char headers[16 + RTR_ALLOW_MAX];
+		mg_snprintf(headers, sizeof(headers), "Allow: %s\r\n", allow);
+		mg_http_reply(c, 405, headers,
+		              "This uri supports only %s method.", allow);
+		break;
+	}
+	case RTR_NO_PATH:
+		/* = Home page = */
+		metrics_route = s_metrics_assets;
+		s_reply_asset(c, hm);
+		break;
 	}
-	if (mg_http_match_uri(hm, URI_STUDY_TOOLS
-	                      "/nm/1-non-linear-eqn/2-secant")) {
-		if (strncmp(hm->method.ptr, "POST", 4) == 0)
-			s_handler_c_st_nm_1_secant(c, hm);
 
-		mg_http_reply(c, 400, "",
-		              "This uri supports only POST method.");
+	int      status      = s_reply_status(&c->send, reply_ofs);
+	uint64_t duration_ns = mtr_now_ns() - start_ns;
+	mtr_request(&s_metrics, metrics_route, status, duration_ns);
+	/* Files sent from disk only count their headers. */
+	if (s_log_access)
+		lgr_access(&s_log, hm->method, hm->uri, status, duration_ns,
+		           hm->message.len, c->send.len - reply_ofs);
+}
 
-		return;
+static void
+s_routes_init(void)
+{
+	rtr_init(&s_router);
+	mtr_init(&s_metrics);
+	for (size_t i = 0; i < sizeof(s_routes) / sizeof(s_routes[0]); i++) {
+		if (!rtr_add(&s_router, s_routes[i].method, s_routes[i].path,
+		             &s_routes[i]))
+			MG_ERROR(("Duplicate route %s %s", s_routes[i].method,
+			          s_routes[i].path));
+		mtr_route(&s_metrics, s_routes[i].path);
 	}
-
-	/* = Home page = */
-	struct mg_http_serve_opts opts = { .root_dir = "res/",
-		                           .page404  = "res/404.html" };
-	mg_http_serve_dir(c, hm, &opts);
+	s_metrics_assets = mtr_route(&s_metrics, "static");
+	s_metrics_other  = mtr_route(&s_metrics, "other");
+	s_metrics_ws     = mtr_route(&s_metrics, "websocket");
+	/* Added under their 'enum s_phase'. */
+	for (int i = 0; i < S_PHASE_C; i++)
+		mtr_phase(&s_metrics, s_phase_names[i]);
 }
 
 static int
-s_hm_get_data(struct mg_connection *c, JsonNode *hm_body, char *key, char *info,
-              unsigned int type, unsigned int is_required, void *data)
+s_hm_get_fields(struct mg_connection *c, struct mg_str body,
+                const struct s_field *fields)
 {
-	JsonNode *hm_body_member = json_find_member(hm_body, key);
-	if (!hm_body_member && is_required) {
-		mg_http_reply(c, 400, "", "Please provide the %s.", info);
-		return 0;
+	for (; fields->path; fields++) {
+		int toklen;
+		int ofs = mg_json_get(body.ptr, (int)body.len, fields->path,
+		                      &toklen);
+		if (ofs < 0 && !fields->is_required)
+			continue; /* optional, keep the default in `data` */
+
+		const char *tok = body.ptr + ofs;
+		int         is_valid;
+		switch (fields->type) {
+		case 's':
+			if ((is_valid = ofs >= 0 && *tok == '"'))
+				*(struct mg_str *)fields->data =
+					mg_str_n(tok + 1, toklen - 2);
+			break;
+		case 'f':
+		case 'i':
+			if (!(is_valid = ofs >= 0 &&
+			                 (*tok == '-' ||
+			                  isdigit((unsigned char)*tok))))
+				break;
+
+			/* Out of the range of the type, it can't be read. */
+			double num = mg_atod(tok, toklen, NULL);
+			if (fields->type == 'f') {
+				if ((is_valid = num >= -FLT_MAX &&
+				                num <= FLT_MAX))
+					*(float *)fields->data = num;
+			} else {
+				if ((is_valid = num > INT_MIN - 1.0 &&
+				                num < INT_MAX + 1.0))
+					*(int *)fields->data = num;
+			}
+			break;
+		case 'b':
+			if ((is_valid = ofs >= 0 && (*tok == 't' || *tok == 'f')))
+				*(bool *)fields->data = *tok == 't';
+			break;
+		default:
+			is_valid = 0;
+			break;
+		}
+
+		if (!is_valid) {
+			mg_http_reply(c, 400, "", "Please provide the %s.",
+			              fields->info);
+			return 0;
+		}
 	}
 
-	switch (type) {
-	case 0:
-		strcpy((char *)data, hm_body_member->string_);
-		break;
-	case 1:
-		*((float *)data) = hm_body_member->number_;
-		break;
-	case 2:
-		*((double *)data) = hm_body_member->number_;
-		break;
-	case 3:
-		*((int *)data) = hm_body_member->number_;
-		break;
-	case 4:
-		*((bool *)data) = hm_body_member->bool_;
-		break;
-	default:
-		break;
+	return 1;
+}
+
+static int
+s_hm_get_expr(struct mg_connection *c, struct mg_str str, char *expr)
+{
+	if (!mg_json_unescape(str.ptr, str.len, expr, S_EXPR_MAX)) {
+		mg_http_reply(c, 400, "",
+		              "The input expression should be shorter than %d "
+		              "characters.",
+		              S_EXPR_MAX);
+		return 0;
 	}
 
 	return 1;
@@ -172,225 +2587,773 @@ signal_handler(int signo)
 	s_signo = signo;
 }
 
+static void *
+s_reactor_run(void *arg)
+{
+	struct s_reactor *reactor = arg;
+
+	while (s_signo == 0)
+		mg_mgr_poll(&reactor->mgr, 1000);
+
+	return NULL;
+}
+
+static void
+s_reply_expr_error(struct mg_connection *c, int expr_err_loc)
+{
+	char      buf[64];
+	struct jw w;
+	jw_init_buf(&w, buf, sizeof(buf));
+	jw_object_begin(&w);
+	jw_key(&w, "message");
+	jw_str(&w, "Error in the expression", 23);
+	jw_key(&w, "position");
+	jw_int(&w, expr_err_loc);
+	jw_object_end(&w);
+
+	mg_http_reply(c, 400, "Content-Type: application/json\r\n", "%.*s",
+	              (int)w.len, buf);
+}
+
+/* = Sessions = */
+static size_t
+s_session_size(size_t data_size, char *input_expr)
+{
+	/* tinyexpr allocates at most a node per character of the expression. */
+	return data_size + strlen(input_expr) * (sizeof(te_expr) +
+	                                         2 * sizeof(void *));
+}
+
+static void
+s_session_expire_fn(void *arg)
+{
+	pthread_mutex_lock(&s_sessions_lock);
+	sess_expire((struct sess_store *)arg);
+	pthread_mutex_unlock(&s_sessions_lock);
+}
+
+static void
+s_bs_session_free(void *data)
+{
+	struct s_bs_session *bs_sess = data;
+
+	bs_instance_free(&bs_sess->bs_instance);
+	free(bs_sess);
+}
+
+static void
+s_sct_session_free(void *data)
+{
+	struct s_sct_session *sct_sess = data;
+
+	sct_instance_free(&sct_sess->sct_instance);
+	free(sct_sess);
+}
+
 /* = Server components = */
+static void
+s_bs_stream(struct s_stream *st, struct s_bs_session *bs_sess, int iterations)
+{
+	/* A new session counts the evaluations checking its interval too. */
+	unsigned long evals =
+		bs_sess->iterations_done ? bs_sess->bs_instance.fn_evals : 0;
+
+	/* Computed a few rows at a time so that they can be sent meanwhile. */
+	int done = 0;
+	while (done < iterations) {
+		int block = iterations - done < STREAM_ROWS ? iterations - done
+		                                            : STREAM_ROWS;
+
+		int               bs_o_c;
+		struct bs_output *bs_o =
+			bs_continue(&bs_sess->bs_instance, &bs_sess->bs_state,
+		                    bs_sess->bs_p, bs_sess->precision, block,
+		                    &bs_o_c);
+		s_timing_mark(st->c, S_PHASE_SOLVE);
+		if (st->is_cbor) {
+			s_bs_columns(st, bs_o, bs_o_c,
+			             bs_sess->iterations_done + 1);
+		} else {
+			for (int i = 0; i < bs_o_c; i++) {
+				jw_object_begin(&st->w);
+				jw_key(&st->w, "n");
+				jw_int(&st->w,
+				       bs_sess->iterations_done + i + 1);
+				jw_key(&st->w, "a");
+				jw_float(&st->w, bs_o[i].a);
+				jw_key(&st->w, "fn_a");
+				jw_str(&st->w, &bs_o[i].fn_a_sign, 1);
+				jw_key(&st->w, "b");
+				jw_float(&st->w, bs_o[i].b);
+				jw_key(&st->w, "fn_b");
+				jw_str(&st->w, &bs_o[i].fn_b_sign, 1);
+				jw_key(&st->w, "c");
+				jw_float(&st->w, bs_o[i].c);
+				jw_key(&st->w, "fn_c");
+				jw_str(&st->w, &bs_o[i].fn_c_sign, 1);
+				jw_object_end(&st->w);
+				s_stream_row(st);
+			}
+		}
+		free(bs_o);
+		bs_sess->iterations_done += bs_o_c;
+		done += bs_o_c;
+
+		if (bs_o_c < block || !s_stream_flush(st) ||
+		    (st->budget = s_job_budget(st->c,
+		                               bs_sess->bs_instance.fn_evals -
+		                                       evals)))
+			break;
+	}
+
+	s_job_count(st->c, done, bs_sess->bs_instance.fn_evals - evals);
+}
+
+static void
+s_bs_columns(struct s_stream *st, const struct bs_output *bs_o, int bs_o_c,
+             int n)
+{
+	if (!bs_o_c)
+		return;
+
+	struct cw w;
+	cw_init(&w, &st->chunk);
+	cw_map(&w, 7);
+	cw_text(&w, "n", 1);
+	cw_array(&w, bs_o_c);
+	for (int i = 0; i < bs_o_c; i++)
+		cw_uint(&w, n + i);
+
+	char signs[STREAM_ROWS];
+	cw_text(&w, "a", 1);
+	cw_floats(&w, &bs_o->a, bs_o_c, sizeof(*bs_o));
+	for (int i = 0; i < bs_o_c; i++)
+		signs[i] = bs_o[i].fn_a_sign;
+	cw_text(&w, "fn_a", 4);
+	cw_text(&w, signs, bs_o_c);
+	cw_text(&w, "b", 1);
+	cw_floats(&w, &bs_o->b, bs_o_c, sizeof(*bs_o));
+	for (int i = 0; i < bs_o_c; i++)
+		signs[i] = bs_o[i].fn_b_sign;
+	cw_text(&w, "fn_b", 4);
+	cw_text(&w, signs, bs_o_c);
+	cw_text(&w, "c", 1);
+	cw_floats(&w, &bs_o->c, bs_o_c, sizeof(*bs_o));
+	for (int i = 0; i < bs_o_c; i++)
+		signs[i] = bs_o[i].fn_c_sign;
+	cw_text(&w, "fn_c", 4);
+	cw_text(&w, signs, bs_o_c);
+}
+
+static void
+s_sct_stream(struct s_stream *st, struct s_sct_session *sct_sess,
+             int iterations)
+{
+	unsigned long evals = sct_sess->sct_instance.fn_evals;
+
+	int done = 0;
+	while (done < iterations) {
+		int block = iterations - done < STREAM_ROWS ? iterations - done
+		                                            : STREAM_ROWS;
+
+		int                sct_o_c;
+		struct sct_output *sct_o =
+			sct_continue(&sct_sess->sct_instance, &sct_sess->sct_state,
+		                     sct_sess->sct_p, sct_sess->precision, block,
+		                     &sct_o_c);
+		s_timing_mark(st->c, S_PHASE_SOLVE);
+		if (st->is_cbor) {
+			s_sct_columns(st, sct_o, sct_o_c,
+			              sct_sess->iterations_done + 1);
+		} else {
+			for (int i = 0; i < sct_o_c; i++) {
+				jw_object_begin(&st->w);
+				jw_key(&st->w, "n");
+				jw_int(&st->w,
+				       sct_sess->iterations_done + i + 1);
+				jw_key(&st->w, "x0");
+				jw_float(&st->w, sct_o[i].x0);
+				jw_key(&st->w, "fn_x0");
+				jw_float(&st->w, sct_o[i].fn_x0);
+				jw_key(&st->w, "x1");
+				jw_float(&st->w, sct_o[i].x1);
+				jw_key(&st->w, "fn_x1");
+				jw_float(&st->w, sct_o[i].fn_x1);
+				jw_key(&st->w, "x2");
+				jw_float(&st->w, sct_o[i].x2);
+				jw_key(&st->w, "fn_x2");
+				jw_float(&st->w, sct_o[i].fn_x2);
+				jw_object_end(&st->w);
+				s_stream_row(st);
+			}
+		}
+		free(sct_o);
+		sct_sess->iterations_done += sct_o_c;
+		done += sct_o_c;
+
+		if (sct_o_c < block || !s_stream_flush(st) ||
+		    (st->budget = s_job_budget(st->c,
+		                               sct_sess->sct_instance.fn_evals -
+		                                       evals)))
+			break;
+	}
+
+	s_job_count(st->c, done, sct_sess->sct_instance.fn_evals - evals);
+}
+
+static void
+s_sct_columns(struct s_stream *st, const struct sct_output *sct_o,
+              int sct_o_c, int n)
+{
+	if (!sct_o_c)
+		return;
+
+	struct cw w;
+	cw_init(&w, &st->chunk);
+	cw_map(&w, 7);
+	cw_text(&w, "n", 1);
+	cw_array(&w, sct_o_c);
+	for (int i = 0; i < sct_o_c; i++)
+		cw_uint(&w, n + i);
+
+	cw_text(&w, "x0", 2);
+	cw_floats(&w, &sct_o->x0, sct_o_c, sizeof(*sct_o));
+	cw_text(&w, "fn_x0", 5);
+	cw_floats(&w, &sct_o->fn_x0, sct_o_c, sizeof(*sct_o));
+	cw_text(&w, "x1", 2);
+	cw_floats(&w, &sct_o->x1, sct_o_c, sizeof(*sct_o));
+	cw_text(&w, "fn_x1", 5);
+	cw_floats(&w, &sct_o->fn_x1, sct_o_c, sizeof(*sct_o));
+	cw_text(&w, "x2", 2);
+	cw_floats(&w, &sct_o->x2, sct_o_c, sizeof(*sct_o));
+	cw_text(&w, "fn_x2", 5);
+	cw_floats(&w, &sct_o->fn_x2, sct_o_c, sizeof(*sct_o));
+}
+
 static void
 s_handler_c_st_nm_1_bisection(struct mg_connection   *c,
                               struct mg_http_message *hm)
 {
+	/* = Cache key = */
+	/* The lookup is done on the event loop before the job is queued. */
+	char   cache_key[S_CACHE_KEY_MAX];
+	size_t cache_key_len = s_cache_key(hm->body, "bisection", s_bs_cache_fields,
+	                                   cache_key, sizeof(cache_key));
+
 	/* = Read the inputs = */
-	JsonNode *hm_body = json_decode(hm->body.ptr);
-	/* input_expr */
-	char input_expr[512];
-	if (!s_hm_get_data(c, hm_body, "input_expr", "input expression", 0, 1,
-	                   &input_expr))
-		return;
-	/* intervals */
-	float interval_lower = 3;
-	if (!s_hm_get_data(c, hm_body, "interval_lower", "lower interval", 1, 1,
-	                   &interval_lower))
-		return;
-	float interval_upper;
-	if (!s_hm_get_data(c, hm_body, "interval_upper", "upper interval", 1, 1,
-	                   &interval_upper))
-		return;
-	/* process */
-	enum bs_process_t bs_p;
-	if (!s_hm_get_data(c, hm_body, "bs_p", "bisection process", 3, 1,
-	                   &bs_p))
+	/* session to continue */
+	struct mg_str  session_id;
+	struct s_field session_field[] = {
+		{ "$.session_id", "session id", 's', 0, &session_id },
+		{ NULL, NULL, 0, 0, NULL },
+	};
+	session_id.len = 0;
+	if (!s_hm_get_fields(c, hm->body, session_field))
+		return;
+	if (session_id.len) {
+		s_handler_c_st_nm_1_bisection_continue(c, hm, session_id);
 		return;
-	/* precision */
-	int precision;
-	if (!s_hm_get_data(c, hm_body, "precision", "precision", 3, 1,
-	                   &precision))
+	}
+	struct mg_str     input_expr;
+	float             interval_lower, interval_upper;
+	enum bs_process_t bs_p;
+	int               precision, iterations;
+	bool              to_keep_session = false;
+	struct s_field    fields[]        = {
+		{ "$.input_expr", "input expression", 's', 1, &input_expr },
+		{ "$.interval_lower", "lower interval", 'f', 1, &interval_lower },
+		{ "$.interval_upper", "upper interval", 'f', 1, &interval_upper },
+		{ "$.bs_p", "bisection process", 'i', 1, &bs_p },
+		{ "$.precision", "precision", 'i', 1, &precision },
+		{ "$.iterations", "iterations", 'i', 1, &iterations },
+		{ "$.session", "session", 'b', 0, &to_keep_session },
+		{ NULL, NULL, 0, 0, NULL },
+	};
+	if (!s_hm_get_fields(c, hm->body, fields))
 		return;
-	/* iterations */
-	int iterations;
-	if (!s_hm_get_data(c, hm_body, "iterations", "iterations", 3, 1,
-	                   &iterations))
+	char expr[S_EXPR_MAX];
+	if (!s_hm_get_expr(c, input_expr, expr))
 		return;
-	/* cleanup */
-	json_delete(hm_body);
+	s_timing_mark(c, S_PHASE_PARSE);
 
 	/* = Main process = */
-	struct bs_t bs_instance;
-	int         expr_err_loc = bs_init(&bs_instance, input_expr);
+	/* The compiled expression points into the instance, so a kept session
+	 * needs the instance to be in its final place before compiling. */
+	struct s_bs_session  bs_sess_local;
+	struct s_bs_session *bs_sess = &bs_sess_local;
+	if (to_keep_session)
+		bs_sess = malloc(sizeof(struct s_bs_session));
+
+	int expr_err_loc = bs_init(&bs_sess->bs_instance, expr);
 	if (expr_err_loc != 0) {
 		/* error in the expression */
-		JsonNode *position_error_json = json_mkobject();
-		json_append_member(position_error_json, "message",
-		                   json_mkstring("Error in the expression"));
-		json_append_member(position_error_json, "position",
-		                   json_mknumber(expr_err_loc));
-		char *position_error_json_str =
-			json_stringify(position_error_json, "\t");
-
-		mg_http_reply(c, 400, "Content-Type: application/json\r\n",
-		              position_error_json_str);
-
-		json_delete(position_error_json);
-		free(position_error_json_str);
+		s_reply_expr_error(c, expr_err_loc);
+		if (to_keep_session)
+			free(bs_sess);
+		return;
+	}
+	if (!bs_are_valid_points(&bs_sess->bs_instance, interval_lower,
+	                         interval_upper)) {
+		mg_http_reply(c, 400, "", "Invalid intervals.");
+		bs_instance_free(&bs_sess->bs_instance);
+		if (to_keep_session)
+			free(bs_sess);
 		return;
 	}
+	bs_state_init(&bs_sess->bs_state, interval_lower, interval_upper);
+	bs_sess->bs_p            = bs_p;
+	bs_sess->precision       = precision;
+	bs_sess->iterations_done = 0;
+	s_timing_mark(c, S_PHASE_COMPILE);
 
-	int               bs_o_c;
-	struct bs_output *bs_o =
-		bs_execute(&bs_instance, interval_lower, interval_upper, bs_p,
-	                   precision, iterations, &bs_o_c);
-	if (bs_o == NULL) {
-		fprintf(stderr, "Invalid intervals\n");
-		exit(EXIT_FAILURE);
+	/* = Keep the session = */
+	/* Kept before the iterations as its id goes in the headers. The entry
+	 * stays referenced till the reply is done. */
+	struct sess_entry *sess = NULL;
+	if (to_keep_session) {
+		pthread_mutex_lock(&s_sessions_lock);
+		sess = sess_create(&s_sessions, S_SESS_BISECTION, bs_sess,
+		                   s_session_size(sizeof(struct s_bs_session),
+		                                  expr),
+		                   s_bs_session_free);
+		pthread_mutex_unlock(&s_sessions_lock);
+		if (!sess) {
+			/* the cap is taken by sessions being continued */
+			s_bs_session_free(bs_sess);
+			mg_http_reply(c, 503, "",
+			              "There is no room for another session.");
+			return;
+		}
 	}
 
-	/* = Prepare output = */
-	/* create JSON for the output */
-	JsonNode *bs_o_json = json_mkarray();
-
-	/* fill json string */
-	for (int i = 0; i < bs_o_c; i++) {
-		JsonNode *bs_item_json = json_mkobject();
-
-		/* prepare object */
-		char sign[2] = "\0";
-		json_append_member(bs_item_json, "n", json_mknumber(i + 1));
-		json_append_member(bs_item_json, "a", json_mknumber(bs_o[i].a));
-		sign[0] = bs_o[i].fn_a_sign;
-		json_append_member(bs_item_json, "fn_a", json_mkstring(sign));
-		json_append_member(bs_item_json, "b", json_mknumber(bs_o[i].b));
-		sign[0] = bs_o[i].fn_b_sign;
-		json_append_member(bs_item_json, "fn_b", json_mkstring(sign));
-		json_append_member(bs_item_json, "c", json_mknumber(bs_o[i].c));
-		sign[0] = bs_o[i].fn_c_sign;
-		json_append_member(bs_item_json, "fn_c", json_mkstring(sign));
-
-		/* append the object to the array */
-		json_append_element(bs_o_json, bs_item_json);
-	}
-	char *bs_o_json_str = json_stringify(bs_o_json, "\t");
+	struct s_stream st;
+	s_stream_begin(&st, c, hm, sess ? sess->id : NULL,
+	               cache_key_len ? cache_key : NULL, cache_key_len);
+	s_bs_stream(&st, bs_sess, iterations);
+	s_stream_end(&st);
 
-	/* Reply with the JSON */
-	mg_http_reply(c, 200, "Content-Type: application/json\r\n",
-	              bs_o_json_str);
+	/* = Cleanup = */
+	if (sess) {
+		pthread_mutex_lock(&s_sessions_lock);
+		sess_release(&s_sessions, sess);
+		pthread_mutex_unlock(&s_sessions_lock);
+	} else {
+		bs_instance_free(&bs_sess->bs_instance);
+	}
+}
+
+static void
+s_handler_c_st_nm_1_bisection_continue(struct mg_connection   *c,
+                                       struct mg_http_message *hm,
+                                       struct mg_str           session_id)
+{
+	/* = Read the inputs = */
+	int            iterations;
+	struct s_field fields[] = {
+		{ "$.iterations", "iterations", 'i', 1, &iterations },
+		{ NULL, NULL, 0, 0, NULL },
+	};
+	if (!s_hm_get_fields(c, hm->body, fields))
+		return;
+
+	pthread_mutex_lock(&s_sessions_lock);
+	struct sess_entry *sess = sess_find(&s_sessions, session_id);
+	if (!sess || sess->type != S_SESS_BISECTION) {
+		if (sess)
+			sess_release(&s_sessions, sess);
+		pthread_mutex_unlock(&s_sessions_lock);
+		mg_http_reply(c, 404, "", "Session not found or expired.");
+		return;
+	}
+	if (sess->refs > 1) {
+		/* continued by another request right now */
+		sess_release(&s_sessions, sess);
+		pthread_mutex_unlock(&s_sessions_lock);
+		mg_http_reply(c, 409, "", "Session is busy.");
+		return;
+	}
+	pthread_mutex_unlock(&s_sessions_lock);
+	s_timing_mark(c, S_PHASE_PARSE);
+
+	/* = Main process = */
+	struct s_stream st;
+	s_stream_begin(&st, c, hm, sess->id, NULL, 0);
+	s_bs_stream(&st, sess->data, iterations);
+	s_stream_end(&st);
 
 	/* = Cleanup = */
-	json_delete(bs_o_json);
-	free(bs_o_json_str);
-	bs_instance_free(&bs_instance);
-	free(bs_o);
+	pthread_mutex_lock(&s_sessions_lock);
+	sess_release(&s_sessions, sess);
+	pthread_mutex_unlock(&s_sessions_lock);
 }
 
 static void
 s_handler_c_st_nm_1_secant(struct mg_connection *c, struct mg_http_message *hm)
 {
+	/* = Cache key = */
+	/* The lookup is done on the event loop before the job is queued. */
+	char   cache_key[S_CACHE_KEY_MAX];
+	size_t cache_key_len = s_cache_key(hm->body, "secant", s_sct_cache_fields,
+	                                   cache_key, sizeof(cache_key));
+
 	/* = Read the inputs = */
-	JsonNode *hm_body = json_decode(hm->body.ptr);
-	/* input_expr */
-	char input_expr[512];
-	if (!s_hm_get_data(c, hm_body, "input_expr", "input expression", 0, 1,
-	                   &input_expr))
-		return;
-	/* intervals */
-	float interval_lower = 3;
-	if (!s_hm_get_data(c, hm_body, "interval_lower", "lower interval", 1, 1,
-	                   &interval_lower))
-		return;
-	float interval_upper;
-	if (!s_hm_get_data(c, hm_body, "interval_upper", "upper interval", 1, 1,
-	                   &interval_upper))
-		return;
-	/* process */
-	enum sct_process_t sct_p;
-	if (!s_hm_get_data(c, hm_body, "sct_p", "secant process", 3, 1,
-	                   &sct_p))
+	/* session to continue */
+	struct mg_str  session_id;
+	struct s_field session_field[] = {
+		{ "$.session_id", "session id", 's', 0, &session_id },
+		{ NULL, NULL, 0, 0, NULL },
+	};
+	session_id.len = 0;
+	if (!s_hm_get_fields(c, hm->body, session_field))
 		return;
-	/* precision */
-	int precision;
-	if (!s_hm_get_data(c, hm_body, "precision", "precision", 3, 1,
-	                   &precision))
+	if (session_id.len) {
+		s_handler_c_st_nm_1_secant_continue(c, hm, session_id);
+		return;
+	}
+	struct mg_str     input_expr;
+	float             interval_lower, interval_upper;
+	enum sct_process_t sct_p;
+	int               precision, iterations;
+	bool              to_keep_session = false;
+	struct s_field    fields[]        = {
+		{ "$.input_expr", "input expression", 's', 1, &input_expr },
+		{ "$.interval_lower", "lower interval", 'f', 1, &interval_lower },
+		{ "$.interval_upper", "upper interval", 'f', 1, &interval_upper },
+		{ "$.sct_p", "secant process", 'i', 1, &sct_p },
+		{ "$.precision", "precision", 'i', 1, &precision },
+		{ "$.iterations", "iterations", 'i', 1, &iterations },
+		{ "$.session", "session", 'b', 0, &to_keep_session },
+		{ NULL, NULL, 0, 0, NULL },
+	};
+	if (!s_hm_get_fields(c, hm->body, fields))
 		return;
-	/* iterations */
-	int iterations;
-	if (!s_hm_get_data(c, hm_body, "iterations", "iterations", 3, 1,
-	                   &iterations))
+	char expr[S_EXPR_MAX];
+	if (!s_hm_get_expr(c, input_expr, expr))
 		return;
-	/* cleanup */
-	json_delete(hm_body);
+	s_timing_mark(c, S_PHASE_PARSE);
 
 	/* = Main process = */
-	struct sct_t sct_instance;
-	int         expr_err_loc = sct_init(&sct_instance, input_expr);
+	/* The compiled expression points into the instance, so a kept session
+	 * needs the instance to be in its final place before compiling. */
+	struct s_sct_session  sct_sess_local;
+	struct s_sct_session *sct_sess = &sct_sess_local;
+	if (to_keep_session)
+		sct_sess = malloc(sizeof(struct s_sct_session));
+
+	int expr_err_loc = sct_init(&sct_sess->sct_instance, expr);
 	if (expr_err_loc != 0) {
 		/* error in the expression */
-		JsonNode *position_error_json = json_mkobject();
-		json_append_member(position_error_json, "message",
-		                   json_mkstring("Error in the expression"));
-		json_append_member(position_error_json, "position",
-		                   json_mknumber(expr_err_loc));
-		char *position_error_json_str =
-			json_stringify(position_error_json, "\t");
+		s_reply_expr_error(c, expr_err_loc);
+		if (to_keep_session)
+			free(sct_sess);
+		return;
+	}
+	sct_state_init(&sct_sess->sct_state, interval_lower, interval_upper);
+	sct_sess->sct_p           = sct_p;
+	sct_sess->precision       = precision;
+	sct_sess->iterations_done = 0;
+	s_timing_mark(c, S_PHASE_COMPILE);
+
+	/* = Keep the session = */
+	/* Kept before the iterations as its id goes in the headers. The entry
+	 * stays referenced till the reply is done. */
+	struct sess_entry *sess = NULL;
+	if (to_keep_session) {
+		pthread_mutex_lock(&s_sessions_lock);
+		sess = sess_create(&s_sessions, S_SESS_SECANT, sct_sess,
+		                   s_session_size(sizeof(struct s_sct_session),
+		                                  expr),
+		                   s_sct_session_free);
+		pthread_mutex_unlock(&s_sessions_lock);
+		if (!sess) {
+			/* the cap is taken by sessions being continued */
+			s_sct_session_free(sct_sess);
+			mg_http_reply(c, 503, "",
+			              "There is no room for another session.");
+			return;
+		}
+	}
+
+	struct s_stream st;
+	s_stream_begin(&st, c, hm, sess ? sess->id : NULL,
+	               cache_key_len ? cache_key : NULL, cache_key_len);
+	s_sct_stream(&st, sct_sess, iterations);
+	s_stream_end(&st);
+
+	/* = Cleanup = */
+	if (sess) {
+		pthread_mutex_lock(&s_sessions_lock);
+		sess_release(&s_sessions, sess);
+		pthread_mutex_unlock(&s_sessions_lock);
+	} else {
+		sct_instance_free(&sct_sess->sct_instance);
+	}
+}
+
+static void
+s_handler_c_st_nm_1_secant_continue(struct mg_connection   *c,
+                                    struct mg_http_message *hm,
+                                    struct mg_str           session_id)
+{
+	/* = Read the inputs = */
+	int            iterations;
+	struct s_field fields[] = {
+		{ "$.iterations", "iterations", 'i', 1, &iterations },
+		{ NULL, NULL, 0, 0, NULL },
+	};
+	if (!s_hm_get_fields(c, hm->body, fields))
+		return;
+
+	pthread_mutex_lock(&s_sessions_lock);
+	struct sess_entry *sess = sess_find(&s_sessions, session_id);
+	if (!sess || sess->type != S_SESS_SECANT) {
+		if (sess)
+			sess_release(&s_sessions, sess);
+		pthread_mutex_unlock(&s_sessions_lock);
+		mg_http_reply(c, 404, "", "Session not found or expired.");
+		return;
+	}
+	if (sess->refs > 1) {
+		/* continued by another request right now */
+		sess_release(&s_sessions, sess);
+		pthread_mutex_unlock(&s_sessions_lock);
+		mg_http_reply(c, 409, "", "Session is busy.");
+		return;
+	}
+	pthread_mutex_unlock(&s_sessions_lock);
+	s_timing_mark(c, S_PHASE_PARSE);
 
-		mg_http_reply(c, 400, "Content-Type: application/json\r\n",
-		              position_error_json_str);
+	/* = Main process = */
+	struct s_stream st;
+	s_stream_begin(&st, c, hm, sess->id, NULL, 0);
+	s_sct_stream(&st, sess->data, iterations);
+	s_stream_end(&st);
 
-		json_delete(position_error_json);
-		free(position_error_json_str);
+	/* = Cleanup = */
+	pthread_mutex_lock(&s_sessions_lock);
+	sess_release(&s_sessions, sess);
+	pthread_mutex_unlock(&s_sessions_lock);
+}
+static void
+s_handler_c_st_nm_1_horner_roots(struct mg_connection   *c,
+                                 struct mg_http_message *hm)
+{
+	/* = Read the inputs = */
+	/* poly_body */
+	int toklen;
+	int ofs = mg_json_get(hm->body.ptr, (int)hm->body.len, "$.poly_body",
+	                      &toklen);
+	if (ofs < 0 || hm->body.ptr[ofs] != '[') {
+		mg_http_reply(c, 400, "",
+		              "Please provide the polynomial coefficients.");
 		return;
 	}
+	struct mg_str poly_body_json = mg_str_n(hm->body.ptr + ofs, toklen);
+	float         poly_body[MRSPC_HORNER_MAX_DEGREE];
+	unsigned int  poly_body_c = 0;
+	for (;; poly_body_c++) {
+		char path[32];
+		mg_snprintf(path, sizeof(path), "$[%u]", poly_body_c);
+		int coeff_ofs = mg_json_get(poly_body_json.ptr,
+		                            (int)poly_body_json.len, path, &toklen);
+		if (coeff_ofs < 0)
+			break;
+		const char *coeff = poly_body_json.ptr + coeff_ofs;
+		if (*coeff != '-' && !isdigit((unsigned char)*coeff)) {
+			mg_http_reply(c, 400, "",
+			              "The polynomial coefficients should be "
+			              "numbers.");
+			return;
+		}
+		if (poly_body_c == MRSPC_HORNER_MAX_DEGREE) {
+			mg_http_reply(c, 400, "",
+			              "At most %d coefficients are supported.",
+			              MRSPC_HORNER_MAX_DEGREE);
+			return;
+		}
+		poly_body[poly_body_c] = mg_atod(coeff, toklen, NULL);
+	}
+	enum hrn_process_t hrn_p;
+	int                precision, iterations;
+	struct s_field     fields[] = {
+		{ "$.hrn_p", "horner process", 'i', 1, &hrn_p },
+		{ "$.precision", "precision", 'i', 1, &precision },
+		{ "$.iterations", "iterations", 'i', 1, &iterations },
+		{ NULL, NULL, 0, 0, NULL },
+	};
+	if (!s_hm_get_fields(c, hm->body, fields))
+		return;
+	if (precision <= 0 || iterations <= 0) {
+		mg_http_reply(c, 400, "",
+		              "The precision and iterations should be "
+		              "positive.");
+		return;
+	}
+	s_timing_mark(c, S_PHASE_PARSE);
+
+	/* = Main process = */
+	struct hrn_t hrn_instance;
+	hrn_init(&hrn_instance, poly_body_c ? poly_body_c - 1 : 0, poly_body);
 
-	int               sct_o_c;
-	struct sct_output *sct_o =
-		sct_execute(&sct_instance, interval_lower, interval_upper, sct_p,
-	                   precision, iterations, &sct_o_c);
+	int              hrn_r_c;
+	struct hrn_root *hrn_r = hrn_all_roots(&hrn_instance, hrn_p, precision,
+	                                       iterations, &hrn_r_c);
+	s_timing_mark(c, S_PHASE_SOLVE);
+	if (hrn_r == NULL) {
+		mg_http_reply(c, 400, "",
+		              "The polynomial should be at least of degree 1.");
+		return;
+	}
 
 	/* = Prepare output = */
-	/* create JSON for the output */
-	JsonNode *sct_o_json = json_mkarray();
+	struct mg_iobuf io = { 0 };
+	struct jw       w;
+	jw_init(&w, &io);
+	jw_array_begin(&w);
+	for (int i = 0; i < hrn_r_c; i++) {
+		jw_object_begin(&w);
+		jw_key(&w, "n");
+		jw_int(&w, i + 1);
+		jw_key(&w, "re");
+		jw_float(&w, hrn_r[i].re);
+		jw_key(&w, "im");
+		jw_float(&w, hrn_r[i].im);
+		jw_object_end(&w);
+	}
+	jw_array_end(&w);
+
+	/* Reply with the JSON */
+	s_reply_json(c, hm, "", &io);
+
+	/* = Cleanup = */
+	free(hrn_r);
+}
 
-	/* fill json string */
-	for (int i = 0; i < sct_o_c; i++) {
-		JsonNode *sct_item_json = json_mkobject();
+static void
+s_handler_c_st_nm_1_continuation(struct mg_connection   *c,
+                                 struct mg_http_message *hm)
+{
+	/* = Read the inputs = */
+	struct mg_str      input_expr;
+	float              param_lower, param_upper, x_guess;
+	int                param_steps, precision, iterations;
+	enum cnt_process_t cnt_p;
+	struct s_field     fields[] = {
+		{ "$.input_expr", "input expression", 's', 1, &input_expr },
+		{ "$.param_lower", "lower parameter value", 'f', 1, &param_lower },
+		{ "$.param_upper", "upper parameter value", 'f', 1, &param_upper },
+		{ "$.param_steps", "parameter steps", 'i', 1, &param_steps },
+		{ "$.x_guess", "initial guess", 'f', 1, &x_guess },
+		{ "$.cnt_p", "continuation process", 'i', 1, &cnt_p },
+		{ "$.precision", "precision", 'i', 1, &precision },
+		{ "$.iterations", "iterations", 'i', 1, &iterations },
+		{ NULL, NULL, 0, 0, NULL },
+	};
+	if (!s_hm_get_fields(c, hm->body, fields))
+		return;
+	char expr[S_EXPR_MAX];
+	if (!s_hm_get_expr(c, input_expr, expr))
+		return;
+	s_timing_mark(c, S_PHASE_PARSE);
 
-		/* prepare object */
-		json_append_member(sct_item_json, "n", json_mknumber(i + 1));
-		json_append_member(sct_item_json, "x0", json_mknumber(sct_o[i].x0));
-		json_append_member(sct_item_json, "fn_x0", json_mknumber(sct_o[i].fn_x0));
-		json_append_member(sct_item_json, "x1", json_mknumber(sct_o[i].x1));
-		json_append_member(sct_item_json, "fn_x1", json_mknumber(sct_o[i].fn_x1));
-		json_append_member(sct_item_json, "x2", json_mknumber(sct_o[i].x2));
-		json_append_member(sct_item_json, "fn_x2", json_mknumber(sct_o[i].fn_x2));
+	if (param_steps < 0) {
+		mg_http_reply(c, 400, "", "Parameter steps can't be negative.");
+		return;
+	}
+	if (param_steps > PARAM_STEPS_MAX) {
+		mg_http_reply(c, 400, "",
+		              "At most %d parameter steps are supported.",
+		              PARAM_STEPS_MAX);
+		return;
+	}
 
-		/* append the object to the array */
-		json_append_element(sct_o_json, sct_item_json);
+	/* = Main process = */
+	struct cnt_t cnt_instance;
+	int          expr_err_loc = cnt_init(&cnt_instance, expr);
+	if (expr_err_loc != 0) {
+		/* error in the expression */
+		s_reply_expr_error(c, expr_err_loc);
+		return;
 	}
-	char *sct_o_json_str = json_stringify(sct_o_json, "\t");
+	cnt_instance.fn_evals_max = BUDGET_EVALS;
+	s_timing_mark(c, S_PHASE_COMPILE);
 
-	/* Reply with the JSON */
-	mg_http_reply(c, 200, "Content-Type: application/json\r\n",
-	              sct_o_json_str);
+	int                cnt_o_c;
+	struct cnt_output *cnt_o =
+		cnt_execute(&cnt_instance, param_lower, param_upper,
+	                    param_steps, x_guess, cnt_p, precision, iterations,
+	                    &cnt_o_c);
+	s_timing_mark(c, S_PHASE_SOLVE);
+	if (cnt_o == NULL) {
+		mg_http_reply(c, 500, "", "Out of memory.");
+		cnt_instance_free(&cnt_instance);
+		return;
+	}
+
+	unsigned long cnt_iterations = 0;
+	for (int i = 0; i < cnt_o_c; i++)
+		cnt_iterations += cnt_o[i].iterations;
+	s_job_count(c, cnt_iterations, cnt_instance.fn_evals);
+
+	/* = Prepare output = */
+	struct mg_iobuf io = { 0 };
+	struct jw       w;
+	jw_init(&w, &io);
+	jw_array_begin(&w);
+	for (int i = 0; i < cnt_o_c; i++) {
+		jw_object_begin(&w);
+		jw_key(&w, "n");
+		jw_int(&w, i + 1);
+		jw_key(&w, "a");
+		jw_float(&w, cnt_o[i].a);
+		jw_key(&w, "x");
+		jw_float(&w, cnt_o[i].x);
+		jw_key(&w, "fn_x");
+		jw_float(&w, cnt_o[i].fn_x);
+		jw_key(&w, "iterations");
+		jw_int(&w, cnt_o[i].iterations);
+		jw_object_end(&w);
+	}
+	jw_array_end(&w);
+
+	/* Reply with the JSON, cut short if over the budget. */
+	s_reply_json(c, hm,
+	             cnt_instance.fn_evals >= cnt_instance.fn_evals_max
+	                     ? "X-Budget-Exceeded: evaluations\r\n"
+	                     : "",
+	             &io);
 
 	/* = Cleanup = */
-	json_delete(sct_o_json);
-	free(sct_o_json_str);
-	sct_instance_free(&sct_instance);
-	free(sct_o);
+	cnt_instance_free(&cnt_instance);
+	free(cnt_o);
 }
 
 int
 main(int argc, char **argv)
 {
-	struct mg_mgr         mgr;
-	struct mg_connection *c;
-
-	int  to_print_help, s_port;
+	int  to_print_help, is_packed, s_port, s_workers_c, s_threads_c;
 	char s_http_addr[21] = "http://0.0.0.0:";
 	char s_port_str[6];
 
 	/* = Flags = */
 	/* default values */
 	to_print_help = 0;
+	is_packed     = 0;
 	s_port        = 8000;
+	s_workers_c   = WORKERS_COUNT;
+	s_threads_c   = THREADS_COUNT;
 	/* define flags */
 	spl_flags_toggle(&to_print_help, 'h', "help", "Print help");
 	spl_flags_int(&s_port, 'p', "port", "Port number to listen from");
+	spl_flags_int(&s_workers_c, 'w', "workers",
+	              "Number of threads running the solvers");
+	spl_flags_int(&s_threads_c, 't', "threads",
+	              "Number of event loop threads sharing the port");
+	spl_flags_toggle(&is_packed, 'P', "packed",
+	                 "Serve the static assets packed into the binary "
+	                 "(make packed)");
+	spl_flags_toggle(&s_log_access, 'a', "access-log",
+	                 "Log every request handled");
 
 	spl_flags_parse(argc, argv);
 	executable_path = argv[0];
@@ -398,6 +3361,8 @@ main(int argc, char **argv)
 	/* Check if help option was passed */
 	if (to_print_help)
 		print_help_exit(stdout, EXIT_SUCCESS);
+	if (s_workers_c < 1 || s_threads_c < 1)
+		print_help_exit(stderr, EXIT_FAILURE);
 
 	/* = Prerequisites = */
 	snprintf(s_port_str, 6, "%d", s_port);
@@ -406,24 +3371,88 @@ main(int argc, char **argv)
 	signal(SIGINT, signal_handler);
 	signal(SIGTERM, signal_handler);
 
+	/* = Logging = */
+	/* Without the thread, mongoose's log is written as it goes and the
+	 * access records are left out. */
+	s_log_is_on = lgr_init(&s_log, STDOUT_FILENO);
+	if (s_log_is_on)
+		lgr_mg_redirect(&s_log);
+	else
+		s_log_access = 0;
+
+	/* = Shared state = */
+	s_routes_init();
+	sess_store_init(&s_sessions, SESSION_TTL_MS, SESSION_SIZE_MAX);
+	cache_init(&s_cache, CACHE_SIZE_MAX);
+	/* The packed files are in memory already. */
+	ast_init(&s_assets, is_packed ? &mg_fs_packed : &mg_fs_posix,
+	         ASSETS_ROOT, is_packed ? 0 : ASSETS_FILE_MAX);
+	ast_sync(&s_assets, &s_assets_lock);
+	MG_INFO(("Loaded %u %sstatic asset(s), %lu bytes", s_assets.count,
+	         is_packed ? "packed " : "", (unsigned long)s_assets.size));
+	if (!wrk_pool_init(&s_workers, s_workers_c)) {
+		MG_ERROR(("Cannot start the worker threads."));
+		exit(EXIT_FAILURE);
+	}
+	/* The bulk solves leave a worker to the interactive ones. */
+	wrk_lane_set(&s_workers, S_LANE_INTERACTIVE, LANE_WEIGHT_INTERACTIVE,
+	             0);
+	wrk_lane_set(&s_workers, S_LANE_BULK, LANE_WEIGHT_BULK,
+	             s_workers_c > 1 ? s_workers_c - 1 : 0);
+
 	/* = Mongoose = */
+	/* Every reactor has its own listener on the same port, the kernel spreads
+	 * the connections across them. */
 	mg_log_set("2");
-	mg_mgr_init(&mgr);
-	if ((c = mg_http_listen(&mgr, s_http_addr, s_handler_fn, NULL)) ==
-	    NULL) {
-		MG_ERROR(("Cannot listen on %s. Use http://ADDR:PORT or :PORT.",
-		          s_http_addr));
-		exit(EXIT_FAILURE);
+	s_reactors = calloc(s_threads_c, sizeof(struct s_reactor));
+	for (int i = 0; i < s_threads_c; i++) {
+		struct s_reactor *reactor = &s_reactors[i];
+
+		mg_mgr_init(&reactor->mgr);
+		reactor->mgr.userdata  = reactor;
+		reactor->mgr.reuseport = s_threads_c > 1;
+		if (!wrk_loop_init(&reactor->workers, &s_workers,
+		                   &reactor->mgr)) {
+			MG_ERROR(("Cannot create the worker pipe."));
+			exit(EXIT_FAILURE);
+		}
+		reactor->workers.done_max = LOOP_DONE_MAX;
+		if (mg_http_listen(&reactor->mgr, s_http_addr, s_handler_fn,
+		                   NULL) == NULL) {
+			MG_ERROR(("Cannot listen on %s. Use http://ADDR:PORT or "
+			          ":PORT.",
+			          s_http_addr));
+			exit(EXIT_FAILURE);
+		}
 	}
+	mg_timer_add(&s_reactors[0].mgr, SESSION_EXPIRE_INTERVAL_MS,
+	             MG_TIMER_REPEAT, s_session_expire_fn, &s_sessions);
+	if (!is_packed)
+		mg_timer_add(&s_reactors[0].mgr, ASSETS_SYNC_INTERVAL_MS,
+		             MG_TIMER_REPEAT, s_assets_sync_fn, &s_assets);
 
-	/* Start infinite event loop */
-	MG_INFO(("Starting sltextpad v%s, listening on '%s'", VERSION,
-	         s_http_addr));
-	while (s_signo == 0)
-		mg_mgr_poll(&mgr, 1000);
+	/* Start infinite event loops, the first one on this thread */
+	MG_INFO(("Starting sltextpad v%s, listening on '%s' with %d thread(s)",
+	         VERSION, s_http_addr, s_threads_c));
+	for (int i = 1; i < s_threads_c; i++)
+		pthread_create(&s_reactors[i].thread, NULL, s_reactor_run,
+		               &s_reactors[i]);
+	s_reactor_run(&s_reactors[0]);
+	for (int i = 1; i < s_threads_c; i++)
+		pthread_join(s_reactors[i].thread, NULL);
 
 	/* Clean exit */
-	mg_mgr_free(&mgr);
+	wrk_pool_free(&s_workers);
+	for (int i = 0; i < s_threads_c; i++)
+		mg_mgr_free(&s_reactors[i].mgr);
+	free(s_reactors);
+	rtr_free(&s_router);
+	sess_store_free(&s_sessions);
+	cache_free(&s_cache);
+	ast_free(&s_assets);
+	mtr_free(&s_metrics);
 	MG_INFO(("Exiting on signal %d", s_signo));
+	if (s_log_is_on)
+		lgr_free(&s_log);
 	return EXIT_SUCCESS;
 }
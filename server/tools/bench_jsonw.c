@@ -0,0 +1,281 @@
+/*
+ * Time 'jsonw' against building a DOM and stringifying it, the way the replies
+ * were written before it, on the rows of a bisection stream.
+ *
+ * The DOM library went away along with its last user, so a small one stands
+ * in for it here with the same costs: a node and a copy of the key and string
+ * allocated per value, numbers through "%.16g", and tab indentation.
+ *
+ * Usage: bench_jsonw [ROWS [REPEATS]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* mongoose - https://github.com/cesanta/mongoose */
+#include "../dep/mongoose.h"
+
+/* server libs */
+#define MRSPS_JSONW_IMPLEMENTATION
+#include "../lib/jsonw.h"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+/* A row of the bisection stream. */
+struct bench_row {
+	float a, b, c;
+	char  fn_a, fn_b, fn_c;
+};
+
+enum dom_tag_t {
+	DOM_NUMBER,
+	DOM_STRING,
+	DOM_ARRAY,
+	DOM_OBJECT,
+};
+
+struct dom_node {
+	enum dom_tag_t   tag;
+	char            *key;
+	double           number;
+	char            *string;
+	struct dom_node *head, *tail, *next;
+};
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+static double
+s_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+s_rows_init(struct bench_row *rows, int rows_c)
+{
+	/* Bisection of x^2 - 2 on [0.5, 2], started over once converged. */
+	float a = 0.5f, b = 2;
+	for (int i = 0; i < rows_c; i++) {
+		float c = (a + b) / 2;
+		rows[i] = (struct bench_row){ a, b, c, '-', '+',
+		                              c * c > 2 ? '+' : '-' };
+		if (c * c > 2)
+			b = c;
+		else
+			a = c;
+		if (b - a < 1e-6f) {
+			a = 0.5f + i * 1e-3f;
+			b = 2 + i * 1e-3f;
+		}
+	}
+}
+
+/* = DOM = */
+static struct dom_node *
+s_dom_new(enum dom_tag_t tag)
+{
+	struct dom_node *node = calloc(1, sizeof(struct dom_node));
+	node->tag             = tag;
+
+	return node;
+}
+
+static void
+s_dom_append(struct dom_node *parent, const char *key, struct dom_node *child)
+{
+	if (key)
+		child->key = strdup(key);
+	if (parent->tail)
+		parent->tail->next = child;
+	else
+		parent->head = child;
+	parent->tail = child;
+}
+
+static struct dom_node *
+s_dom_number(double number)
+{
+	struct dom_node *node = s_dom_new(DOM_NUMBER);
+	node->number          = number;
+
+	return node;
+}
+
+static struct dom_node *
+s_dom_string(const char *str, size_t len)
+{
+	struct dom_node *node = s_dom_new(DOM_STRING);
+	node->string          = malloc(len + 1);
+	memcpy(node->string, str, len);
+	node->string[len] = '\0';
+
+	return node;
+}
+
+static void
+s_dom_free(struct dom_node *node)
+{
+	for (struct dom_node *next, *child = node->head; child; child = next) {
+		next = child->next;
+		s_dom_free(child);
+	}
+	free(node->key);
+	free(node->string);
+	free(node);
+}
+
+static void
+s_dom_indent(struct mg_iobuf *io, int depth)
+{
+	for (int i = 0; i < depth; i++)
+		mg_iobuf_add(io, io->len, "\t", 1, MG_IO_SIZE);
+}
+
+static void
+s_dom_emit(struct mg_iobuf *io, const struct dom_node *node, int depth)
+{
+	char buf[64];
+	if (node->key) {
+		mg_iobuf_add(io, io->len, "\"", 1, MG_IO_SIZE);
+		mg_iobuf_add(io, io->len, node->key, strlen(node->key),
+		             MG_IO_SIZE);
+		mg_iobuf_add(io, io->len, "\": ", 3, MG_IO_SIZE);
+	}
+
+	switch (node->tag) {
+	case DOM_NUMBER:
+		snprintf(buf, sizeof(buf), "%.16g", node->number);
+		mg_iobuf_add(io, io->len, buf, strlen(buf), MG_IO_SIZE);
+		break;
+	case DOM_STRING:
+		mg_iobuf_add(io, io->len, "\"", 1, MG_IO_SIZE);
+		mg_iobuf_add(io, io->len, node->string, strlen(node->string),
+		             MG_IO_SIZE);
+		mg_iobuf_add(io, io->len, "\"", 1, MG_IO_SIZE);
+		break;
+	case DOM_ARRAY:
+	case DOM_OBJECT:
+		mg_iobuf_add(io, io->len,
+		             node->tag == DOM_ARRAY ? "[\n" : "{\n", 2,
+		             MG_IO_SIZE);
+		for (struct dom_node *child = node->head; child;
+		     child = child->next) {
+			s_dom_indent(io, depth + 1);
+			s_dom_emit(io, child, depth + 1);
+			mg_iobuf_add(io, io->len, child->next ? ",\n" : "\n",
+			             child->next ? 2 : 1, MG_IO_SIZE);
+		}
+		s_dom_indent(io, depth);
+		mg_iobuf_add(io, io->len, node->tag == DOM_ARRAY ? "]" : "}", 1,
+		             MG_IO_SIZE);
+		break;
+	}
+}
+
+static size_t
+s_bench_dom(struct mg_iobuf *io, const struct bench_row *rows, int rows_c)
+{
+	struct dom_node *array = s_dom_new(DOM_ARRAY);
+	for (int i = 0; i < rows_c; i++) {
+		struct dom_node *row = s_dom_new(DOM_OBJECT);
+		s_dom_append(row, "n", s_dom_number(i + 1));
+		s_dom_append(row, "a", s_dom_number(rows[i].a));
+		s_dom_append(row, "fn_a", s_dom_string(&rows[i].fn_a, 1));
+		s_dom_append(row, "b", s_dom_number(rows[i].b));
+		s_dom_append(row, "fn_b", s_dom_string(&rows[i].fn_b, 1));
+		s_dom_append(row, "c", s_dom_number(rows[i].c));
+		s_dom_append(row, "fn_c", s_dom_string(&rows[i].fn_c, 1));
+		s_dom_append(array, NULL, row);
+	}
+
+	io->len = 0;
+	s_dom_emit(io, array, 0);
+	s_dom_free(array);
+
+	return io->len;
+}
+
+/* = jsonw = */
+static size_t
+s_bench_jsonw(struct mg_iobuf *io, const struct bench_row *rows, int rows_c)
+{
+	struct jw w;
+	io->len = 0;
+	jw_init(&w, io);
+	jw_array_begin(&w);
+	for (int i = 0; i < rows_c; i++) {
+		jw_object_begin(&w);
+		jw_key(&w, "n");
+		jw_int(&w, i + 1);
+		jw_key(&w, "a");
+		jw_float(&w, rows[i].a);
+		jw_key(&w, "fn_a");
+		jw_str(&w, &rows[i].fn_a, 1);
+		jw_key(&w, "b");
+		jw_float(&w, rows[i].b);
+		jw_key(&w, "fn_b");
+		jw_str(&w, &rows[i].fn_b, 1);
+		jw_key(&w, "c");
+		jw_float(&w, rows[i].c);
+		jw_key(&w, "fn_c");
+		jw_str(&w, &rows[i].fn_c, 1);
+		jw_object_end(&w);
+	}
+	jw_array_end(&w);
+
+	return io->len;
+}
+
+static void
+s_report(const char *name, double seconds, size_t bytes, int rows_c,
+         int repeats)
+{
+	printf("%-6s %8.1f ns/row %8.1f MB/s %10lu bytes\n", name,
+	       seconds * 1e9 / rows_c / repeats,
+	       bytes * repeats / seconds / 1e6,
+	       (unsigned long)bytes);
+}
+
+int
+main(int argc, char **argv)
+{
+	int rows_c  = argc > 1 ? atoi(argv[1]) : 1000;
+	int repeats = argc > 2 ? atoi(argv[2]) : 200;
+	if (rows_c <= 0 || repeats <= 0) {
+		fprintf(stderr, "Usage: %s [ROWS [REPEATS]]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	struct bench_row *rows = malloc(rows_c * sizeof(struct bench_row));
+	s_rows_init(rows, rows_c);
+
+	/* The buffer is kept across the repeats, as a reply's would grow once
+	 * to the size it needs. */
+	struct mg_iobuf io    = { 0 };
+	size_t          bytes = 0;
+	double          start = s_now();
+	for (int i = 0; i < repeats; i++)
+		bytes = s_bench_dom(&io, rows, rows_c);
+	s_report("dom", s_now() - start, bytes, rows_c, repeats);
+
+	start = s_now();
+	for (int i = 0; i < repeats; i++)
+		bytes = s_bench_jsonw(&io, rows, rows_c);
+	s_report("jsonw", s_now() - start, bytes, rows_c, repeats);
+
+	mg_iobuf_free(&io);
+	free(rows);
+
+	return EXIT_SUCCESS;
+}
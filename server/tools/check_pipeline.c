@@ -0,0 +1,310 @@
+/*
+ * Check that the replies to pipelined requests come back whole and in order,
+ * from the server listening on the port given.
+ *
+ * The requests of each case are sent in one write, a slow one first, and the
+ * bodies of the replies are checked against the ones to the same requests
+ * sent on connections of their own.
+ *
+ * Usage: check_pipeline PORT
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define URI "/api/components/study-tools/nm/1-non-linear-eqn/"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+struct check_request {
+	const char *path, *body;
+};
+
+struct check_reply {
+	int    status;
+	char  *body;
+	size_t body_len;
+};
+
+/* A continuation solving for long enough to be still at it when the rest
+ * come. */
+static const struct check_request s_slow = {
+	"6-continuation",
+	"{\"input_expr\":\"x^2-a\",\"param_lower\":1,\"param_upper\":2,"
+	"\"param_steps\":20000,\"x_guess\":1,\"cnt_p\":0,\"precision\":4,"
+	"\"iterations\":50}"
+};
+
+static const struct check_request s_fast = {
+	"1-bisection",
+	"{\"input_expr\":\"x^3-x-2\",\"interval_lower\":1,\"interval_upper\":2,"
+	"\"bs_p\":0,\"precision\":4,\"iterations\":9}"
+};
+
+/* Streamed in many chunks, as it doesn't converge. */
+static const struct check_request s_stream = {
+	"2-secant",
+	"{\"input_expr\":\"x^2+1\",\"interval_lower\":0.5,\"interval_upper\":1,"
+	"\"sct_p\":0,\"precision\":4,\"iterations\":20000}"
+};
+
+static const struct check_request s_stream_short = {
+	"1-bisection",
+	"{\"input_expr\":\"x^2-2\",\"interval_lower\":0,\"interval_upper\":2,"
+	"\"bs_p\":0,\"precision\":4,\"iterations\":300}"
+};
+
+static int s_port;
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+static int
+s_connect(void)
+{
+	struct sockaddr_in addr = { 0 };
+	addr.sin_family         = AF_INET;
+	addr.sin_port           = htons(s_port);
+	addr.sin_addr.s_addr    = htonl(INADDR_LOOPBACK);
+
+	/* The server may be still starting. */
+	for (int tries = 0; tries < 50; tries++) {
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0)
+			return -1;
+		if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+			struct timeval tv = { 10, 0 };
+			setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv,
+			           sizeof(tv));
+			return fd;
+		}
+		close(fd);
+		usleep(100 * 1000);
+	}
+
+	return -1;
+}
+
+static size_t
+s_request(char *buf, size_t size, const struct check_request *req)
+{
+	int len = snprintf(buf, size,
+	                   "POST " URI "%s HTTP/1.1\r\nHost: localhost\r\n"
+	                   "Content-Length: %lu\r\n\r\n%s",
+	                   req->path, (unsigned long)strlen(req->body),
+	                   req->body);
+
+	return len > 0 && (size_t)len < size ? (size_t)len : 0;
+}
+
+static long
+s_parse(const char *buf, size_t len, struct check_reply *reply)
+{
+	reply->body = NULL;
+
+	/* = Head = */
+	const char *end = NULL;
+	for (size_t i = 0; i + 4 <= len && !end; i++)
+		if (memcmp(buf + i, "\r\n\r\n", 4) == 0)
+			end = buf + i + 4;
+	if (!end)
+		return 0;
+
+	size_t head_len = end - buf;
+	char  *head     = malloc(head_len + 1);
+	memcpy(head, buf, head_len);
+	head[head_len] = '\0';
+
+	const char *content_len = strstr(head, "\r\nContent-Length: ");
+	size_t      body_len =
+		content_len ? strtoul(content_len + 18, NULL, 10) : 0;
+	int is_chunked =
+		strstr(head, "\r\nTransfer-Encoding: chunked") != NULL;
+	reply->status = strncmp(head, "HTTP/1.1 ", 9) == 0 ? atoi(head + 9)
+	                                                   : 0;
+	free(head);
+	if (!reply->status)
+		return -1;
+
+	/* = Body = */
+	const char *p = end, *lim = buf + len;
+	reply->body     = malloc(1);
+	reply->body_len = 0;
+	if (!is_chunked) {
+		if ((size_t)(lim - p) < body_len)
+			return 0;
+		reply->body = realloc(reply->body, body_len + 1);
+		memcpy(reply->body, p, body_len);
+		reply->body_len = body_len;
+		return (long)(p + body_len - buf);
+	}
+
+	for (;;) {
+		char       *size_end;
+		const char *crlf = memchr(p, '\n', lim - p);
+		if (!crlf)
+			return 0;
+		size_t chunk_len = strtoul(p, &size_end, 16);
+		if (size_end == p)
+			return -1;
+		p = crlf + 1;
+		if (!chunk_len)
+			break;
+		if ((size_t)(lim - p) < chunk_len + 2)
+			return 0;
+		reply->body = realloc(reply->body, reply->body_len + chunk_len);
+		memcpy(reply->body + reply->body_len, p, chunk_len);
+		reply->body_len += chunk_len;
+		p += chunk_len + 2;
+	}
+
+	/* The trailer, up to an empty line. */
+	for (;;) {
+		const char *crlf = memchr(p, '\n', lim - p);
+		if (!crlf)
+			return 0;
+		int is_last = crlf - p <= 1;
+		p           = crlf + 1;
+		if (is_last)
+			return (long)(p - buf);
+	}
+}
+
+static void
+s_replies_free(struct check_reply *replies, int replies_c)
+{
+	for (int i = 0; i < replies_c; i++)
+		free(replies[i].body);
+}
+
+static int
+s_send(const struct check_request *reqs, int reqs_c,
+       struct check_reply *replies)
+{
+	/* = Send them all at once = */
+	char   out[8192];
+	size_t out_len = 0;
+	for (int i = 0; i < reqs_c; i++) {
+		size_t len = s_request(out + out_len, sizeof(out) - out_len,
+		                       &reqs[i]);
+		if (!len)
+			return 0;
+		out_len += len;
+	}
+
+	int fd = s_connect();
+	if (fd < 0) {
+		fprintf(stderr, "Couldn't connect to port %d.\n", s_port);
+		return 0;
+	}
+	if (send(fd, out, out_len, 0) != (ssize_t)out_len) {
+		close(fd);
+		return 0;
+	}
+
+	/* = Read the replies = */
+	char  *in      = NULL;
+	size_t in_len  = 0;
+	int    parsed  = 0;
+	int    is_done = 0;
+	while (!is_done) {
+		char    chunk[65536];
+		ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+		if (n <= 0)
+			break;
+		in = realloc(in, in_len + n);
+		memcpy(in + in_len, chunk, n);
+		in_len += n;
+
+		/* Over from the first, a reply may have been cut short. */
+		s_replies_free(replies, parsed);
+		size_t ofs = 0;
+		for (parsed = 0; parsed < reqs_c; parsed++) {
+			long len = s_parse(in + ofs, in_len - ofs,
+			                   &replies[parsed]);
+			if (len <= 0) {
+				free(replies[parsed].body);
+				is_done = len < 0;
+				break;
+			}
+			ofs += len;
+		}
+		is_done |= parsed == reqs_c;
+	}
+	free(in);
+	close(fd);
+
+	if (parsed < reqs_c) {
+		s_replies_free(replies, parsed);
+		return 0;
+	}
+	return 1;
+}
+
+static int
+s_check(const char *name, const struct check_request *reqs, int reqs_c)
+{
+	struct check_reply pipelined[8], alone;
+	if (!s_send(reqs, reqs_c, pipelined)) {
+		printf("FAIL %s: not every reply came back whole\n", name);
+		return 0;
+	}
+
+	int is_ok = 1;
+	for (int i = 0; i < reqs_c && is_ok; i++) {
+		if (!s_send(&reqs[i], 1, &alone)) {
+			printf("FAIL %s: request %d alone got no reply\n", name,
+			       i + 1);
+			is_ok = 0;
+			break;
+		}
+		if (pipelined[i].status != alone.status ||
+		    pipelined[i].body_len != alone.body_len ||
+		    memcmp(pipelined[i].body, alone.body, alone.body_len)) {
+			printf("FAIL %s: reply %d isn't the one to request "
+			       "%d\n",
+			       name, i + 1, i + 1);
+			is_ok = 0;
+		}
+		s_replies_free(&alone, 1);
+	}
+	s_replies_free(pipelined, reqs_c);
+
+	if (is_ok)
+		printf("ok   %s\n", name);
+	return is_ok;
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc != 2 || (s_port = atoi(argv[1])) <= 0) {
+		fprintf(stderr, "Usage: %s PORT\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const struct check_request slow_fast[]  = { s_slow, s_fast };
+	const struct check_request streams[]    = { s_stream, s_stream_short };
+	const struct check_request slow_three[] = { s_slow, s_stream_short,
+		                                    s_fast };
+
+	int is_ok = 1;
+	/* Solved first, then from the cache as its reply is kept. */
+	is_ok &= s_check("slow then fast", slow_fast, 2);
+	is_ok &= s_check("slow then cached", slow_fast, 2);
+	is_ok &= s_check("two streams", streams, 2);
+	is_ok &= s_check("slow then two", slow_three, 3);
+
+	return is_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
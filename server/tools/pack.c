@@ -0,0 +1,166 @@
+/*
+ * Pack files into a C source for the mongoose packed filesystem,
+ * 'mg_fs_packed', to be linked into the server.
+ *
+ * Every file goes in along with its gzip and deflate encodings, when smaller,
+ * under the '.gz' and '.zz' suffixes the static assets look for. The files are
+ * named as given on the command line.
+ *
+ * Usage: pack FILE... > packed_res.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* mongoose - https://github.com/cesanta/mongoose */
+#include "../dep/mongoose.h"
+
+/* server libs */
+#define MRSPS_DEFLATE_IMPLEMENTATION
+#include "../lib/deflate.h"
+
+/*
+ ===============================================================================
+ |                                    Data                                     |
+ ===============================================================================
+ */
+struct pack_file {
+	char          *name;
+	unsigned char *data;
+	size_t         size;
+	time_t         mtime;
+};
+
+static struct pack_file *s_files;
+static size_t            s_files_c;
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+static void
+s_add(const char *name, const char *suffix, unsigned char *data, size_t size,
+      time_t mtime)
+{
+	struct pack_file *f;
+
+	s_files = realloc(s_files, (s_files_c + 1) * sizeof(struct pack_file));
+	f       = &s_files[s_files_c++];
+	f->name = malloc(strlen(name) + strlen(suffix) + 1);
+	strcpy(f->name, name);
+	strcat(f->name, suffix);
+	f->data  = data;
+	f->size  = size;
+	f->mtime = mtime;
+}
+
+static int
+s_cmp(const void *a, const void *b)
+{
+	/* 'mg_fs_packed' lists directories assuming the names are sorted. */
+	return strcmp(((const struct pack_file *)a)->name,
+	              ((const struct pack_file *)b)->name);
+}
+
+static int
+s_pack(const char *name)
+{
+	struct stat st;
+	size_t      size;
+	char       *data = mg_file_read(&mg_fs_posix, name, &size);
+	if (!data || stat(name, &st) != 0) {
+		fprintf(stderr, "pack: cannot read %s\n", name);
+		return 0;
+	}
+	s_add(name, "", (unsigned char *)data, size, st.st_mtime);
+
+	/* Files that are already an encoding of another aren't compressed. */
+	size_t len = strlen(name);
+	if (len > 3 && (strcmp(name + len - 3, ".gz") == 0 ||
+	                strcmp(name + len - 3, ".zz") == 0))
+		return 1;
+
+	static const enum dfl_format_t formats[] = { DFL_GZIP, DFL_ZLIB };
+	static const char             *suffixes[] = { ".gz", ".zz" };
+	for (int i = 0; i < 2; i++) {
+		struct mg_iobuf io = { 0 };
+		if (!dfl_compress(&io, data, size, DFL_LEVEL_MAX, formats[i])) {
+			fprintf(stderr, "pack: out of memory\n");
+			return 0;
+		}
+		if (io.len < size)
+			s_add(name, suffixes[i], io.buf, io.len, st.st_mtime);
+		else
+			mg_iobuf_free(&io);
+	}
+
+	return 1;
+}
+
+static void
+s_print(FILE *out)
+{
+	fprintf(out, "/* Generated by tools/pack.c, do not edit. */\n\n"
+	             "#include <stddef.h>\n"
+	             "#include <string.h>\n"
+	             "#include <time.h>\n\n");
+
+	for (size_t i = 0; i < s_files_c; i++) {
+		fprintf(out, "static const unsigned char v%lu[] = {",
+		        (unsigned long)i);
+		for (size_t j = 0; j < s_files[i].size; j++)
+			fprintf(out, "%s0x%02x,", j % 12 ? " " : "\n\t",
+			        s_files[i].data[j]);
+		/* NUL terminated like 'mg_file_read' */
+		fprintf(out, "%s0\n};\n\n", s_files[i].size % 12 ? " " : "\n\t");
+	}
+
+	fprintf(out, "static const struct packed_file {\n"
+	             "\tconst char          *name;\n"
+	             "\tconst unsigned char *data;\n"
+	             "\tsize_t               size;\n"
+	             "\ttime_t               mtime;\n"
+	             "} packed_files[] = {\n");
+	for (size_t i = 0; i < s_files_c; i++)
+		fprintf(out, "\t{ \"%s\", v%lu, sizeof(v%lu) - 1, %lu },\n",
+		        s_files[i].name, (unsigned long)i, (unsigned long)i,
+		        (unsigned long)s_files[i].mtime);
+	fprintf(out, "\t{ NULL, NULL, 0, 0 },\n};\n\n");
+
+	fprintf(out, "const char *\n"
+	             "mg_unlist(size_t no)\n"
+	             "{\n"
+	             "\treturn packed_files[no].name;\n"
+	             "}\n\n"
+	             "const char *\n"
+	             "mg_unpack(const char *name, size_t *size, time_t *mtime)\n"
+	             "{\n"
+	             "\tconst struct packed_file *p;\n\n"
+	             "\tfor (p = packed_files; p->name; p++) {\n"
+	             "\t\tif (strcmp(p->name, name) != 0)\n"
+	             "\t\t\tcontinue;\n"
+	             "\t\tif (size)\n"
+	             "\t\t\t*size = p->size;\n"
+	             "\t\tif (mtime)\n"
+	             "\t\t\t*mtime = p->mtime;\n"
+	             "\t\treturn (const char *)p->data;\n"
+	             "\t}\n\n"
+	             "\treturn NULL;\n"
+	             "}\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	for (int i = 1; i < argc; i++)
+		if (!s_pack(argv[i]))
+			return EXIT_FAILURE;
+
+	qsort(s_files, s_files_c, sizeof(struct pack_file), s_cmp);
+	s_print(stdout);
+
+	return EXIT_SUCCESS;
+}